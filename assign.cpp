@@ -13,55 +13,356 @@
 */
 
 #include <table.h>
+#include <option.h>
 #include <strain.h>
 #include <species.h>
+#include <sweep.h>
+#include <report.h>
+#include <preview.h>
+#include <online.h>
+#include <placement.h>
+#include <cache.h>
+#include <delta.h>
+#include <panel.h>
+#include <lineage.h>
 
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 
 /*
  * main driver procedure
+ *
+ * required parameters:
+ * translation table
+ * summary file generated by samfile
+ *
+ * optional parameters:
+ * --max-memory=SIZE    memory budget of the species level assignment
+ * --tmp-dir=PATH       directory of the temporary files; default $TMPDIR
+ * --preview=F          approximate abundances from a fraction F of the summary
+ * --preview-reads=N    approximate abundances from about N reads
+ * --seed=N             seed of the preview sampling and the bootstrap
+ * --strain-identity=P  minimum average identity of a strain for its index; default 70
+ * --min-index=W        minimum weighted shannon index of a species; default 0.15
+ * --min-identity=P     minimum percent identity of a candidate; default 85
+ * --sweep              evaluate every combination of the thresholds, which
+ *                      may be given as lists, e.g., --min-identity=80,85,90
+ * --sweep-tables       also write one pivot table per combination
+ * --histogram          save the coverage histograms in sample.strain.bin
+ * --store              read the strain level records from sample.store,
+ *                      written by samfile --store, one partition per thread
+ * --from-histogram     rebuild the strain and species indices and the
+ *                      coverage from sample.strain.bin given in place of
+ *                      the summary file; the reads are not read
+ * --bootstrap=B        confidence intervals of the wsei and the abundances
+ *                      from B bootstrap replicates of the reads
+ * --confidence=C       confidence level of the intervals; default 0.95
+ * --online             follow the summary file, e.g., a fifo written by
+ *                      samfile, and replace the strain and pivot tables with
+ *                      snapshots while it is written; "-" is the standard input
+ * --snapshot-reads=N   records between snapshots; default 1000000, 0 disables
+ * --snapshot-seconds=T seconds between snapshots; default 60, 0 disables
+ * --numa               pin the threads of the assignments to the numa nodes;
+ *                      --numa=N for N nodes, merged or virtual
+ * --threads=N          number of threads; default OMP_NUM_THREADS or all processors
+ * --incremental        keep the state of the run in sample.strain.bin and
+ *                      sample.species.bin; once the translation table has
+ *                      changed, only the affected reads are assigned again.
+ *                      not used by the sweep and the bootstrap
+ * --cache=D            reuse the tables of a previous run with the same inputs
+ *                      and options from the cache directory D, or keep them
+ *                      there; not used by the sweep, preview and online modes
+ * --cache-size=SIZE    size limit of the cache; least recently used entries
+ *                      are removed first; default unlimited
+ * --report=F           write the instrumentation of the run to F in json
+ * --progress           periodic progress with throughput and eta on stderr
+ * --panel=F            assign only among the taxa listed in F, one tid or
+ *                      species name per line; the tables hold the panel only
+ * --ranks=R1,R2,...    also write the pivot tables of the ranks of the lineage,
+ *                      e.g., --ranks=genus,family writes sample.genus.pivot.csv
+ *                      and sample.family.pivot.csv; --ranks for all ranks of
+ *                      the translation table
+ * --bin-width=W        width of the histogram bins in bases; the same as that
+ *                      of samfile; default 1000
+ * --pyramid=W1,W2,...  also write the strain level tables of coarser bins,
+ *                      e.g., --pyramid=10000,100000 writes sample.strain.10000.csv
+ *                      and sample.strain.100000.csv; multiples of the width
 */
 int main( int argc, char* argv[] )
 {
-    const unsigned int nMaxBUFFER = 2048;
+    Option opt( argc, argv, "max-memory,tmp-dir,preview,preview-reads,seed,report,"
+        "strain-identity,min-index,min-identity,bootstrap,confidence,snapshot-reads,snapshot-seconds,"
+        "cache,cache-size,threads,panel,bin-width,pyramid" );
+    const std::vector<std::string>& arg = opt.GetArgs();
 
-    if ( argc < 3 )
+    if ( arg.size() < 2 )
     {
         return( 1 );
     }   // check the number of parameters
 
-    stTABLE a;
-    char buffer[ nMaxBUFFER ];
     std::map<unsigned int, stTABLE> table;
+    std::vector<std::string> rank;      // ranks of the lineage
+    const char* tmp = ::getenv( "TMPDIR" );
+    Report r; r.SetProgress( opt.Has( "progress" ) );
+    Report* report = ( opt.Has( "report" ) || opt.Has( "progress" ) ) ? &r : NULL;
+    Numa n( opt.GetSize( "numa", 0 ) );
+    Numa* numa = ( opt.Has( "numa" ) ) ? &n : NULL;
+    std::vector<double> strain = opt.GetReals( "strain-identity", 70.0 );
+    std::vector<double> index = opt.GetReals( "min-index", 0.15 );
+    std::vector<double> identity = opt.GetReals( "min-identity", 85.0 );
+    std::vector<double> levels = opt.GetReals( "pyramid", 0.0 );
+    std::vector<unsigned int> pyramid;
+    unsigned int width = opt.GetSize( "bin-width", nBinWIDTH );
+    unsigned int replicate = opt.GetSize( "bootstrap", 0 );
+    double level = opt.GetReal( "confidence", 0.95 );
+    bool sweep = opt.Has( "sweep" ) || opt.Has( "sweep-tables" ) ||
+        ( strain.size() * index.size() * identity.size() > 1 );
+    bool incremental = opt.Has( "incremental" ) && !sweep && !( replicate > 0 );
 
-    std::ifstream ifs( argv[ 1 ], std::ios::in );
+    Numa::SetThreads( opt.GetSize( "threads", 0 ) );
 
-    if ( ifs.fail() )
+    std::cout << "loading translation table ..." << std::flush;
+
+    if ( !LoadTable( arg[ 0 ], table, &rank ) )
     {
         return( 0 );
-    }   // check the state of stream
+    }   // load the table first
 
-    ifs.getline( buffer, nMaxBUFFER );      // skip the header
-    std::cout << "loading translation table ..." << std::flush;
+    width = ( width ) ? width : nBinWIDTH; SetWidth( table, width );
 
-    while ( ifs.getline( buffer, nMaxBUFFER ) )
+    for ( unsigned int i = 0; opt.Has( "pyramid" ) && ( i < levels.size() ); ++i )
     {
-        a = buffer; table[ a.gid ] = a;
-    }   // load the table first
+        if ( !( static_cast<unsigned int>( levels[ i ] ) > width ) || ( static_cast<unsigned int>( levels[ i ] ) % width ) )
+        {
+            std::cout << " level " << levels[ i ] << " is not a multiple of the bin width" << std::endl; return( 1 );
+        }   // a level merges whole bins
+
+        pyramid.push_back( static_cast<unsigned int>( levels[ i ] ) );
+    }   // coarser levels of the histograms
+
+    if ( opt.Has( "panel" ) )
+    {
+        Panel panel;
+
+        if ( !panel.Load( opt.Get( "panel" ), table ) )
+        {
+            std::cout << " no taxon of the panel is in the table" << std::endl; return( 1 );
+        }   // missing file or unknown taxa
+
+        panel.Filter( table );
+    }   // the tables are sized to the target taxa
+
+    Lineage lineage( table, rank );
+    std::vector<std::string> ranks;
+    const std::string select = opt.Get( "ranks" );
+
+    if ( select.empty() )
+    {
+        ranks = rank;
+    }   // every rank of the table
+    else
+    {
+        boost::algorithm::split( ranks, select, boost::algorithm::is_any_of( "," ) );
+    }   // the ranks asked for
+
+    for ( unsigned int i = 0; opt.Has( "ranks" ) && ( i < ranks.size() ); ++i )
+    {
+        if ( !lineage.Select( ranks[ i ] ) )
+        {
+            std::cout << " no rank " << ranks[ i ] << " in the table" << std::endl; return( 1 );
+        }   // the table has no lineage of the rank
+    }   // pivot tables of the higher ranks
+
+    std::cout << " completed" << std::endl;
+
+    if ( opt.Has( "preview" ) || opt.Has( "preview-reads" ) )
+    {
+        Preview v( table );
+        v.SetFraction( opt.GetReal( "preview", 0.01 ) );
+        v.SetReads( opt.GetReal( "preview-reads", 0.0 ) );
+        v.SetSeed( opt.GetSize( "seed", 0 ) );
+        v.SetThreshold( strain[ 0 ], index[ 0 ], identity[ 0 ] );
+
+        std::cout << "preview of file: " << arg[ 1 ] << std::endl;
+        v.Run( arg[ 1 ] ); return( 0 );
+    }   // approximate assignment on a subsample
+
+    if ( opt.Has( "from-histogram" ) )
+    {
+        std::vector<std::string> field;
+        boost::algorithm::split( field, arg[ 1 ], boost::algorithm::is_any_of( "." ) );
+
+        std::cout << "rebuilding from histograms: " << arg[ 1 ] << std::endl;
+        Strain p( table );              // strain level indices
+        p.SetIdentity( strain[ 0 ] ); p.SetReport( report ); p.SetPyramid( width, pyramid );
+        p.SetBootstrap( replicate, level, opt.GetSize( "seed", 0 ) );
+
+        if ( !p.Restore( arg[ 1 ] ) )
+        {
+            std::cout << "unable to read the histograms of this table and bin width" << std::endl; return( 1 );
+        }   // missing file, another version, or other bins
+
+        Species q( table, p.GetIndex() );   // species level indices
+        q.SetThreshold( index[ 0 ], identity[ 0 ] ); q.WriteIndex( field[ 0 ] + ".wsei.csv" );
+
+        if ( opt.Has( "report" ) )
+        {
+            r.Write( opt.Get( "report" ) );
+        }   // write the report at exit
+
+        return( 0 );
+    }   // the summary file is not needed
+
+    if ( opt.Has( "online" ) )
+    {
+        std::cout << "following file: " << arg[ 1 ] << std::endl;
+        Online o( table );              // strain and species level assignment
+        o.SetThreshold( strain[ 0 ], index[ 0 ], identity[ 0 ] );
+        o.SetInterval( opt.GetReal( "snapshot-reads", 1000000.0 ),
+            opt.GetReal( "snapshot-seconds", 60.0 ) );
+        o.SetReport( report );
 
-    ifs.close(); std::cout << " completed" << std::endl;
+        if ( !o.Run( arg[ 1 ] ) )
+        {
+            std::cout << "unable to read the summary" << std::endl; return( 1 );
+        }   // missing file
 
-    std::cout << "processing file: " << argv[ 2 ] << std::endl;
+        if ( opt.Has( "report" ) )
+        {
+            r.Write( opt.Get( "report" ) );
+        }   // write the report at exit
+
+        return( 0 );
+    }   // snapshots while the summary is written
+
+    std::vector<std::string> output;
+    Cache c( opt.Get( "cache" ), opt.GetBytes( "cache-size", 0 ) );
+
+    if ( opt.Has( "cache" ) && !sweep )
+    {
+        std::vector<std::string> field;
+        boost::algorithm::split( field, arg[ 1 ], boost::algorithm::is_any_of( ".\n" ) );
+        output.push_back( field[ 0 ] + ".strain.csv" );
+        output.push_back( field[ 0 ] + ".assign.csv" );
+        output.push_back( field[ 0 ] + ".pivot.csv" );
+        output.push_back( field[ 0 ] + ".wsei.csv" );
+
+        for ( unsigned int i = 0; i < lineage.GetSize(); ++i )
+        {
+            output.push_back( field[ 0 ] + "." + lineage.GetRank( i ) + ".pivot.csv" );
+        }   // pivot tables of the higher ranks
+
+        for ( unsigned int i = 0; i < pyramid.size(); ++i )
+        {
+            char name[ 64 ]; ::snprintf( name, sizeof( name ), ".strain.%u.csv", pyramid[ i ] );
+            output.push_back( field[ 0 ] + name );
+        }   // strain level tables of the coarser bins
+
+        if ( opt.Has( "histogram" ) )
+        {
+            output.push_back( field[ 0 ] + ".strain.bin" );
+        }   // the histograms are an output as well
+
+        c.AddText( "assign" ); c.AddFile( arg[ 0 ] ); c.AddFile( arg[ 1 ] );
+        c.AddOptions( opt.GetOptions(), "cache,cache-size,report,progress,numa,threads,max-memory,tmp-dir,panel" );
+
+        if ( opt.Has( "panel" ) )
+        {
+            c.AddFile( opt.Get( "panel" ) );
+        }   // the contents of the panel, not its name
+
+        if ( c.Fetch( output ) )
+        {
+            std::cout << "restored from cache: " << c.GetKey() << std::endl; return( 0 );
+        }   // the same inputs have been assigned before
+    }   // check the cache first
+
+    if ( incremental )
+    {
+        std::cout << "incremental assignment ..." << std::flush;
+        Delta d( table );               // reads affected by the changes of the table
+        d.SetThreshold( strain[ 0 ], index[ 0 ], identity[ 0 ] ); d.SetReport( report );
+        d.SetLineage( &lineage ); d.SetPyramid( width, pyramid );
+
+        if ( d.Run( arg[ 1 ] ) )
+        {
+            std::cout << " completed" << std::endl;
+
+            if ( !output.empty() && !c.Store( output ) )
+            {
+                std::cout << "unable to cache the outputs" << std::endl;
+            }   // keep the tables for the next run
+
+            if ( opt.Has( "report" ) )
+            {
+                r.Write( opt.Get( "report" ) );
+            }   // write the report at exit
+
+            return( 0 );
+        }   // the state of the previous run applies
+
+        std::cout << " not applicable" << std::endl;
+    }   // reuse the state of the previous run
+
+    std::cout << "processing file: " << arg[ 1 ] << std::endl;
     std::cout << "strain level assignment ..." << std::flush;
     Strain p( table );                  // strain level assignment
-    p.Run( argv[ 2 ] );
+    p.SetIdentity( strain[ 0 ] ); p.SetHistogram( opt.Has( "histogram" ) || incremental );
+    p.SetPyramid( width, pyramid );
+    p.SetBootstrap( replicate, level, opt.GetSize( "seed", 0 ) );
+    p.SetReport( report ); p.SetNuma( numa ); p.SetStore( opt.Has( "store" ) ); p.Run( arg[ 1 ] );
     std::cout << " completed" << std::endl;
 
+    if ( sweep )
+    {
+        std::cout << "threshold sweep ..." << std::flush;
+        Sweep s( table, p );            // every combination of the thresholds
+        s.SetGrid( strain, index, identity );
+        s.SetTables( opt.Has( "sweep-tables" ) );
+        s.SetReport( report );
+
+        if ( !s.Run( arg[ 1 ] ) )
+        {
+            std::cout << " unable to write the sweep" << std::endl; return( 1 );
+        }   // unreadable summary or unwritable directory
+
+        std::cout << " completed" << std::endl;
+
+        if ( opt.Has( "report" ) )
+        {
+            r.Write( opt.Get( "report" ) );
+        }   // write the report at exit
+
+        return( 0 );
+    }   // the species level assignment of all combinations
+
     std::cout << "species level assignment ..." << std::flush;
     Species q( table, p.GetIndex() );   // species level assignment
-    q.Run( argv[ 2 ] );
+    q.SetThreshold( index[ 0 ], identity[ 0 ] );
+    q.SetBootstrap( replicate, level, opt.GetSize( "seed", 0 ) );
+    q.SetMemory( opt.GetBytes( "max-memory", 0 ),
+        opt.Get( "tmp-dir", ( tmp ) ? tmp : "/tmp" ) );
+    q.SetReport( report ); q.SetNuma( numa ); q.SetLineage( &lineage ); q.Run( arg[ 1 ] );
     std::cout << " completed" << std::endl;
 
+    if ( incremental )
+    {
+        Delta d( table );               // state for the next run
+        d.SetThreshold( strain[ 0 ], index[ 0 ], identity[ 0 ] ); d.SetReport( report );
+        d.Save( q, arg[ 1 ] );
+    }   // the candidates of every read
+
+    if ( !output.empty() && !c.Store( output ) )
+    {
+        std::cout << "unable to cache the outputs" << std::endl;
+    }   // keep the tables for the next run
+
+    if ( opt.Has( "report" ) )
+    {
+        r.Write( opt.Get( "report" ) );
+    }   // write the report at exit
+
     return( 0 );
 }   // end of main()
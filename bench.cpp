@@ -0,0 +1,430 @@
+/*
+ * bench.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * throughput benchmark of the parser and the assignments
+ *
+ * every stage runs in a child process for every number of threads, so the
+ * peak resident set size reported by wait4() belongs to that stage alone.
+ * the child reports the elapsed time through a pipe. the species level
+ * assignment needs the weighted shannon indices; the child computes them
+ * first and only times the species level assignment itself. the results are
+ * written in json so runs can be compared over time.
+ *
+ * the getline and reader stages only read the lines of the alignment file,
+ * the former with std::ifstream and the latter with the read-ahead reader;
+ * with --cold, the inputs are evicted from the page cache before every run,
+ * so both stages read from the disk.
+ *
+ * with --bin-width, the parser and the assignments run once for every width
+ * of the histogram bins, each with its own summary, so the time and memory
+ * of every resolution are compared.
+ *
+ * to compile:
+ * g++ -I. -O3 -D_LIB_SAMTOOL bench.cpp samfile.cpp strain.cpp species.cpp lineage.cpp spill.cpp codec.cpp
+ *     store.cpp task.cpp report.cpp reader.cpp placement.cpp -o bench -fopenmp -lz
+*/
+
+#include <omp.h>
+#include <table.h>
+#include <reader.h>
+#include <option.h>
+#include <strain.h>
+#include <samfile.h>
+#include <species.h>
+
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <boost/algorithm/string.hpp>
+
+struct stBENCH
+{
+    std::string stage;      // name of the stage
+    unsigned int threads;   // number of threads
+    unsigned int width;     // width of the histogram bins
+    double seconds;         // elapsed time of the stage
+    double records;         // records read
+    double output;          // records written
+    double bytes;           // bytes read
+    double written;         // bytes written
+    long rss;               // peak resident set size in kilobytes
+};  // result of a single run
+
+static double Clock()
+{
+    struct timeval t; ::gettimeofday( &t, NULL );
+
+    return( t.tv_sec + t.tv_usec * 1e-6 );
+}   // end of Clock()
+
+static double GetBytes( const std::string& _f )
+{
+    struct stat s;
+
+    return( ( ::stat( _f.c_str(), &s ) == 0 ) ? static_cast<double>( s.st_size ) : 0.0 );
+}   // end of GetBytes()
+
+/*
+ * number of records in a file; lines of the sam header and the header of
+ * the csv files are not counted
+*/
+static double GetLines( const std::string& _f, const bool _sam )
+{
+    FILE* f = ::fopen( _f.c_str(), "r" );
+    double lines = 0.0;
+    int c;
+
+    if ( !f )
+    {
+        return( 0.0 );
+    }   // check the state of stream
+
+    for ( bool start = true; ( c = ::getc( f ) ) != EOF; start = ( c == '\n' ) )
+    {
+        if ( start )
+        {
+            lines += ( _sam && ( c == '@' ) ) ? 0.0 : 1.0;
+        }   // first character of a line
+    }   // count the lines
+
+    ::fclose( f );
+
+    return( ( !_sam && ( lines > 0.0 ) ) ? lines - 1.0 : lines );
+}   // end of GetLines()
+
+/*
+ * drop the pages of a file from the page cache; dirty pages are written
+ * first, since they cannot be evicted
+*/
+static void Evict( const std::string& _f )
+{
+    int fd = ::open( _f.c_str(), O_RDONLY );
+
+    if ( fd < 0 )
+    {
+        return;
+    }   // nothing to evict
+
+    ::fdatasync( fd );
+#ifdef POSIX_FADV_DONTNEED
+    ::posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+#endif
+    ::close( fd );
+}   // end of Evict()
+
+/*
+ * run a stage in the child process and return the elapsed time
+*/
+static double Stage(
+    const std::string& _s,
+    const std::map<unsigned int, stTABLE>& _t,
+    const std::string& _sam,
+    const std::string& _sum,
+    const bool _paired,
+    const unsigned int _w )
+{
+    double t = 0.0, lines = 0.0;
+
+    if ( _s == "getline" )
+    {
+        std::ifstream ifs( _sam.c_str(), std::ios::in );
+        char buffer[ 4096 ];
+
+        for ( t = Clock(); ifs.getline( buffer, sizeof( buffer ) ); lines += 1.0 )
+        {
+        }   // read the lines one by one
+    }   // lines of the alignments with the standard library
+
+    if ( _s == "reader" )
+    {
+        Reader ifs( _sam );
+        std::string block;
+        const char* p;
+
+        for ( t = Clock(); ifs.Next( block ); )
+        {
+            for ( p = block.data(); ( p = static_cast<const char*>(
+                ::memchr( p, '\n', block.data() + block.size() - p ) ) ); ++p )
+            {
+                lines += 1.0;
+            }   // every block ends with a newline
+        }   // read the blocks ahead of the consumer
+    }   // lines of the alignments with the read-ahead reader
+
+    if ( _s == "samfile" )
+    {
+        SamFile s; s.SetPaired( _paired ); s.SetWidth( _w );
+        t = Clock(); s.Run( _t, _sam, _sum );
+    }   // parse the alignments
+
+    if ( _s == "strain" )
+    {
+        Strain p( _t );
+        t = Clock(); p.Run( _sum );
+    }   // strain level assignment
+
+    if ( _s == "species" )
+    {
+        Strain p( _t ); p.Run( _sum );
+        Species q( _t, p.GetIndex() );
+        t = Clock(); q.Run( _sum );
+    }   // species level assignment
+
+    t = Clock() - t;
+
+    if ( lines > 0.0 )
+    {
+        ::printf( "%.0f lines\n", lines );
+    }   // the lines are used, so reading them is not optimized away
+
+    return( t );
+}   // end of Stage()
+
+/*
+ * fork the stage with the given number of threads
+*/
+static bool Fork(
+    stBENCH& _b,
+    const std::map<unsigned int, stTABLE>& _t,
+    const std::string& _sam,
+    const std::string& _sum,
+    const bool _paired )
+{
+    std::map<unsigned int, stTABLE> table = _t;
+    struct rusage u;
+    int fd[ 2 ], status;
+    pid_t pid;
+
+    if ( ::pipe( fd ) )
+    {
+        return( false );
+    }   // unable to create the pipe
+
+    ::fflush( stdout );     // the child must not repeat the buffered output
+
+    if ( ( pid = ::fork() ) == 0 )
+    {
+        ::close( fd[ 0 ] ); ::freopen( "/dev/null", "w", stdout );
+        omp_set_num_threads( _b.threads ); SetWidth( table, _b.width );
+        double t = Stage( _b.stage, table, _sam, _sum, _paired, _b.width );
+        ssize_t n = ::write( fd[ 1 ], &t, sizeof( t ) );
+        ::_exit( ( n == sizeof( t ) ) ? 0 : 1 );
+    }   // the child runs the stage
+
+    ::close( fd[ 1 ] );
+    bool ok = ( pid > 0 ) && ( ::read( fd[ 0 ], &_b.seconds, sizeof( double ) ) == sizeof( double ) );
+    ::close( fd[ 0 ] );
+
+    if ( pid > 0 )
+    {
+        ::wait4( pid, &status, 0, &u ); _b.rss = u.ru_maxrss;
+        ok = ok && WIFEXITED( status ) && !WEXITSTATUS( status );
+    }   // collect the child
+
+    return( ok );
+}   // end of Fork()
+
+/*
+ * driver program
+ *
+ * required parameters:
+ * translation table
+ * alignment file in the sam format
+ * results in json
+ *
+ * optional parameters:
+ * --threads=1,2,4  numbers of threads; default powers of two up to the cores
+ * --stages=samfile,strain,species  stages to be run; default all
+ * --repeat=N       runs of every stage; the fastest is reported; default 1
+ * --paired         merge concordant mates in the parser
+ * --cold           evict the inputs from the page cache before every run
+ *                  stages getline and reader compare the line readers
+ * --bin-width=1000,10000   widths of the histogram bins; default 1000. the
+ *                  summary of every other width, sample.W.summary.csv, is
+ *                  written first if samfile is not one of the stages
+*/
+int main( int argc, char** argv )
+{
+    Option opt( argc, argv, "threads,stages,repeat,bin-width" );
+    const std::vector<std::string>& arg = opt.GetArgs();
+    std::map<unsigned int, stTABLE> table;
+    std::vector<std::string> field, stage;
+    std::vector<unsigned int> thread;
+    std::vector<stBENCH> result;
+    std::string base, summary;
+    std::string threads = opt.Get( "threads", "" ), stages = opt.Get( "stages", "samfile,strain,species" );
+    char stamp[ 64 ], host[ 256 ] = "unknown", name[ 64 ];
+
+    if ( arg.size() < 3 )
+    {
+        ::fprintf( stderr, "usage: bench [options] translate.csv sample.sam bench.json\n" );
+        return( 1 );
+    }   // check the number of parameters
+
+    if ( !LoadTable( arg[ 0 ], table ) )
+    {
+        return( 1 );
+    }   // load the translation table
+
+    boost::algorithm::split( field, arg[ 1 ], boost::algorithm::is_any_of( "." ) );
+    base = field[ 0 ]; summary = base + ".summary.csv";
+
+    boost::algorithm::split( field, threads, boost::algorithm::is_any_of( "," ) );
+
+    for ( unsigned int i = 0; i < field.size(); ++i )
+    {
+        if ( ::atoi( field[ i ].c_str() ) > 0 )
+        {
+            thread.push_back( ::atoi( field[ i ].c_str() ) );
+        }   // ignore malformed numbers
+    }   // requested numbers of threads
+
+    for ( int i = 1; threads.empty() && ( i < omp_get_num_procs() ); i *= 2 )
+    {
+        thread.push_back( i );
+    }   // powers of two below the number of cores
+
+    if ( thread.empty() || threads.empty() )
+    {
+        thread.push_back( omp_get_num_procs() );
+    }   // the last step is the number of cores
+
+    boost::algorithm::split( stage, stages, boost::algorithm::is_any_of( "," ) );
+    unsigned int repeat = std::max<unsigned int>( 1, opt.GetSize( "repeat", 1 ) );
+    std::vector<double> width = opt.GetReals( "bin-width", nBinWIDTH );
+
+    for ( unsigned int w = 0; w < width.size(); ++w )
+    {
+        ::snprintf( name, sizeof( name ), ".%.0f", width[ w ] );
+        summary = base + ( ( width[ w ] == nBinWIDTH ) ? "" : name ) + ".summary.csv";
+
+        if ( ( std::find( stage.begin(), stage.end(), "samfile" ) == stage.end() ) && !( width[ w ] == nBinWIDTH ) )
+        {
+            stBENCH b;
+            b.stage = "samfile"; b.threads = thread.back(); b.width = static_cast<unsigned int>( width[ w ] );
+
+            if ( !Fork( b, table, arg[ 1 ], summary, opt.Has( "paired" ) ) )
+            {
+                ::fprintf( stderr, "bench: summary of width %.0f failed\n", width[ w ] ); return( 1 );
+            }   // the summary could not be written
+        }   // the summary of the width is written first
+
+        for ( unsigned int i = 0; i < stage.size(); ++i )
+        {
+            for ( unsigned int j = 0; j < thread.size(); ++j )
+            {
+                stBENCH b;
+                b.stage = stage[ i ]; b.threads = thread[ j ]; b.rss = 0;
+                b.width = static_cast<unsigned int>( width[ w ] );
+                double best = 0.0; long rss = 0;
+
+                for ( unsigned int k = 0; k < repeat; ++k )
+                {
+                    if ( opt.Has( "cold" ) )
+                    {
+                        Evict( arg[ 1 ] ); Evict( summary );
+                    }   // read the inputs from the disk
+
+                    if ( !Fork( b, table, arg[ 1 ], summary, opt.Has( "paired" ) ) )
+                    {
+                        ::fprintf( stderr, "bench: stage %s failed\n", b.stage.c_str() ); return( 1 );
+                    }   // the stage did not complete
+
+                    best = ( k == 0 ) ? b.seconds : std::min( best, b.seconds );
+                    rss = std::max( rss, b.rss );
+                }   // keep the fastest run
+
+                b.seconds = best; b.rss = rss;
+
+                if ( ( b.stage == "samfile" ) || ( b.stage == "getline" ) || ( b.stage == "reader" ) )
+                {
+                    b.records = GetLines( arg[ 1 ], true ); b.bytes = GetBytes( arg[ 1 ] );
+                    b.output = 0.0; b.written = 0.0;
+                }   // the alignments are read
+
+                if ( b.stage == "samfile" )
+                {
+                    b.output = GetLines( summary, false ); b.written = GetBytes( summary );
+                }   // alignments to summary
+
+                if ( b.stage == "strain" )
+                {
+                    b.records = GetLines( summary, false ); b.bytes = GetBytes( summary );
+                    b.output = GetLines( base + ".strain.csv", false );
+                    b.written = GetBytes( base + ".strain.csv" );
+                }   // summary to strain indices
+
+                if ( b.stage == "species" )
+                {
+                    b.records = GetLines( summary, false ); b.bytes = GetBytes( summary );
+                    b.output = GetLines( base + ".assign.csv", false );
+                    b.written = GetBytes( base + ".assign.csv" ) + GetBytes( base + ".pivot.csv" );
+                }   // summary to species assignments
+
+                result.push_back( b );
+                ::printf( "%-8s %7u bp %3d threads %9.3f s %12.0f rec/s %9.2f MB/s %9ld KB\n",
+                    b.stage.c_str(), b.width, b.threads, b.seconds, b.records / std::max( b.seconds, 1e-9 ),
+                    b.bytes / std::max( b.seconds, 1e-9 ) / 1048576.0, b.rss );
+            }   // every number of threads
+        }   // every stage
+    }   // every width of the bins
+
+    time_t now = ::time( NULL );
+    ::strftime( stamp, sizeof( stamp ), "%Y-%m-%dT%H:%M:%S", ::localtime( &now ) );
+    ::gethostname( host, sizeof( host ) - 1 );
+
+    FILE* of = ::fopen( arg[ 2 ].c_str(), "w" );
+
+    if ( !of )
+    {
+        return( 1 );
+    }   // unable to write the results
+
+    ::fprintf( of, "{\n  \"date\": \"%s\",\n  \"host\": \"%s\",\n  \"cores\": %d,\n", stamp, host, omp_get_num_procs() );
+    ::fprintf( of, "  \"table\": \"%s\",\n  \"input\": \"%s\",\n  \"bytes\": %.0f,\n  \"paired\": %s,\n  \"cold\": %s,\n  \"repeat\": %d,\n",
+        arg[ 0 ].c_str(), arg[ 1 ].c_str(), GetBytes( arg[ 1 ] ), ( opt.Has( "paired" ) ) ? "true" : "false",
+        ( opt.Has( "cold" ) ) ? "true" : "false", repeat );
+    ::fprintf( of, "  \"results\": [\n" );
+
+    for ( unsigned int i = 0; i < result.size(); ++i )
+    {
+        const stBENCH& b = result[ i ];
+        double base = b.seconds;
+
+        for ( unsigned int j = 0; j < result.size(); ++j )
+        {
+            base = ( ( result[ j ].stage == b.stage ) && ( result[ j ].width == b.width ) &&
+                ( result[ j ].threads == thread[ 0 ] ) ) ? result[ j ].seconds : base;
+        }   // time of the first number of threads
+
+        ::fprintf( of, "    {\"stage\": \"%s\", \"bin_width\": %u, \"threads\": %d, \"seconds\": %.6f, "
+            "\"records_in\": %.0f, \"records_out\": %.0f, \"bytes_in\": %.0f, \"bytes_out\": %.0f, "
+            "\"records_per_second\": %.1f, \"bytes_per_second\": %.1f, \"peak_rss_kb\": %ld, \"speedup\": %.3f}%s\n",
+            b.stage.c_str(), b.width, b.threads, b.seconds, b.records, b.output, b.bytes, b.written,
+            b.records / std::max( b.seconds, 1e-9 ), b.bytes / std::max( b.seconds, 1e-9 ), b.rss,
+            base / std::max( b.seconds, 1e-9 ), ( i + 1 < result.size() ) ? "," : "" );
+    }   // every run
+
+    ::fprintf( of, "  ]\n}\n" ); ::fclose( of );
+
+    return( 0 );
+}   // end of main()
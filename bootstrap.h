@@ -0,0 +1,68 @@
+/*
+ * bootstrap.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * percentile confidence intervals of bootstrap replicates
+ *
+ * the replicates resample with poisson weights, i.e., every unit, a read or
+ * a bin, counts k times with k drawn from a poisson distribution with mean
+ * 1. replicate b draws from its own stream, seeded with the seed and b, so
+ * the intervals do not depend on the number of threads.
+*/
+
+#ifndef _BOOTSTRAP_H
+#define _BOOTSTRAP_H
+
+#include <random.h>
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+struct stBOUND
+{
+    double low;             // lower bound of the interval
+    double high;            // upper bound of the interval
+};  // confidence interval
+
+/*
+ * random number stream of a replicate
+*/
+inline Random Replicate(
+    const uint64_t _s,          // seed of the bootstrap
+    const unsigned int _b )     // replicate
+{
+    return( Random( _s + 0x9e3779b97f4a7c15ULL * ( _b + 1 ) ) );
+}   // end of Replicate()
+
+/*
+ * percentile interval of the replicates at the given confidence level; the
+ * replicates are sorted in place
+*/
+inline stBOUND Bound(
+    std::vector<double>& _v,    // replicates
+    const double _c )           // confidence level, e.g., 0.95
+{
+    stBOUND b = { 0.0, 0.0 };
+    double tail = ( 1.0 - _c ) / 2.0;
+
+    if ( _v.empty() )
+    {
+        return( b );
+    }   // no replicates
+
+    std::sort( _v.begin(), _v.end() );
+    b.low = _v[ static_cast<size_t>( tail * ( _v.size() - 1 ) + 0.5 ) ];
+    b.high = _v[ static_cast<size_t>( ( 1.0 - tail ) * ( _v.size() - 1 ) + 0.5 ) ];
+
+    return( b );
+}   // end of Bound()
+
+#endif  // _BOOTSTRAP_H
@@ -0,0 +1,356 @@
+/*
+ * cache.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * content-addressed cache of the output files
+*/
+
+#include <hash.h>
+#include <cache.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+
+/*
+ * version of the outputs; changed whenever the same inputs give different
+ * outputs. the executable itself is also part of the key
+ * size of the blocks hashed by the threads
+*/
+static const char* szVERSION = "mcat-cache-1";
+static const off_t nBLOCK = 8 << 20;
+
+Cache::Cache(
+    const std::string& _p,      // directory of the cache
+    const size_t _l )           // size limit in bytes; 0 is unlimited
+{
+    struct stat s;
+
+    mPath = _p; mLimit = _l; mValid = !_p.empty();
+    mKey = Hash64( szVERSION, ::strlen( szVERSION ) );
+
+    if ( !::stat( "/proc/self/exe", &s ) )
+    {
+        mKey = Mix64( mKey ^ Mix64( s.st_size ) ^ Mix64( s.st_mtime ) );
+    }   // a rebuilt program does not use the entries of the old one
+
+    if ( mValid && ::mkdir( mPath.c_str(), 0755 ) && !( errno == EEXIST ) )
+    {
+        mValid = false;
+    }   // unable to create the directory
+}   // default constructor
+
+Cache::~Cache()
+{
+    mPath.clear();
+}   // default destructor; environmentally conscientious
+
+/*
+ * add the contents of an input file to the key; only regular files can be
+ * hashed before they are read, so a fifo or the standard input disables
+ * the cache
+*/
+bool Cache::AddFile( const std::string& _f )
+{
+    int fd = ::open( _f.c_str(), O_RDONLY );
+    struct stat s;
+
+    if ( ( fd < 0 ) || ::fstat( fd, &s ) || !S_ISREG( s.st_mode ) )
+    {
+        if ( !( fd < 0 ) )
+        {
+            ::close( fd );
+        }   // not a regular file
+
+        mValid = false; return( false );
+    }   // unable to hash the file
+
+    mKey = Mix64( mKey ^ Hash( fd, s.st_size ) ); ::close( fd );
+
+    return( mValid );
+}   // end of AddFile()
+
+/*
+ * add a string, e.g., the name of the program, to the key
+*/
+void Cache::AddText( const std::string& _s )
+{
+    mKey = Mix64( mKey ^ Hash64( _s.data(), _s.size() ) );
+}   // end of AddText()
+
+/*
+ * add the options to the key, except those that do not change the outputs,
+ * e.g., the instrumentation; the options are in order of their names
+*/
+void Cache::AddOptions(
+    const std::map<std::string, std::string>& _o,  // options of the program
+    const std::string& _x )                         // comma separated options ignored
+{
+    std::vector<std::string> ignore;
+    boost::algorithm::split( ignore, _x, boost::algorithm::is_any_of( "," ) );
+
+    for ( std::map<std::string, std::string>::const_iterator i = _o.begin(); !( i == _o.end() ); ++i )
+    {
+        if ( std::find( ignore.begin(), ignore.end(), ( *i ).first ) == ignore.end() )
+        {
+            AddText( "--" + ( *i ).first + "=" + ( *i ).second );
+        }   // the option changes the outputs
+    }   // every option
+}   // end of AddOptions()
+
+/*
+ * key of the inputs in hex; the name of the entry
+*/
+std::string Cache::GetKey() const
+{
+    char key[ 24 ];
+
+    ::snprintf( key, sizeof( key ), "%016llx", static_cast<unsigned long long>( mKey ) );
+
+    return( key );
+}   // end of GetKey()
+
+/*
+ * restore the outputs of an entry; false if there is no entry of the key
+*/
+bool Cache::Fetch( const std::vector<std::string>& _o )    // output files
+{
+    const std::string entry = mPath + "/" + GetKey();
+    char name[ 16 ];
+    bool done = mValid;
+
+    for ( unsigned int i = 0; done && ( i < _o.size() ); ++i )
+    {
+        ::snprintf( name, sizeof( name ), "/%u", i );
+        done = Copy( entry + name, _o[ i ] + ".tmp" );
+    }   // restore the outputs to temporary files
+
+    for ( unsigned int i = 0; i < _o.size(); ++i )
+    {
+        ( done ) ? ::rename( ( _o[ i ] + ".tmp" ).c_str(), _o[ i ].c_str() ) :
+            ::unlink( ( _o[ i ] + ".tmp" ).c_str() );
+    }   // all outputs appear, or none of them
+
+    if ( done )
+    {
+        ::utime( entry.c_str(), NULL );
+    }   // the entry is the most recently used
+
+    return( done );
+}   // end of Fetch()
+
+/*
+ * keep the outputs of a run as the entry of the key
+*/
+bool Cache::Store( const std::vector<std::string>& _o )    // output files
+{
+    std::string temp = mPath + "/tmp.XXXXXX";
+    const std::string entry = mPath + "/" + GetKey();
+    char name[ 16 ];
+    struct stat s;
+    bool done = mValid && ::mkdtemp( &temp[ 0 ] );
+
+    for ( unsigned int i = 0; done && ( i < _o.size() ); ++i )
+    {
+        ::snprintf( name, sizeof( name ), "/%u", i );
+        done = !::stat( _o[ i ].c_str(), &s ) && S_ISREG( s.st_mode ) && Copy( _o[ i ], temp + name );
+    }   // copy the outputs; a fifo or the standard output is not kept
+
+    if ( !done || ::rename( temp.c_str(), entry.c_str() ) )
+    {
+        Remove( temp ); return( false );
+    }   // incomplete, or another run stored the entry first
+
+    Evict();
+
+    return( true );
+}   // end of Store()
+
+/*
+ * remove the least recently used entries until the cache fits its limit
+*/
+void Cache::Evict() const
+{
+    std::vector<stENTRY> entry;
+    DIR* dir = ::opendir( mPath.c_str() );
+    struct dirent* d;
+    struct stat s;
+    off_t total = 0;
+
+    if ( !( mLimit > 0 ) || ( dir == NULL ) )
+    {
+        if ( dir )
+        {
+            ::closedir( dir );
+        }   // nothing to evict
+
+        return;
+    }   // unlimited or unable to read the directory
+
+    while ( ( d = ::readdir( dir ) ) )
+    {
+        stENTRY e; e.name = mPath + "/" + d->d_name;
+
+        if ( !( ::strlen( d->d_name ) == 16 ) || ::stat( e.name.c_str(), &s ) || !S_ISDIR( s.st_mode ) )
+        {
+            continue;
+        }   // not an entry; temporary entries are removed by their runs
+
+        e.used = s.st_mtime; e.size = 0;
+
+        for ( unsigned int i = 0; ; ++i )
+        {
+            char name[ 16 ];
+            ::snprintf( name, sizeof( name ), "/%u", i );
+
+            if ( ::stat( ( e.name + name ).c_str(), &s ) )
+            {
+                break;
+            }   // no more outputs
+
+            e.size += s.st_size;
+        }   // every output of the entry
+
+        total += e.size; entry.push_back( e );
+    }   // every entry of the cache
+
+    ::closedir( dir );
+    std::sort( entry.begin(), entry.end(), SortUsed() );
+
+    for ( unsigned int i = 0; ( i < entry.size() ) && ( total > static_cast<off_t>( mLimit ) ); ++i )
+    {
+        Remove( entry[ i ].name ); total -= entry[ i ].size;
+    }   // least recently used first
+}   // end of Evict()
+
+/*
+ * hash of the contents of a file; every thread reads and hashes its own
+ * blocks, and the hashes of the blocks are combined in the order of the file
+*/
+uint64_t Cache::Hash(
+    const int _f,               // descriptor of the file
+    const off_t _n )            // size of the file
+{
+    const long count = static_cast<long>( ( _n + nBLOCK - 1 ) / nBLOCK );
+    std::vector<uint64_t> block( count, 0 );
+    uint64_t key = Mix64( static_cast<uint64_t>( _n ) );
+
+    #pragma omp parallel
+    {
+        std::vector<char> buffer( nBLOCK );
+        ssize_t n;
+        off_t have, size;
+
+        #pragma omp for schedule( dynamic )
+        for ( long i = 0; i < count; ++i )
+        {
+            size = std::min<off_t>( nBLOCK, _n - i * nBLOCK );
+
+            for ( have = 0; have < size; have += n )
+            {
+                if ( ( n = ::pread( _f, &buffer[ have ], size - have, i * nBLOCK + have ) ) <= 0 )
+                {
+                    if ( ( n < 0 ) && ( errno == EINTR ) )
+                    {
+                        n = 0; continue;
+                    }   // interrupted by a signal
+
+                    break;
+                }   // the file changed while it was read
+            }   // read the whole block
+
+            block[ i ] = Hash64( &buffer[ 0 ], have, static_cast<uint64_t>( i ) );
+        }   // every block of the file
+    }   // end of the parallel section
+
+    for ( long i = 0; i < count; ++i )
+    {
+        key = Mix64( key ^ block[ i ] );
+    }   // combine the blocks in order
+
+    return( key );
+}   // end of Hash()
+
+/*
+ * copy a file with its modification time, so an output that records the
+ * time of another, e.g., the store of samfile, still matches it
+*/
+bool Cache::Copy(
+    const std::string& _s,      // source
+    const std::string& _d )     // destination
+{
+    FILE* ifs = ::fopen( _s.c_str(), "rb" );
+    FILE* ofs = ( ifs ) ? ::fopen( _d.c_str(), "wb" ) : NULL;
+    std::vector<char> buffer( 1 << 20 );
+    struct timespec t[ 2 ];
+    struct stat s;
+    size_t n;
+    bool done = ( ofs != NULL );
+
+    while ( done && ( ( n = ::fread( &buffer[ 0 ], 1, buffer.size(), ifs ) ) > 0 ) )
+    {
+        done = ( ::fwrite( &buffer[ 0 ], 1, n, ofs ) == n );
+    }   // copy the contents
+
+    done = done && !::ferror( ifs );
+
+    if ( ifs )
+    {
+        ::fclose( ifs );
+    }   // the source has been opened
+
+    if ( ofs && ::fclose( ofs ) )
+    {
+        done = false;
+    }   // unable to write the destination
+
+    if ( done && !::stat( _s.c_str(), &s ) )
+    {
+        t[ 0 ].tv_sec = 0; t[ 0 ].tv_nsec = UTIME_NOW; t[ 1 ] = s.st_mtim;
+        ::utimensat( AT_FDCWD, _d.c_str(), t, 0 );
+    }   // the modification time of the source
+
+    return( done );
+}   // end of Copy()
+
+/*
+ * remove an entry and its outputs
+*/
+void Cache::Remove( const std::string& _e )
+{
+    DIR* dir = ::opendir( _e.c_str() );
+    struct dirent* d;
+    struct stat s;
+    std::string name;
+
+    while ( dir && ( d = ::readdir( dir ) ) )
+    {
+        name = _e + "/" + d->d_name;
+
+        if ( !::lstat( name.c_str(), &s ) && S_ISREG( s.st_mode ) )
+        {
+            ::unlink( name.c_str() );
+        }   // outputs of the entry
+    }   // every file of the entry
+
+    if ( dir )
+    {
+        ::closedir( dir );
+    }   // the entry has been opened
+
+    ::rmdir( _e.c_str() );
+}   // end of Remove()
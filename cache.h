@@ -0,0 +1,84 @@
+/*
+ * cache.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * content-addressed cache of the output files
+ *
+ * the key of a run is a 64-bit hash of the contents of its input files, its
+ * options and the version of the program, i.e., the size and modification
+ * time of the executable. the files are hashed in blocks of 8 MB by all
+ * threads at once, and the hashes of the blocks combined in order, so that
+ * checking the cache costs a fraction of the run.
+ *
+ * every entry is a directory named after the key, holding the outputs as
+ * 0, 1, ... in the order given by the program. an entry is written under a
+ * temporary name and renamed, and the outputs are restored to temporary
+ * files and renamed, so that concurrent runs never see partial files. a hit
+ * touches the entry; once the entries exceed the size limit, the least
+ * recently used ones are removed.
+*/
+
+#ifndef _CACHE_H
+#define _CACHE_H
+
+#include <map>
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+class Cache
+{
+public:
+    Cache(
+        const std::string&,     // directory of the cache
+        const size_t );         // size limit in bytes; 0 is unlimited
+    ~Cache();
+
+    bool AddFile( const std::string& );
+    void AddText( const std::string& );
+    void AddOptions( const std::map<std::string, std::string>&, const std::string& );
+    bool Fetch( const std::vector<std::string>& );
+    bool Store( const std::vector<std::string>& );
+
+    std::string GetKey() const;
+
+private:
+    std::string mPath;      // directory of the cache
+    size_t mLimit;          // size limit in bytes; 0 is unlimited
+    uint64_t mKey;          // hash of the inputs so far
+    bool mValid;            // every input could be hashed
+
+    struct stENTRY
+    {
+        std::string name;   // directory of the entry
+        time_t used;        // last time the entry was written or restored
+        off_t size;         // total size of the outputs
+    };  // an entry of the cache
+
+    /*
+     * sorting criteria for the eviction
+     * 1. least recently used first
+    */
+    struct SortUsed
+    {
+        bool operator()( const stENTRY& _a, const stENTRY& _b ) const
+        {
+            return( _a.used < _b.used );
+        }   // end of operator overloading
+    };  // end of class SortUsed
+
+    void Evict() const;
+    static uint64_t Hash( const int, const off_t );
+    static bool Copy( const std::string&, const std::string& );
+    static void Remove( const std::string& );
+};  // end of class definition
+
+#endif  // _CACHE_H
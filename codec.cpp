@@ -0,0 +1,255 @@
+/*
+ * codec.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * compact keys of the read identifications
+*/
+
+#include <codec.h>
+
+#include <cstring>
+#include <algorithm>
+
+/*
+ * prefix of the verbatim names; values of 5 and 6 digits with the end of
+ * the field; mask of the lane, tile and coordinates
+*/
+static const unsigned int nVERBATIM = 31;
+static const uint64_t nDIGIT5 = 161051ULL;      // 11^5
+static const uint64_t nDIGIT6 = 1771561ULL;     // 11^6
+static const uint64_t nMaxCODE = ( 1ULL << 59 ) - 1;
+
+Codec::Codec()
+{
+    mPrefix.clear(); mFind.clear(); mVerbatim.clear(); mName.clear(); mLast = 0;
+}   // default constructor
+
+Codec::~Codec()
+{
+    mPrefix.clear(); mFind.clear(); mVerbatim.clear(); mName.clear();
+}   // default destructor; environmentally conscientious
+
+/*
+ * key of a read identification
+*/
+uint64_t Codec::Encode( const std::string& _s )
+{
+    return( Encode( _s.data(), _s.size() ) );
+}   // end of Encode()
+
+uint64_t Codec::Encode(
+    const char* _s,             // read identification
+    const size_t _n )           // length of the identification
+{
+    const char* end = _s + _n;
+    const char* colon[ 6 ];
+    unsigned int n = 0, id;
+    uint64_t lane, tile, x, y;
+    std::map<std::string, unsigned int>::iterator k;
+
+    if ( ( _n > 1 ) && ( *_s == '"' ) && ( *( end - 1 ) == '"' ) )
+    {
+        --end;
+    }   // quoted by samfile; the quotes are part of the name
+
+    for ( const char* p = _s; p < end; ++p )
+    {
+        if ( !( *p == ':' ) )
+        {
+            continue;
+        }   // not a separator
+
+        if ( n == 6 )
+        {
+            return( Verbatim( _s, _n ) );
+        }   // more than seven fields
+
+        colon[ n++ ] = p;
+    }   // positions of the separators
+
+    if ( !( n == 6 ) || !Digits( colon[ 2 ] + 1, colon[ 3 ], 1, false, lane ) ||
+        !Digits( colon[ 3 ] + 1, colon[ 4 ], 5, false, tile ) ||
+        !Digits( colon[ 4 ] + 1, colon[ 5 ], 5, false, x ) ||
+        !Digits( colon[ 5 ] + 1, end, 6, true, y ) || ( ( *_s == '"' ) && ( end == _s + _n ) ) )
+    {
+        return( Verbatim( _s, _n ) );
+    }   // not an illumina name
+
+    const size_t size = colon[ 2 ] + 1 - _s;
+
+    if ( ( mLast < mPrefix.size() ) && ( mPrefix[ mLast ].size() == size ) &&
+        !::memcmp( mPrefix[ mLast ].data(), _s, size ) )
+    {
+        id = mLast;
+    }   // the same prefix as the last name
+    else if ( !( ( k = mFind.find( std::string( _s, size ) ) ) == mFind.end() ) )
+    {
+        id = mLast = ( *k ).second;
+    }   // a known prefix
+    else if ( mPrefix.size() < nVERBATIM )
+    {
+        id = mLast = mPrefix.size();
+        mPrefix.push_back( std::string( _s, size ) ); mFind[ mPrefix.back() ] = id;
+    }   // a new prefix
+    else
+    {
+        return( Verbatim( _s, _n ) );
+    }   // too many prefixes
+
+    return( ( static_cast<uint64_t>( id ) << 59 ) | ( ( ( lane * nDIGIT5 + tile ) * nDIGIT5 + x ) * nDIGIT6 + y ) );
+}   // end of Encode()
+
+/*
+ * rebuild the read identification of a key
+*/
+void Codec::Decode(
+    const uint64_t _k,          // key
+    std::string& _s ) const     // read identification
+{
+    const unsigned int id = static_cast<unsigned int>( _k >> 59 );
+    uint64_t code = _k & nMaxCODE, lane, tile, x, y;
+
+    if ( id == nVERBATIM )
+    {
+        _s = *mName[ code ]; return;
+    }   // name kept as is
+
+    y = code % nDIGIT6; code /= nDIGIT6;
+    x = code % nDIGIT5; code /= nDIGIT5;
+    tile = code % nDIGIT5; lane = code / nDIGIT5;
+
+    _s = mPrefix[ id ];
+    Append( lane, 1, false, _s ); _s.push_back( ':' );
+    Append( tile, 5, false, _s ); _s.push_back( ':' );
+    Append( x, 5, false, _s ); _s.push_back( ':' );
+    Append( y, 6, true, _s );
+
+    if ( mPrefix[ id ][ 0 ] == '"' )
+    {
+        _s.push_back( '"' );
+    }   // closing quote
+}   // end of Decode()
+
+/*
+ * compare two keys the way their names compare
+*/
+int Codec::Compare(
+    const uint64_t _a,
+    const uint64_t _b ) const
+{
+    const unsigned int a = static_cast<unsigned int>( _a >> 59 );
+    const unsigned int b = static_cast<unsigned int>( _b >> 59 );
+    std::string s, t;
+
+    if ( ( a == b ) && ( a < nVERBATIM ) )
+    {
+        return( ( _a < _b ) ? -1 : ( ( _b < _a ) ? 1 : 0 ) );
+    }   // the same prefix; the keys are ordered as the names
+
+    if ( ( a < nVERBATIM ) && ( b < nVERBATIM ) )
+    {
+        return( mPrefix[ a ].compare( mPrefix[ b ] ) );
+    }   // prefixes end with ':', so they decide
+
+    Decode( _a, s ); Decode( _b, t );
+
+    return( s.compare( t ) );
+}   // end of Compare()
+
+/*
+ * exchange the dictionaries; the keys remain valid with the other codec
+*/
+void Codec::swap( Codec& _c )
+{
+    mPrefix.swap( _c.mPrefix ); mFind.swap( _c.mFind );
+    mVerbatim.swap( _c.mVerbatim ); mName.swap( _c.mName );
+    std::swap( mLast, _c.mLast );
+}   // end of swap()
+
+/*
+ * key of a name that does not fit; the same name always gets the same key
+*/
+uint64_t Codec::Verbatim(
+    const char* _s,
+    const size_t _n )
+{
+    std::map<std::string, uint64_t>::iterator k = mVerbatim.find( std::string( _s, _n ) );
+
+    if ( k == mVerbatim.end() )
+    {
+        k = mVerbatim.insert( std::make_pair( std::string( _s, _n ),
+            ( static_cast<uint64_t>( nVERBATIM ) << 59 ) | mName.size() ) ).first;
+        mName.push_back( &( *k ).first );
+    }   // a new name
+
+    return( ( *k ).second );
+}   // end of Verbatim()
+
+/*
+ * digits of a field; every digit takes one of 11 values. the end of a
+ * field sorts above the digits and the end of the name below them
+*/
+bool Codec::Digits(
+    const char* _b,             // first character of the field
+    const char* _e,             // end of the field
+    const unsigned int _w,      // maximum number of digits
+    const bool _l,              // last field of the name
+    uint64_t& _v )              // value of the digits
+{
+    const size_t n = _e - _b;
+    _v = 0;
+
+    if ( ( n < 1 ) || ( n > _w ) )
+    {
+        return( false );
+    }   // empty or too long
+
+    for ( unsigned int i = 0; i < _w; ++i )
+    {
+        if ( ( i < n ) && ( ( _b[ i ] < '0' ) || ( _b[ i ] > '9' ) ) )
+        {
+            return( false );
+        }   // not a number
+
+        _v = _v * 11 + ( ( i < n ) ? ( _b[ i ] - '0' + ( ( _l ) ? 1 : 0 ) ) : ( ( _l ) ? 0 : 10 ) );
+    }   // every digit and the end of the field
+
+    return( true );
+}   // end of Digits()
+
+/*
+ * append the digits of a field
+*/
+void Codec::Append(
+    uint64_t _v,                // value of the digits
+    const unsigned int _w,      // maximum number of digits
+    const bool _l,              // last field of the name
+    std::string& _s )
+{
+    char digit[ 8 ];
+    unsigned int c;
+
+    for ( unsigned int i = _w; i > 0; --i )
+    {
+        digit[ i - 1 ] = static_cast<char>( _v % 11 ); _v /= 11;
+    }   // most significant digit first
+
+    for ( unsigned int i = 0; i < _w; ++i )
+    {
+        c = static_cast<unsigned int>( digit[ i ] );
+
+        if ( ( _l ) ? ( c == 0 ) : ( c == 10 ) )
+        {
+            break;
+        }   // end of the field
+
+        _s.push_back( static_cast<char>( '0' + c - ( ( _l ) ? 1 : 0 ) ) );
+    }   // every digit
+}   // end of Append()
@@ -0,0 +1,84 @@
+/*
+ * codec.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * compact keys of the read identifications
+ *
+ * illumina names, instrument:run:flowcell:lane:tile:x:y, optionally in
+ * quotes as written by samfile, are turned into 64-bit keys. the prefix,
+ * instrument:run:flowcell, is kept once in a dictionary shared by all reads;
+ * the lane, tile and coordinates are stored as their digits, at most 1, 5,
+ * 5 and 6 of them, so leading zeros survive and the name is rebuilt
+ * exactly. every digit takes one of 11 values, with the end of a field
+ * above the digits, as ':' is, and the end of the name below them, so keys
+ * of the same prefix are ordered as the names themselves. keys of
+ * different prefixes are ordered by their prefixes; maps of keys thus
+ * return the reads in the same order as maps of names.
+ *
+ * key: prefix (5 bits), lane, tile, x and y (59 bits); prefix 31 holds the
+ * names that do not fit, verbatim, in a second dictionary. at most 31
+ * prefixes are encoded; further prefixes are kept verbatim as well.
+*/
+
+#ifndef _CODEC_H
+#define _CODEC_H
+
+#include <map>
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+class Codec
+{
+public:
+    Codec();
+    ~Codec();
+
+    uint64_t Encode( const char*, const size_t );
+    uint64_t Encode( const std::string& );
+    void Decode( const uint64_t, std::string& ) const;
+    int Compare( const uint64_t, const uint64_t ) const;
+    void swap( Codec& );
+
+    /*
+     * ordering of the keys for maps and sorting; the same as the ordering of
+     * the names
+    */
+    struct Order
+    {
+        Order( const Codec* _c = NULL ) : codec( _c )
+        {
+        }   // default constructor
+
+        bool operator()( const uint64_t _a, const uint64_t _b ) const
+        {
+            return( ( ( _a >> 59 ) == ( _b >> 59 ) ) && ( ( _a >> 59 ) < 31 ) ?
+                ( _a < _b ) : ( codec->Compare( _a, _b ) < 0 ) );
+        }   // end of operator overloading
+
+        const Codec* codec;
+    };  // end of class Order
+
+private:
+    std::vector<std::string> mPrefix;           // prefixes with the trailing ':'
+    std::map<std::string, unsigned int> mFind;  // number of each prefix
+    std::map<std::string, uint64_t> mVerbatim;  // names that do not fit
+    std::vector<const std::string*> mName;      // verbatim names by number
+    unsigned int mLast;     // prefix of the last name; most names share it
+
+    Codec( const Codec& );              // the dictionaries are not copied
+    Codec& operator=( const Codec& );
+
+    uint64_t Verbatim( const char*, const size_t );
+    static bool Digits( const char*, const char*, const unsigned int, const bool, uint64_t& );
+    static void Append( uint64_t, const unsigned int, const bool, std::string& );
+};  // end of class definition
+
+#endif  // _CODEC_H
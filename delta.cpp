@@ -0,0 +1,583 @@
+/*
+ * delta.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * incremental assignment after a change of the translation table
+*/
+
+#include <token.h>
+#include <reader.h>
+#include <delta.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+#include <boost/algorithm/string.hpp>
+
+/*
+ * identification and version of the state file
+ * a read without an assignment
+*/
+static const char* szMAGIC = "MCATREAD";
+static const uint32_t nVERSION = 1;
+static const uint32_t nNONE = static_cast<uint32_t>( -1 );
+
+Delta::Delta(
+    const std::map<unsigned int, stTABLE>& _t ) : mTable( _t )
+{
+    unsigned int block;
+
+    mBlock.clear(); mReport = NULL; mLineage = NULL; mWidth = nBinWIDTH;
+    mIdentity = 70.0; mMinIndex = 0.15; mMinIdentity = 85.0;
+
+    for ( std::map<unsigned int, stTABLE>::const_iterator i = _t.begin(); !( i == _t.end() ); ++i )
+    {
+        block = ( ( *i ).second ).end - ( ( *i ).second ).start + 1;
+
+        ( mBlock.find( ( ( *i ).second ).tid ) == mBlock.end() ) ?
+            mBlock[ ( ( *i ).second ).tid ] = block : mBlock[ ( ( *i ).second ).tid ] += block;
+    }   // the same block sizes as the strain level assignment
+}   // default constructor
+
+Delta::~Delta()
+{
+    mBlock.clear();
+}   // default destructor; environmentally conscientious
+
+/*
+ * thresholds of the strain and species level assignments; the state only
+ * applies to runs with the same thresholds
+*/
+void Delta::SetThreshold(
+    const double _s,            // minimum average identity of a strain
+    const double _w,            // minimum weighted shannon index
+    const double _i )           // minimum percent identity
+{
+    mIdentity = _s; mMinIndex = _w; mMinIdentity = _i;
+}   // end of SetThreshold()
+
+/*
+ * attach the instrumentation; NULL disables it
+*/
+void Delta::SetReport( Report* _r )
+{
+    mReport = _r;
+}   // end of SetReport()
+
+/*
+ * also write the pivot tables of the higher ranks; NULL detaches it
+*/
+void Delta::SetLineage( const Lineage* _l )
+{
+    mLineage = _l;
+}   // end of SetLineage()
+
+/*
+ * width of the histograms and the coarser levels of the strain level
+ * tables, the same as those of the full run; see Strain::SetPyramid()
+*/
+void Delta::SetPyramid(
+    const unsigned int _w,                  // width of the bins of the histograms
+    const std::vector<unsigned int>& _p )   // widths of the coarser levels
+{
+    mWidth = _w; mPyramid = _p;
+}   // end of SetPyramid()
+
+/*
+ * keep the state of a full run; the summary is read once more for the
+ * candidates of every read, with the same rules as the species level
+ * assignment
+*/
+bool Delta::Save(
+    Species& _q,                // species level assignment of the run
+    const std::string& _f )     // summary file
+{
+    const char* szDELIMIT = ",\t\n";
+    std::vector<std::string> field;
+    std::vector<const char*> token;
+    std::map<unsigned int, std::string>::const_iterator k;
+    Codec codec;
+    const Codec::Order order( &codec );
+    std::map<uint64_t, unsigned int, Codec::Order> read( order );
+    std::map<uint64_t, unsigned int, Codec::Order>::iterator r;
+    std::vector<unsigned int> owner;
+    std::vector<stPIVOT> candidate, set;
+    std::vector<size_t> best, first, next, group;
+    std::string line, name;
+    stHEADER head;
+    struct stat s;
+    FILE* of;
+
+    boost::algorithm::split( field, _f, boost::algorithm::is_any_of( ".\n" ) );
+    Reader ifs( _f );
+
+    if ( !ifs.IsOpen() || !Header( _f, head ) )
+    {
+        return( false );
+    }   // check the state of stream
+
+    if ( mReport )
+    {
+        mReport->Begin( "state", _f );
+    }   // instrumentation of the stage
+
+    mCount = stCOUNT(); ifs.GetLine( line );    // skip the header
+    mCount.bytes = line.size() + 1;
+
+    while ( ifs.GetLine( line ) )
+    {
+        mCount.records += 1.0; mCount.bytes += line.size() + 1;
+
+        if ( line.empty() || ( Tokenize( &line[ 0 ], szDELIMIT, token ) < 11 ) )
+        {
+            mCount.reject[ nREJECT_FIELD ] += 1.0; continue;
+        }   // truncated records
+
+        stPIVOT p;
+        p.tid = static_cast<unsigned int>( ::atoi( token[ 10 ] ) );  // ncbi tid
+        p.ratio = static_cast<double>( ::atof( token[ 1 ] ) );       // percent identity
+
+        if ( ( k = ( _q.mTaxon ).find( p.tid ) ) == ( _q.mTaxon ).end() )
+        {
+            mCount.reject[ nREJECT_TABLE ] += 1.0; continue;
+        }   // not a taxon of the translation table
+
+        if ( p.ratio < mMinIdentity )
+        {
+            mCount.reject[ nREJECT_IDENTITY ] += 1.0; continue;
+        }   // never a candidate with these thresholds
+
+        p.length = static_cast<unsigned int>( ::atoi( token[ 2 ] ) );   // alignment length
+        p.odd = static_cast<unsigned int>( ::atoi( token[ 3 ] ) );      // mismatches
+        p.gap = static_cast<unsigned int>( ::atoi( token[ 4 ] ) );      // gaps
+        p.phred = static_cast<double>( ::atof( token[ 5 ] ) );          // read quality
+        p.score = static_cast<unsigned int>( ::atoi( token[ 6 ] ) );    // map quality
+
+        const uint64_t rid = codec.Encode( token[ 0 ], ::strlen( token[ 0 ] ) );
+
+        if ( ( r = read.find( rid ) ) == read.end() )
+        {
+            r = read.insert( std::make_pair( rid, static_cast<unsigned int>( read.size() ) ) ).first;
+        }   // the first candidate of the read
+
+        owner.push_back( ( *r ).second ); candidate.push_back( p );
+    }   // keep the candidates in the order of the file
+
+    best.assign( read.size(), candidate.size() );
+    _q.Resolve( owner, candidate, best );
+    first.assign( read.size() + 1, 0 ); group.resize( candidate.size() );
+
+    for ( size_t i = 0; i < owner.size(); ++i )
+    {
+        first[ owner[ i ] + 1 ] += 1;
+    }   // number of candidates of every read
+
+    for ( size_t i = 0; i < read.size(); ++i )
+    {
+        first[ i + 1 ] += first[ i ];
+    }   // first candidate of every read
+
+    next.assign( first.begin(), first.end() );
+
+    for ( size_t i = 0; i < owner.size(); ++i )
+    {
+        group[ next[ owner[ i ] ]++ ] = i;
+    }   // candidates grouped by read, in the order of the file
+
+    if ( !( of = ::fopen( ( field[ 0 ] + ".species.bin.tmp" ).c_str(), "wb" ) ) )
+    {
+        if ( mReport )
+        {
+            mReport->End( mCount );
+        }   // complete the stage
+
+        return( false );
+    }   // unable to write the state
+
+    head.reads = read.size(); head.assigned = 0;
+    head.assign = ( ::stat( ( field[ 0 ] + ".assign.csv" ).c_str(), &s ) ) ? 0 : s.st_size;
+
+    for ( size_t i = 0; i < best.size(); ++i )
+    {
+        head.assigned += ( best[ i ] < candidate.size() ) ? 1 : 0;
+    }   // reads with an assignment
+
+    ::fwrite( &head, sizeof( head ), 1, of ); Taxa( of, _q, _q.mWeight );
+
+    for ( r = read.begin(); !( r == read.end() ); ++r )
+    {
+        const unsigned int n = ( *r ).second;
+        uint32_t b = nNONE;
+        set.clear();
+
+        for ( size_t j = first[ n ]; j < first[ n + 1 ]; ++j )
+        {
+            b = ( group[ j ] == best[ n ] ) ? static_cast<uint32_t>( j - first[ n ] ) : b;
+            set.push_back( candidate[ group[ j ] ] );
+        }   // candidates of the read in the order of the file
+
+        codec.Decode( ( *r ).first, name ); Write( of, name ); Write( of, set, b );
+    }   // the reads in the order of their identification
+
+    mCount.output = read.size(); mCount.written = ::ftell( of );
+
+    if ( mReport )
+    {
+        mReport->End( mCount );
+    }   // complete the stage
+
+    if ( ::fclose( of ) || ::rename( ( field[ 0 ] + ".species.bin.tmp" ).c_str(),
+        ( field[ 0 ] + ".species.bin" ).c_str() ) )
+    {
+        return( false );
+    }   // unable to write the state
+
+    return( true );
+}   // end of Save()
+
+/*
+ * incremental assignment with the current translation table; false if the
+ * state of the previous run does not apply, in which case nothing but
+ * possibly sample.strain.csv has been written
+*/
+bool Delta::Run( const std::string& _f )
+{
+    std::vector<std::string> field;
+    std::map<unsigned int, std::pair<double, std::string> > taxa;
+    std::map<unsigned int, unsigned int>::const_iterator b;
+    std::set<unsigned int> changed;
+    std::vector<stPIVOT> set;
+    std::vector<unsigned int> owner;
+    std::vector<size_t> best( 1 );
+    stHEADER head, now;
+    std::string line, name, state, assign;
+    struct stat s;
+    uint32_t id, block, k;
+    double weight;
+    bool affected, done = true;
+    FILE* ifs;
+    FILE* of;
+    FILE* sf;
+
+    boost::algorithm::split( field, _f, boost::algorithm::is_any_of( ".\n" ) );
+    state = field[ 0 ] + ".species.bin"; assign = field[ 0 ] + ".assign.csv";
+
+    if ( !Header( _f, now ) || !( ifs = ::fopen( state.c_str(), "rb" ) ) )
+    {
+        return( false );
+    }   // no state of a previous run
+
+    if ( !( ::fread( &head, sizeof( head ), 1, ifs ) == 1 ) ||
+        ::memcmp( head.magic, now.magic, sizeof( head.magic ) ) || !( head.version == now.version ) ||
+        !( head.summary == now.summary ) || !( head.modified == now.modified ) ||
+        !( head.strain == now.strain ) || !( head.index == now.index ) ||
+        !( head.identity == now.identity ) || !( head.taxa == mBlock.size() ) ||
+        ::stat( assign.c_str(), &s ) || !( static_cast<uint64_t>( s.st_size ) == head.assign ) )
+    {
+        ::fclose( ifs ); return( false );
+    }   // another summary, other thresholds or the tables have changed since
+
+    for ( uint32_t i = 0; done && ( i < head.taxa ); ++i )
+    {
+        done = ( ::fread( &id, sizeof( id ), 1, ifs ) == 1 ) &&
+            ( ::fread( &block, sizeof( block ), 1, ifs ) == 1 ) &&
+            ( ::fread( &weight, sizeof( weight ), 1, ifs ) == 1 ) && Read( ifs, name ) &&
+            !( ( b = mBlock.find( id ) ) == mBlock.end() ) && ( ( *b ).second == block );
+        taxa[ id ] = std::make_pair( weight, name );
+    }   // the taxa and their bins must be those of the previous run
+
+    Strain p( mTable );
+    p.SetIdentity( mIdentity ); p.SetReport( mReport ); p.SetPyramid( mWidth, mPyramid );
+
+    if ( !done || !p.Restore( field[ 0 ] + ".strain.bin", false ) )
+    {
+        ::fclose( ifs ); return( false );
+    }   // the strain level indices are rebuilt from the histograms
+
+    Species q( mTable, p.GetIndex() );
+    q.SetThreshold( mMinIndex, mMinIdentity ); q.SetLineage( mLineage );
+    Changed( taxa, q, changed ); mCount = stCOUNT();
+
+    if ( mReport )
+    {
+        mReport->Begin( "delta", state );
+    }   // instrumentation of the stage
+
+    Reader old( assign );
+    of = ::fopen( ( assign + ".tmp" ).c_str(), "w" );
+    sf = ::fopen( ( state + ".tmp" ).c_str(), "wb" );
+
+    if ( !old.IsOpen() || !of || !sf || !old.GetLine( line ) )
+    {
+        done = false;
+    }   // unable to copy the assignments
+    else
+    {
+        ::fprintf( of, "%s\n", line.c_str() );
+        ::fwrite( &now, sizeof( now ), 1, sf ); Taxa( sf, q, q.mWeight );
+        now.reads = head.reads; now.assigned = 0;
+    }   // header of the assignments and of the new state
+
+    for ( uint64_t i = 0; done && ( i < head.reads ); ++i )
+    {
+        if ( !Read( ifs, name ) || !Read( ifs, set, k ) )
+        {
+            done = false; break;
+        }   // truncated state
+
+        affected = false; mCount.records += 1.0;
+
+        for ( unsigned int j = 0; !affected && ( j < set.size() ); ++j )
+        {
+            affected = !( changed.find( set[ j ].tid ) == changed.end() );
+        }   // a candidate of a taxon whose species or index has changed
+
+        if ( !( k == nNONE ) && !( done = old.GetLine( line ) ) )
+        {
+            break;
+        }   // the line of the previous assignment
+
+        if ( affected )
+        {
+            owner.assign( set.size(), 0 ); best[ 0 ] = set.size();
+            q.Resolve( owner, set, best );
+            k = ( best[ 0 ] < set.size() ) ? static_cast<uint32_t>( best[ 0 ] ) : nNONE;
+            mCount.output += 1.0;
+
+            if ( !( k == nNONE ) )
+            {
+                q.Export( of, name, set[ k ] );
+            }   // the read is assigned with the new table
+        }   // resolve the candidates again
+        else if ( !( k == nNONE ) )
+        {
+            ::fprintf( of, "%s\n", line.c_str() );
+            q.Summarize( ( q.mTaxon ).find( set[ k ].tid )->second, set[ k ] );
+        }   // the assignment and its line remain the same
+
+        now.assigned += ( k == nNONE ) ? 0 : 1;
+        Write( sf, name ); Write( sf, set, k );
+    }   // the reads in the order of their identification
+
+    ::fclose( ifs );
+    now.assign = ( of ) ? ::ftell( of ) : 0;
+
+    if ( sf && done )
+    {
+        ::fseek( sf, 0, SEEK_SET ); ::fwrite( &now, sizeof( now ), 1, sf );
+    }   // the number of assignments and the size of the new table
+
+    done = ( of && !::fclose( of ) ) && done;
+    done = ( sf && !::fclose( sf ) ) && done;
+
+    if ( done )
+    {
+        ::rename( ( assign + ".tmp" ).c_str(), assign.c_str() );
+        ::rename( ( state + ".tmp" ).c_str(), state.c_str() );
+        q.Output( field[ 0 ] + ".pivot.csv" ); q.WriteIndex( field[ 0 ] + ".wsei.csv" );
+        q.WriteRank( field[ 0 ] );
+        mCount.written = now.assign;
+    }   // replace the tables
+    else
+    {
+        ::unlink( ( assign + ".tmp" ).c_str() ); ::unlink( ( state + ".tmp" ).c_str() );
+    }   // the previous tables are kept
+
+    if ( mReport )
+    {
+        mReport->End( mCount );
+    }   // complete the stage
+
+    return( done );
+}   // end of Run()
+
+/*
+ * header of the state of a summary with the current thresholds
+*/
+bool Delta::Header(
+    const std::string& _f,      // summary file
+    stHEADER& _h ) const        // header of the state
+{
+    struct stat s;
+
+    if ( ::stat( _f.c_str(), &s ) )
+    {
+        return( false );
+    }   // no summary
+
+    ::memset( &_h, 0, sizeof( _h ) ); ::memcpy( _h.magic, szMAGIC, sizeof( _h.magic ) );
+    _h.version = nVERSION; _h.taxa = mBlock.size();
+    _h.summary = s.st_size; _h.modified = s.st_mtime;
+    _h.strain = mIdentity; _h.index = mMinIndex; _h.identity = mMinIdentity;
+
+    return( true );
+}   // end of Header()
+
+/*
+ * write the taxa, their bins, indices and species
+*/
+bool Delta::Taxa(
+    FILE* _f,
+    const Species& _q,                              // species level assignment
+    const std::map<unsigned int, double>& _w ) const    // index of every taxon
+{
+    std::map<unsigned int, double>::const_iterator w;
+    uint32_t id, block;
+    double weight;
+
+    for ( std::map<unsigned int, unsigned int>::const_iterator i = mBlock.begin(); !( i == mBlock.end() ); ++i )
+    {
+        id = ( *i ).first; block = ( *i ).second;
+        weight = ( ( w = _w.find( id ) ) == _w.end() ) ? -1.0 : ( *w ).second;
+
+        ::fwrite( &id, sizeof( id ), 1, _f ); ::fwrite( &block, sizeof( block ), 1, _f );
+        ::fwrite( &weight, sizeof( weight ), 1, _f ); Write( _f, ( _q.mTaxon ).find( id )->second );
+    }   // sorted by tid
+
+    return( !::ferror( _f ) );
+}   // end of Taxa()
+
+/*
+ * taxa whose reads may be assigned differently with the new table: those
+ * of a species whose index has changed, and those whose species has changed,
+ * together with the other taxa of both species
+*/
+void Delta::Changed(
+    const std::map<unsigned int, std::pair<double, std::string> >& _t,  // taxa of the previous run
+    const Species& _q,                  // species level assignment with the new table
+    std::set<unsigned int>& _c ) const  // taxa whose reads are resolved again
+{
+    std::map<std::string, double> index;
+    std::map<std::string, double>::const_iterator k;
+    std::set<std::string> species;
+    const std::map<std::string, double>& now = _q.mIndex;
+
+    for ( std::map<unsigned int, std::pair<double, std::string> >::const_iterator i = _t.begin(); !( i == _t.end() ); ++i )
+    {
+        const std::string& sid = ( ( *i ).second ).second;
+
+        if ( !( ( ( ( *i ).second ).first < 0.0 ) || ( ( ( *i ).second ).first < mMinIndex ) ) )
+        {
+            index[ sid ] = ( ( k = index.find( sid ) ) == index.end() ) ?
+                ( ( *i ).second ).first : std::max( ( *k ).second, ( ( *i ).second ).first );
+        }   // the same as Species::Index()
+
+        if ( !( sid == ( _q.mTaxon ).find( ( *i ).first )->second ) )
+        {
+            species.insert( sid ); species.insert( ( _q.mTaxon ).find( ( *i ).first )->second );
+        }   // the taxon belongs to another species
+    }   // index of every species of the previous run
+
+    for ( k = index.begin(); !( k == index.end() ); ++k )
+    {
+        if ( ( now.find( ( *k ).first ) == now.end() ) || !( now.find( ( *k ).first )->second == ( *k ).second ) )
+        {
+            species.insert( ( *k ).first );
+        }   // index lost or changed
+    }   // every species of the previous run
+
+    for ( k = now.begin(); !( k == now.end() ); ++k )
+    {
+        if ( index.find( ( *k ).first ) == index.end() )
+        {
+            species.insert( ( *k ).first );
+        }   // index gained
+    }   // every species of the new table
+
+    for ( std::map<unsigned int, std::pair<double, std::string> >::const_iterator i = _t.begin(); !( i == _t.end() ); ++i )
+    {
+        if ( !( species.find( ( ( *i ).second ).second ) == species.end() ) ||
+            !( species.find( ( _q.mTaxon ).find( ( *i ).first )->second ) == species.end() ) )
+        {
+            _c.insert( ( *i ).first );
+        }   // the previous or the new species is affected
+    }   // every taxon
+}   // end of Changed()
+
+/*
+ * read and write a string, e.g., a read identification
+*/
+bool Delta::Read(
+    FILE* _f,
+    std::string& _s )
+{
+    uint16_t size;
+    char name[ 65536 ];
+
+    if ( !( ::fread( &size, sizeof( size ), 1, _f ) == 1 ) || !( ::fread( name, 1, size, _f ) == size ) )
+    {
+        return( false );
+    }   // end of the file
+
+    _s.assign( name, size ); return( true );
+}   // end of Read()
+
+void Delta::Write(
+    FILE* _f,
+    const std::string& _s )
+{
+    uint16_t size = static_cast<uint16_t>( std::min<size_t>( _s.size(), 65535 ) );
+
+    ::fwrite( &size, sizeof( size ), 1, _f ); ::fwrite( _s.data(), 1, size, _f );
+}   // end of Write()
+
+/*
+ * read and write the candidates of a read and its best candidate
+*/
+bool Delta::Read(
+    FILE* _f,
+    std::vector<stPIVOT>& _c,   // candidates of the read
+    uint32_t& _b )              // best candidate; -1 if none
+{
+    unsigned int field[ 5 ];
+    double real[ 2 ];
+    uint32_t size;
+
+    if ( !( ::fread( &size, sizeof( size ), 1, _f ) == 1 ) || !( ::fread( &_b, sizeof( _b ), 1, _f ) == 1 ) )
+    {
+        return( false );
+    }   // end of the file
+
+    _c.resize( size );
+
+    for ( uint32_t i = 0; i < size; ++i )
+    {
+        if ( !( ::fread( field, sizeof( unsigned int ), 5, _f ) == 5 ) ||
+            !( ::fread( real, sizeof( double ), 2, _f ) == 2 ) )
+        {
+            return( false );
+        }   // truncated candidate
+
+        _c[ i ].tid = field[ 0 ]; _c[ i ].length = field[ 1 ]; _c[ i ].odd = field[ 2 ];
+        _c[ i ].gap = field[ 3 ]; _c[ i ].score = field[ 4 ];
+        _c[ i ].ratio = real[ 0 ]; _c[ i ].phred = real[ 1 ];
+        ( _c[ i ].site ).clear();
+    }   // every candidate of the read
+
+    return( ( _b == nNONE ) || ( _b < size ) );
+}   // end of Read()
+
+void Delta::Write(
+    FILE* _f,
+    const std::vector<stPIVOT>& _c,     // candidates of the read
+    const uint32_t _b )                 // best candidate; -1 if none
+{
+    uint32_t size = static_cast<uint32_t>( _c.size() );
+
+    ::fwrite( &size, sizeof( size ), 1, _f ); ::fwrite( &_b, sizeof( _b ), 1, _f );
+
+    for ( uint32_t i = 0; i < size; ++i )
+    {
+        unsigned int field[ 5 ] = { _c[ i ].tid, _c[ i ].length, _c[ i ].odd, _c[ i ].gap, _c[ i ].score };
+        double real[ 2 ] = { _c[ i ].ratio, _c[ i ].phred };
+
+        ::fwrite( field, sizeof( unsigned int ), 5, _f ); ::fwrite( real, sizeof( double ), 2, _f );
+    }   // every candidate of the read
+}   // end of Write()
@@ -0,0 +1,107 @@
+/*
+ * delta.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * incremental assignment after a change of the translation table
+ *
+ * a full run keeps its state next to the tables: the histograms of the
+ * strain level assignment, sample.strain.bin, and the candidates of every
+ * read, sample.species.bin. when only the strain or species names of the
+ * taxa change, the strain level indices are rebuilt from the histograms,
+ * and only the reads with a candidate of a species whose index or taxa
+ * changed are resolved again. every other read keeps its assignment and
+ * its line of sample.assign.csv, which is copied as is; the species
+ * aggregates are summed over all reads in their original order, so the
+ * tables are identical to those of a full run with the new table.
+ *
+ * the state does not apply, and a full run is needed, if the summary, the
+ * thresholds, the taxa or their bins differ from those of the saved run.
+ *
+ * header: magic "MCATREAD", version, number of taxa (4 bytes each), number
+ * of reads, number of assigned reads, size and modification time of the
+ * summary, size of sample.assign.csv (8 bytes each), minimum strain
+ * identity, minimum weighted shannon index and minimum percent identity
+ * (8 bytes each)
+ * taxa: tid, bins (4 bytes each), weighted shannon index, -1 if not used
+ * (8 bytes), length of species name (2 bytes), species name; sorted by tid
+ * reads: length of read identification (2 bytes), read identification,
+ * number of candidates, best candidate, -1 if none (4 bytes each), then
+ * every candidate as tid, alignment length, mismatches, gaps, alignment
+ * quality (4 bytes each), percent identity and read quality (8 bytes
+ * each), in the order of the summary; reads sorted by identification
+*/
+
+#ifndef _DELTA_H
+#define _DELTA_H
+
+#include <table.h>
+#include <pivot.h>
+#include <strain.h>
+#include <report.h>
+#include <species.h>
+
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <stdint.h>
+
+class Delta
+{
+public:
+    Delta( const std::map<unsigned int, stTABLE>& );    // translate table
+    ~Delta();
+
+    bool Run( const std::string& );
+    bool Save( Species&, const std::string& );
+    void SetThreshold( const double, const double, const double );
+    void SetReport( Report* );
+    void SetLineage( const Lineage* );
+    void SetPyramid( const unsigned int, const std::vector<unsigned int>& );
+
+private:
+    struct stHEADER
+    {
+        char magic[ 8 ];        // "MCATREAD"
+        uint32_t version;       // version of the format
+        uint32_t taxa;          // number of taxa
+        uint64_t reads;         // number of reads
+        uint64_t assigned;      // number of assigned reads
+        uint64_t summary;       // size of the summary
+        int64_t modified;       // modification time of the summary
+        uint64_t assign;        // size of sample.assign.csv
+        double strain;          // minimum average identity of a strain
+        double index;           // minimum weighted shannon index
+        double identity;        // minimum percent identity of a candidate
+    };  // header of the state
+
+    const std::map<unsigned int, stTABLE>& mTable;
+    std::map<unsigned int, unsigned int> mBlock;    // bins of every taxon
+    double mIdentity;       // minimum average identity of a strain
+    double mMinIndex;       // minimum weighted shannon index of a species
+    double mMinIdentity;    // minimum percent identity of a candidate
+    Report* mReport;        // instrumentation; NULL if not attached
+    const Lineage* mLineage;    // ranks above the species; NULL if not attached
+    unsigned int mWidth;    // width of the bins of the histograms
+    std::vector<unsigned int> mPyramid; // widths of the coarser levels
+    stCOUNT mCount;         // counters of the stage
+
+    bool Header( const std::string&, stHEADER& ) const;
+    bool Taxa( FILE*, const Species&, const std::map<unsigned int, double>& ) const;
+    void Changed( const std::map<unsigned int, std::pair<double, std::string> >&,
+        const Species&, std::set<unsigned int>& ) const;
+    static bool Read( FILE*, std::string& );
+    static bool Read( FILE*, std::vector<stPIVOT>&, uint32_t& );
+    static void Write( FILE*, const std::string& );
+    static void Write( FILE*, const std::vector<stPIVOT>&, const uint32_t );
+};  // end of class definition
+
+#endif  // _DELTA_H
@@ -0,0 +1,57 @@
+/*
+ * hash.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * 64-bit hash functions; not suitable for cryptographic purposes
+ *
+ * Mix64() is the finalizer of splitmix64, which turns a counter or a seed
+ * into well distributed bits. Hash64() is FNV-1a on the bytes followed by
+ * the finalizer, which repairs the weak avalanche of FNV in the low bits.
+*/
+
+#ifndef _HASH_H
+#define _HASH_H
+
+#include <cstddef>
+#include <stdint.h>
+
+inline uint64_t Mix64( uint64_t _x )
+{
+    _x += 0x9e3779b97f4a7c15ULL;
+    _x = ( _x ^ ( _x >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    _x = ( _x ^ ( _x >> 27 ) ) * 0x94d049bb133111ebULL;
+
+    return( _x ^ ( _x >> 31 ) );
+}   // end of Mix64()
+
+inline uint64_t Hash64(
+    const char* _s,             // bytes to be hashed
+    const size_t _n,            // number of bytes
+    const uint64_t _seed = 0 )  // seed of the hash
+{
+    uint64_t h = 0xcbf29ce484222325ULL ^ _seed;
+
+    for ( size_t i = 0; i < _n; ++i )
+    {
+        h = ( h ^ static_cast<unsigned char>( _s[ i ] ) ) * 0x100000001b3ULL;
+    }   // fnv-1a
+
+    return( Mix64( h ) );
+}   // end of Hash64()
+
+/*
+ * map a hash onto [0, 1)
+*/
+inline double Unit64( const uint64_t _h )
+{
+    return( static_cast<double>( _h >> 11 ) / 9007199254740992.0 );
+}   // end of Unit64()
+
+#endif  // _HASH_H
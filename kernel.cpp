@@ -0,0 +1,695 @@
+/*
+ * kernel.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * microbenchmarks of the per-record and per-taxon kernels
+ *
+ * the kernels of the parser (cigar, md tag, base quality and histogram bin),
+ * of the assignments (tokenizing a summary line, aggregating a record into
+ * the strain level totals and keeping the candidate of a read) and of the
+ * strain level assignment (coverage histogram, coverage and shannon index) run on
+ * synthetic inputs that follow the distributions of real samples: mostly
+ * plain cigar strings with a tail of long soft-clipped ones, skewed numbers
+ * of mismatches and bin histograms dominated by a few bins. every kernel
+ * reports the time and the number of heap allocations per call. with a
+ * baseline file, a kernel fails if it is slower than the baseline by more
+ * than the tolerance, or allocates more often.
+ *
+ * the record sources are compared with a hand-written loop: both read the
+ * same synthetic sam file with the read-ahead reader and parse every line,
+ * one with Reader::GetLine() and SamFile::Parse(), the other through the
+ * members of SamSource, the same way as the parser does.
+ *
+ * to compile:
+ * g++ -I. -O3 -D_LIB_SAMTOOL kernel.cpp samfile.cpp strain.cpp codec.cpp store.cpp task.cpp report.cpp
+ *     reader.cpp placement.cpp -o kernel -fopenmp -lz
+*/
+
+#include <pivot.h>
+#include <table.h>
+#include <token.h>
+#include <option.h>
+#include <random.h>
+#include <report.h>
+#include <reader.h>
+#include <source.h>
+#include <strain.h>
+#include <samfile.h>
+
+#include <new>
+#include <map>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unistd.h>
+
+/*
+ * number of heap allocations; the benchmark runs on a single thread
+*/
+static unsigned long nAlloc = 0;
+
+#if __cplusplus >= 201103L
+void* operator new( size_t _n )
+#else
+void* operator new( size_t _n ) throw( std::bad_alloc )
+#endif
+{
+    void* p = ::malloc( ( _n ) ? _n : 1 ); ++nAlloc;
+
+    if ( !p )
+    {
+        throw std::bad_alloc();
+    }   // out of memory
+
+    return( p );
+}   // count the allocations
+
+#if __cplusplus >= 201103L
+void* operator new[]( size_t _n )
+#else
+void* operator new[]( size_t _n ) throw( std::bad_alloc )
+#endif
+{
+    return( operator new( _n ) );
+}   // count the allocations
+
+void operator delete( void* _p ) throw()
+{
+    ::free( _p );
+}   // release the memory
+
+void operator delete[]( void* _p ) throw()
+{
+    ::free( _p );
+}   // release the memory
+
+#if __cplusplus >= 201402L
+void operator delete( void* _p, size_t ) noexcept
+{
+    operator delete( _p );
+}   // sized release; the same as the unsized one
+
+void operator delete[]( void* _p, size_t ) noexcept
+{
+    operator delete[]( _p );
+}   // sized release; the same as the unsized one
+#endif
+
+struct stKERNEL
+{
+    std::string name;       // name of the kernel
+    double ns;              // nanoseconds per call
+    double allocs;          // heap allocations per call
+};  // result of a kernel
+
+class Kernel
+{
+public:
+    Kernel( const uint64_t );
+    ~Kernel();
+
+    stKERNEL Run( const std::string&, const double );
+
+private:
+    typedef double ( Kernel::*Call )( const unsigned int );
+
+    std::map<unsigned int, stTABLE> mTable;
+    SamFile mSam;
+    Strain mStrain;
+
+    std::vector<std::string> mCigar;                    // cigar strings
+    std::vector<std::string> mQual;                     // base qualities
+    std::vector<std::string> mTag;                      // optional tags, tab separated
+    std::vector<unsigned int> mPos;                     // leftmost positions
+    std::vector<std::string> mLine;                     // lines of the summary file
+    std::vector<std::vector<unsigned int> > mSite;      // bins of the hits of a taxon
+    std::vector<std::vector<stBIN> > mHist;             // coverage histogram of a taxon
+    std::vector<double> mBlock;                         // number of bins of a taxon
+    std::string mFile;                                  // synthetic sam file
+
+    double CIGAR( const unsigned int );
+    double MD( const unsigned int );
+    double Sanger( const unsigned int );
+    double SetBin( const unsigned int );
+    double Tokenize( const unsigned int );
+    double Aggregate( const unsigned int );
+    double Candidate( const unsigned int );
+    double Histogram( const unsigned int );
+    double Weight( const unsigned int );
+    double Shannon( const unsigned int );
+    double Loop( const unsigned int );
+    double Source( const unsigned int );
+};  // end of class definition
+
+/*
+ * parse all records of a source; the loop of the parser without the threads
+*/
+template <class T> static double Drain(
+    T& _s,                                      // source of the records
+    const std::map<unsigned int, stTABLE>& _t ) // translation table
+{
+    std::string buffer;
+    unsigned int why;
+    double sink = 0.0;
+    stSAM sam;
+
+    while ( _s.Next( buffer ) )
+    {
+        sink += ( _s.Parse( _t, buffer, sam, why ) ) ? sam.alen : 0.0;
+    }   // every record
+
+    return( sink );
+}   // end of Drain()
+
+/*
+ * number of inputs of every kernel except the per-taxon ones
+ * number of taxa for the coverage and shannon index
+*/
+static const unsigned int nMaxINPUT = 4096;
+static const unsigned int nMaxTAXA = 64;
+
+Kernel::Kernel(
+    const uint64_t _s ) : mStrain( mTable )
+{
+    Random r( _s );
+    const char* base = "ACGT";
+    char number[ 64 ];
+    char name[] = "/tmp/kernel.XXXXXX";
+    int fd = ::mkstemp( name );
+    FILE* sam = ( fd < 0 ) ? NULL : ::fdopen( fd, "w" );
+
+    for ( unsigned int i = 0; i < nMaxINPUT; ++i )
+    {
+        unsigned int length = 100 + r.Range( 151 ), clip, part;
+        double u = r.Uniform();
+        std::string cigar, qual, md;
+
+        if ( u < 0.6 )
+        {
+            ::sprintf( number, "%dM", length ); cigar = number;
+        }   // plain alignment
+        else if ( u < 0.85 )
+        {
+            clip = 1 + r.Range( 30 );
+            ::sprintf( number, "%dS%dM", clip, length - clip ); cigar = number;
+        }   // soft-clipped on one end
+        else
+        {
+            ::sprintf( number, "%dS", 1 + r.Range( 40 ) ); cigar = number;
+
+            for ( unsigned int k = 4 + r.Range( 16 ); k > 0; --k )
+            {
+                part = 1 + r.Range( 30 );
+                ::sprintf( number, "%d%c", part, ( k % 2 ) ? 'M' : "ID"[ r.Range( 2 ) ] ); cigar += number;
+            }   // alternating matches and indels
+
+            ::sprintf( number, "%dM%dS", 1 + r.Range( 60 ), 1 + r.Range( 40 ) ); cigar += number;
+        }   // long soft-clipped alignment
+
+        for ( unsigned int k = 0; k < length; ++k )
+        {
+            qual.push_back( static_cast<char>( 35 + r.Range( 39 ) ) );
+        }   // base qualities
+
+        double rate = ( r.Uniform() < 0.1 ) ? 0.1 : 0.02;
+        unsigned int run = 0, odd = 0;
+
+        for ( unsigned int k = 0; k < length; ++k )
+        {
+            if ( !( r.Uniform() < rate ) )
+            {
+                ++run; continue;
+            }   // matching base
+
+            ::sprintf( number, "%d", run ); md += number;
+            md.push_back( base[ r.Range( 4 ) ] ); run = 0; ++odd;
+        }   // skewed number of mismatches
+
+        ::sprintf( number, "%d", run ); md += number;
+
+        std::vector<std::string> field;
+        ::sprintf( number, "AS:i:%d", 2 * length - 6 * odd ); field.push_back( number );
+        field.push_back( "XN:i:0" );
+        ::sprintf( number, "XM:i:%d", odd ); field.push_back( number );
+        field.push_back( "XO:i:0" ); field.push_back( "XG:i:0" );
+        ::sprintf( number, "NM:i:%d", odd ); field.push_back( number );
+        field.push_back( "MD:Z:" + md ); field.push_back( "YT:Z:UU" );
+
+        ::sprintf( number, "%d", i / 2 );     // two hits per read
+        mLine.push_back( "\"HWI-ST1234:8:C1000ACXX:1:1101:" + std::string( number ) + ":1000\",97.00," );
+        ::sprintf( number, "%d,%d,0,", length, odd ); mLine.back() += number;
+        ::sprintf( number, "%.2f,", qual.size() * 0.2 ); mLine.back() += number;
+        ::sprintf( number, "%d,%d,%d,", 42, i % 5000, i % 5000 ); mLine.back() += number;
+        ::sprintf( number, "%d,%d", 100000 + r.Range( nMaxTAXA ), 2000 + r.Range( nMaxTAXA ) );
+        mLine.back() += number;
+
+        mCigar.push_back( cigar ); mQual.push_back( qual );
+        mTag.push_back( boost::algorithm::join( field, "\t" ) ); mPos.push_back( r.Range( 12000000 ) );
+
+        if ( sam )
+        {
+            ::fprintf( sam, "HWI-ST1234:8:C1000ACXX:1:1101:%d:1000\t0\tgi|%d|ref|NC_%06d.1|\t%d\t42\t%s\t*\t0\t0\t*\t%s\t%s\n",
+                i / 2, 100000 + i % nMaxTAXA, i % nMaxTAXA, mPos.back() + 1, cigar.c_str(), qual.c_str(),
+                mTag.back().c_str() );
+        }   // line of the sam file
+    }   // per-record inputs
+
+    for ( unsigned int i = 0; i < nMaxTAXA; ++i )
+    {
+        ::sprintf( number, "%d,%d,%d,%d,%d,,", 100000 + i, 2000 + i, 12000000, 12000 * i, 12000 * ( i + 1 ) );
+        mTable[ 100000 + i ] = std::string( number );
+    }   // genomes of the sam file
+
+    if ( sam )
+    {
+        ::fclose( sam ); mFile = name;
+    }   // the sam file is complete
+
+    for ( unsigned int i = 0; i < nMaxTAXA; ++i )
+    {
+        unsigned int block = 1000 + r.Range( 5000 );
+        unsigned int hits = static_cast<unsigned int>( 100.0 * ::pow( 200.0, r.Uniform() ) );
+        std::vector<unsigned int> site;
+
+        for ( unsigned int k = 0; k < hits; ++k )
+        {
+            site.push_back( static_cast<unsigned int>( block * ::pow( r.Uniform(), 3.0 ) ) );
+        }   // hits concentrate on a few bins
+
+        mSite.push_back( site ); mBlock.push_back( block );
+        mHist.push_back( std::vector<stBIN>() ); Strain::Count( site, mHist.back() );
+    }   // per-taxon inputs
+}   // default constructor
+
+Kernel::~Kernel()
+{
+    if ( !mFile.empty() )
+    {
+        ::unlink( mFile.c_str() );
+    }   // remove the sam file
+}   // default destructor
+
+/*
+ * run a kernel for at least the given number of seconds
+*/
+stKERNEL Kernel::Run(
+    const std::string& _n,      // name of the kernel
+    const double _t )           // minimum time in seconds
+{
+    Call call = NULL;
+    stKERNEL k;
+    double ops = 0.0, start, elapsed = 0.0, sink = 0.0;
+    unsigned long alloc;
+    unsigned int rounds = 1;
+
+    k.name = _n; k.ns = 0.0; k.allocs = 0.0;
+    call = ( _n == "cigar" ) ? &Kernel::CIGAR : call;
+    call = ( _n == "md" ) ? &Kernel::MD : call;
+    call = ( _n == "sanger" ) ? &Kernel::Sanger : call;
+    call = ( _n == "setbin" ) ? &Kernel::SetBin : call;
+    call = ( _n == "tokenize" ) ? &Kernel::Tokenize : call;
+    call = ( _n == "aggregate" ) ? &Kernel::Aggregate : call;
+    call = ( _n == "candidate" ) ? &Kernel::Candidate : call;
+    call = ( _n == "histogram" ) ? &Kernel::Histogram : call;
+    call = ( _n == "weight" ) ? &Kernel::Weight : call;
+    call = ( _n == "shannon" ) ? &Kernel::Shannon : call;
+    call = ( _n == "loop" ) ? &Kernel::Loop : call;
+    call = ( _n == "source" ) ? &Kernel::Source : call;
+
+    if ( !call )
+    {
+        return( k );
+    }   // unknown kernel
+
+    sink += ( this->*call )( 1 );   // warm up
+
+    while ( elapsed < _t )
+    {
+        alloc = nAlloc; start = Report::Clock();
+        ops = ( this->*call )( rounds );
+        elapsed = Report::Clock() - start;
+        k.allocs = ( nAlloc - alloc ) / ops;
+        rounds *= 2;
+    }   // double the rounds until the time is long enough
+
+    k.ns = 1e9 * elapsed / ops + ( ( sink < 0.0 ) ? sink : 0.0 );
+
+    return( k );
+}   // end of Run()
+
+double Kernel::CIGAR( const unsigned int _r )
+{
+    unsigned int cigar[ 128 ];
+    volatile unsigned int sink = 0;
+
+    for ( unsigned int k = 0; k < _r; ++k )
+    {
+        for ( unsigned int i = 0; i < mCigar.size(); ++i )
+        {
+            mSam.ExCIGAR( mCigar[ i ].c_str(), cigar ); sink += cigar[ 'M' ];
+        }   // every input
+    }   // every round
+
+    return( static_cast<double>( _r ) * mCigar.size() );
+}   // end of CIGAR()
+
+double Kernel::MD( const unsigned int _r )
+{
+    volatile unsigned int sink = 0;
+
+    for ( unsigned int k = 0; k < _r; ++k )
+    {
+        for ( unsigned int i = 0; i < mTag.size(); ++i )
+        {
+            sink += mSam.ExMD( mTag[ i ].c_str() );
+        }   // every input
+    }   // every round
+
+    return( static_cast<double>( _r ) * mTag.size() );
+}   // end of MD()
+
+double Kernel::Sanger( const unsigned int _r )
+{
+    volatile double sink = 0.0;
+
+    for ( unsigned int k = 0; k < _r; ++k )
+    {
+        for ( unsigned int i = 0; i < mQual.size(); ++i )
+        {
+            sink += mSam.Sanger( mQual[ i ].data(), mQual[ i ].size() );
+        }   // every input
+    }   // every round
+
+    return( static_cast<double>( _r ) * mQual.size() );
+}   // end of Sanger()
+
+double Kernel::SetBin( const unsigned int _r )
+{
+    volatile unsigned int sink = 0;
+
+    for ( unsigned int k = 0; k < _r; ++k )
+    {
+        for ( unsigned int i = 0; i < mPos.size(); ++i )
+        {
+            sink += mSam.SetBin( mPos[ i ] );
+        }   // every input
+    }   // every round
+
+    return( static_cast<double>( _r ) * mPos.size() );
+}   // end of SetBin()
+
+double Kernel::Tokenize( const unsigned int _r )
+{
+    std::vector<const char*> field;
+    char buffer[ 2048 ];
+    volatile unsigned int sink = 0;
+
+    for ( unsigned int k = 0; k < _r; ++k )
+    {
+        for ( unsigned int i = 0; i < mLine.size(); ++i )
+        {
+            ::strcpy( buffer, mLine[ i ].c_str() );
+            sink += ::Tokenize( buffer, ",\t\n", field );
+        }   // every input
+    }   // every round
+
+    return( static_cast<double>( _r ) * mLine.size() );
+}   // end of Tokenize()
+
+/*
+ * strain level aggregation of a record into the totals of its taxon; the
+ * totals start over every round
+*/
+double Kernel::Aggregate( const unsigned int _r )
+{
+    std::vector<const char*> field;
+    std::map<unsigned int, stPIVOT> total;
+    std::map<unsigned int, stPIVOT>::iterator j;
+    char buffer[ 2048 ];
+    unsigned int tid;
+    stPIVOT set;
+
+    for ( unsigned int k = 0; k < _r; ++k )
+    {
+        total.clear();
+
+        for ( unsigned int i = 0; i < mLine.size(); ++i )
+        {
+            ::strcpy( buffer, mLine[ i ].c_str() ); ::Tokenize( buffer, ",\t\n", field );
+            ( set.site ).clear();
+            set.ratio = ::atof( field[ 1 ] ); set.length = ::atoi( field[ 2 ] );
+            set.odd = ::atoi( field[ 3 ] ); set.gap = ::atoi( field[ 4 ] );
+            set.phred = ::atof( field[ 5 ] ); set.score = ::atoi( field[ 6 ] );
+            ( set.site ).push_back( ::atoi( field[ 7 ] ) ); tid = ::atoi( field[ 10 ] );
+
+            ( ( j = total.find( tid ) ) == total.end() ) ?
+                total[ tid ] = set : ( *j ).second += set;
+        }   // every input
+    }   // every round
+
+    return( static_cast<double>( _r ) * mLine.size() );
+}   // end of Aggregate()
+
+/*
+ * species level candidate of a read; the candidates start over every round
+*/
+double Kernel::Candidate( const unsigned int _r )
+{
+    std::vector<const char*> field;
+    Codec codec;
+    const Codec::Order order( &codec );
+    PivotMap assign( order );
+    PivotMap::iterator j;
+    uint64_t rid;
+    char buffer[ 2048 ];
+    stPIVOT set;
+
+    for ( unsigned int k = 0; k < _r; ++k )
+    {
+        assign.clear();
+
+        for ( unsigned int i = 0; i < mLine.size(); ++i )
+        {
+            ::strcpy( buffer, mLine[ i ].c_str() ); ::Tokenize( buffer, ",\t\n", field );
+            rid = codec.Encode( field[ 0 ], ::strlen( field[ 0 ] ) );
+            set.ratio = ::atof( field[ 1 ] ); set.length = ::atoi( field[ 2 ] );
+            set.odd = ::atoi( field[ 3 ] ); set.tid = ::atoi( field[ 10 ] );
+
+            if ( ( j = assign.find( rid ) ) == assign.end() )
+            {
+                assign[ rid ] = set; continue;
+            }   // the first candidate of the read
+
+            ( ( *j ).second ).tid = ( set.length > ( ( *j ).second ).length ) ? set.tid : ( ( *j ).second ).tid;
+        }   // every input
+    }   // every round
+
+    return( static_cast<double>( _r ) * mLine.size() );
+}   // end of Candidate()
+
+double Kernel::Histogram( const unsigned int _r )
+{
+    std::vector<stBIN> h;
+    volatile double sink = 0.0;
+
+    for ( unsigned int k = 0; k < _r; ++k )
+    {
+        for ( unsigned int i = 0; i < mSite.size(); ++i )
+        {
+            Strain::Count( mSite[ i ], h ); sink += h.size();
+        }   // every taxon
+    }   // every round
+
+    return( static_cast<double>( _r ) * mSite.size() );
+}   // end of Histogram()
+
+double Kernel::Weight( const unsigned int _r )
+{
+    volatile double sink = 0.0;
+
+    for ( unsigned int k = 0; k < _r; ++k )
+    {
+        for ( unsigned int i = 0; i < mSite.size(); ++i )
+        {
+            sink += mStrain.Weight( mHist[ i ].size(), mBlock[ i ] );
+        }   // every taxon
+    }   // every round
+
+    return( static_cast<double>( _r ) * mSite.size() );
+}   // end of Weight()
+
+double Kernel::Shannon( const unsigned int _r )
+{
+    volatile double sink = 0.0;
+
+    for ( unsigned int k = 0; k < _r; ++k )
+    {
+        for ( unsigned int i = 0; i < mSite.size(); ++i )
+        {
+            sink += mStrain.Shannon( &mHist[ i ][ 0 ], mHist[ i ].size(), 0.5 );
+        }   // every taxon
+    }   // every round
+
+    return( static_cast<double>( _r ) * mSite.size() );
+}   // end of Shannon()
+
+/*
+ * hand-written loop over the lines of the sam file
+*/
+double Kernel::Loop( const unsigned int _r )
+{
+    std::string buffer;
+    unsigned int why;
+    volatile double sink = 0.0;
+    stSAM sam;
+
+    for ( unsigned int k = 0; k < _r; ++k )
+    {
+        Reader ifs( mFile );
+
+        while ( ifs.GetLine( buffer ) )
+        {
+            sink += ( mSam.Parse( mTable, buffer.c_str(), sam, why ) ) ? sam.alen : 0.0;
+        }   // every line
+    }   // every round
+
+    return( static_cast<double>( _r ) * mCigar.size() );
+}   // end of Loop()
+
+/*
+ * the same lines through the record source of the parser
+*/
+double Kernel::Source( const unsigned int _r )
+{
+    volatile double sink = 0.0;
+
+    for ( unsigned int k = 0; k < _r; ++k )
+    {
+        SamSource s( mSam, mFile ); sink += Drain( s, mTable );
+    }   // every round
+
+    return( static_cast<double>( _r ) * mCigar.size() );
+}   // end of Source()
+
+/*
+ * load the baseline; one kernel per line: name, ns per call, allocations
+ * per call. lines starting with # are comments
+*/
+static bool Load(
+    const std::string& _f,
+    std::map<std::string, stKERNEL>& _b )
+{
+    std::ifstream ifs( _f.c_str(), std::ios::in );
+    std::string line;
+    char name[ 64 ];
+    stKERNEL k;
+
+    if ( ifs.fail() )
+    {
+        return( false );
+    }   // check the state of stream
+
+    while ( std::getline( ifs, line ) )
+    {
+        if ( line.empty() || ( line[ 0 ] == '#' ) ||
+            !( ::sscanf( line.c_str(), "%63s %lf %lf", name, &k.ns, &k.allocs ) == 3 ) )
+        {
+            continue;
+        }   // comments and malformed lines
+
+        k.name = name; _b[ k.name ] = k;
+    }   // parse the file
+
+    ifs.close(); return( true );
+}   // end of Load()
+
+/*
+ * driver program
+ *
+ * optional parameters:
+ * --kernels=a,b    kernels to be run; default all of them
+ * --time=F         minimum time of every kernel in seconds; default 0.25
+ * --baseline=F     compare against the baseline file F; fails on regressions
+ * --tolerance=F    allowed slowdown against the baseline; default 0.25
+ * --save=F         write the results as a new baseline file F
+ * --seed=N         seed of the synthetic inputs; default 1
+*/
+int main( int argc, char** argv )
+{
+    Option opt( argc, argv, "kernels,time,baseline,tolerance,save,seed" );
+    std::string kernels = opt.Get( "kernels",
+        "cigar,md,sanger,setbin,tokenize,aggregate,candidate,histogram,weight,shannon,loop,source" );
+    std::vector<std::string> name;
+    std::map<std::string, stKERNEL> baseline;
+    std::map<std::string, stKERNEL>::iterator b;
+    std::vector<stKERNEL> result;
+    double tolerance = opt.GetReal( "tolerance", 0.25 );
+    bool pass = true, fail;
+
+    if ( opt.Has( "baseline" ) && !Load( opt.Get( "baseline" ), baseline ) )
+    {
+        ::fprintf( stderr, "kernel: unable to read the baseline %s\n", opt.Get( "baseline" ).c_str() );
+        return( 1 );
+    }   // load the baseline
+
+    boost::algorithm::split( name, kernels, boost::algorithm::is_any_of( "," ) );
+    Kernel k( opt.GetSize( "seed", 1 ) );
+
+    ::printf( "%-10s %12s %12s %12s %s\n", "kernel", "ns/op", "allocs/op", "baseline", "status" );
+
+    for ( unsigned int i = 0; i < name.size(); ++i )
+    {
+        stKERNEL r = k.Run( name[ i ], opt.GetReal( "time", 0.25 ) );
+
+        if ( r.ns <= 0.0 )
+        {
+            ::fprintf( stderr, "kernel: unknown kernel %s\n", name[ i ].c_str() ); return( 1 );
+        }   // no such kernel
+
+        if ( ( b = baseline.find( r.name ) ) == baseline.end() )
+        {
+            ::printf( "%-10s %12.2f %12.2f %12s %s\n", r.name.c_str(), r.ns, r.allocs, "-", "-" );
+            result.push_back( r ); continue;
+        }   // nothing to compare against
+
+        fail = ( r.ns > ( *b ).second.ns * ( 1.0 + tolerance ) ) ||
+            ( r.allocs > ( *b ).second.allocs + 0.01 );
+        pass = pass && !fail;
+
+        ::printf( "%-10s %12.2f %12.2f %12.2f %s\n", r.name.c_str(), r.ns, r.allocs,
+            ( *b ).second.ns, ( fail ) ? "FAIL" : "pass" );
+        result.push_back( r );
+    }   // run the kernels
+
+    if ( opt.Has( "save" ) )
+    {
+        FILE* of = ::fopen( opt.Get( "save" ).c_str(), "w" );
+
+        if ( !of )
+        {
+            return( 1 );
+        }   // unable to write the baseline
+
+        ::fprintf( of, "# kernel ns/op allocs/op\n" );
+
+        for ( unsigned int i = 0; i < result.size(); ++i )
+        {
+            ::fprintf( of, "%s %.2f %.2f\n", result[ i ].name.c_str(), result[ i ].ns, result[ i ].allocs );
+        }   // every kernel
+
+        ::fclose( of );
+    }   // write the new baseline
+
+    return( ( pass ) ? 0 : 1 );
+}   // end of main()
@@ -0,0 +1,203 @@
+/*
+ * lineage.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * rollup of the species aggregates to the higher ranks
+*/
+
+#include <lineage.h>
+
+#include <cstdio>
+#include <boost/algorithm/string.hpp>
+
+Lineage::Lineage(
+    const std::map<unsigned int, stTABLE>& _t,
+    const std::vector<std::string>& _r ) : mRank( _r ), mName( _r.size() + 1 )
+{
+    unsigned int child, node;
+
+    for ( std::map<unsigned int, stTABLE>::const_iterator i = _t.begin(); !( i == _t.end() ); ++i )
+    {
+        const std::vector<std::string>& lineage = ( ( *i ).second ).lineage;
+        child = Node( 0, ( ( *i ).second ).species );
+
+        for ( unsigned int k = 0; ( k < lineage.size() ) && ( k < mRank.size() ); ++k )
+        {
+            if ( lineage[ k ].empty() )
+            {
+                continue;
+            }   // the rank is not known; the next rank is the parent
+
+            node = Node( k + 1, lineage[ k ] );
+
+            if ( mParent[ child ] < 0 )
+            {
+                mParent[ child ] = static_cast<int>( node );
+            }   // the first genome of the name decides
+
+            child = node;
+        }   // ranks of the lineage, from the genus upwards
+    }   // every genome of the table
+}   // end of constructor
+
+Lineage::~Lineage()
+{
+    mRank.clear(); mSelect.clear(); mName.clear(); mParent.clear();
+}   // default destructor; environmentally conscientious
+
+/*
+ * node of a name at a level; a new node has no parent
+*/
+unsigned int Lineage::Node(
+    const unsigned int _l,      // level; 0 is the species
+    const std::string& _s )     // name
+{
+    std::map<std::string, unsigned int>::iterator k = mName[ _l ].find( _s );
+
+    if ( k == mName[ _l ].end() )
+    {
+        k = mName[ _l ].insert( std::make_pair( _s, static_cast<unsigned int>( mParent.size() ) ) ).first;
+        mParent.push_back( -1 );
+    }   // the first genome of the name
+
+    return( ( *k ).second );
+}   // end of Node()
+
+/*
+ * write the pivot table of a rank, given by its name in the header of the
+ * translation table; false if the table has no such rank
+*/
+bool Lineage::Select(
+    const std::string& _r )     // name of the rank
+{
+    for ( unsigned int i = 0; i < mRank.size(); ++i )
+    {
+        if ( Clean( mRank[ i ] ) == Clean( _r ) )
+        {
+            mSelect.push_back( i + 1 ); return( true );
+        }   // the rank is in the table
+    }   // ranks of the lineage
+
+    return( false );
+}   // end of Select()
+
+/*
+ * number of ranks with a pivot table
+*/
+unsigned int Lineage::GetSize() const
+{
+    return( mSelect.size() );
+}   // end of GetSize()
+
+/*
+ * name of a rank with a pivot table, in the order of Select()
+*/
+std::string Lineage::GetRank(
+    const unsigned int _i ) const
+{
+    return( Clean( mRank[ mSelect[ _i ] - 1 ] ) );
+}   // end of GetRank()
+
+/*
+ * name of a rank in lower case and without the quotation marks, e.g., for
+ * the name of its pivot table
+*/
+std::string Lineage::Clean(
+    const std::string& _r )
+{
+    std::string rank = _r;
+
+    boost::algorithm::trim_if( rank, boost::algorithm::is_any_of( "\" " ) );
+    boost::algorithm::to_lower( rank );
+
+    return( rank );
+}   // end of Clean()
+
+/*
+ * aggregates of every node from those of the species; the levels are summed
+ * from the species upwards, so every node is visited once
+*/
+void Lineage::Rollup(
+    const std::map<std::string, stPIVOT>& _p,   // aggregates of the species
+    std::vector<stROLLUP>& _r ) const           // aggregates of the nodes
+{
+    std::map<std::string, unsigned int>::const_iterator k;
+
+    _r.assign( mParent.size(), stROLLUP() );
+
+    for ( std::map<std::string, stPIVOT>::const_iterator i = _p.begin(); !( i == _p.end() ); ++i )
+    {
+        if ( ( k = mName[ 0 ].find( ( *i ).first ) ) == mName[ 0 ].end() )
+        {
+            continue;
+        }   // species is not in the table
+
+        stROLLUP& r = _r[ ( *k ).second ];
+        r.count = static_cast<double>( ( ( ( *i ).second ).site ).size() );     // a read counts once
+        r.ratio = ( ( *i ).second ).ratio; r.length = ( ( *i ).second ).length;
+        r.odd = ( ( *i ).second ).odd; r.gap = ( ( *i ).second ).gap;
+        r.phred = ( ( *i ).second ).phred; r.score = ( ( *i ).second ).score;
+    }   // the species are the leaves
+
+    for ( unsigned int l = 0; l < mName.size(); ++l )
+    {
+        for ( k = mName[ l ].begin(); !( k == mName[ l ].end() ); ++k )
+        {
+            if ( !( mParent[ ( *k ).second ] < 0 ) )
+            {
+                _r[ mParent[ ( *k ).second ] ] += _r[ ( *k ).second ];
+            }   // the parent is on a higher level
+        }   // nodes of the level
+    }   // from the species upwards
+}   // end of Rollup()
+
+/*
+ * export the pivot table of a rank; the same columns as the pivot table of
+ * the species, without the confidence intervals
+*/
+bool Lineage::Write(
+    const std::string& _f,                  // name of the pivot table
+    const unsigned int _i,                  // rank of the pivot table
+    const std::vector<stROLLUP>& _r ) const // aggregates of the nodes
+{
+    FILE* of = ::fopen( _f.c_str(), "w" );
+    const std::map<std::string, unsigned int>& name = mName[ mSelect[ _i ] ];
+
+    if ( !of )
+    {
+        return( false );
+    }   // unable to write the table
+
+    ::fprintf( of, "%s,%s,%s,%s,%s,%s,%s,%s\n",     // header
+        "Taxon", "Abundance", "Identity", "Alignment Length",
+        "Mismatch", "Gap", "Read Quality", "Alignment Quality" );
+
+    for ( std::map<std::string, unsigned int>::const_iterator j = name.begin(); !( j == name.end() ); ++j )
+    {
+        const stROLLUP& r = _r[ ( *j ).second ];
+
+        if ( !( r.count > 0.0 ) )
+        {
+            continue;
+        }   // no read is assigned to the taxon
+
+        ::fprintf( of, "%s,%.0f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+            ( ( *j ).first ).c_str(),   // taxon
+            r.count,                    // abundance
+            r.ratio / r.count,          // average percent identity
+            r.length / r.count,         // average alignment length
+            r.odd / r.count,            // average number of mismatches
+            r.gap / r.count,            // average number of gaps
+            r.phred / r.count,          // average read quality
+            r.score / r.count );        // average alignment quality
+    }   // taxa of the rank
+
+    return( !::fclose( of ) );
+}   // end of Write()
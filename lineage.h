@@ -0,0 +1,85 @@
+/*
+ * lineage.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * rollup of the species aggregates to the higher ranks
+ *
+ * the lineage columns of the translation table, see table.h, are compiled
+ * into a tree of parent pointers: every species and every name of a higher
+ * rank is a node, and the parent of a node is the name of the next rank of
+ * its lineage that is known. if the genomes of a name disagree on its
+ * parent, the genome with the lowest gid decides.
+ *
+ * the reads are assigned to species once; the aggregates of the species are
+ * then added to their parents, one level after the other, so every rank is
+ * summed in a single pass over the nodes, and the cost does not depend on
+ * the number of reads. the pivot table of a rank, e.g., sample.genus.pivot.csv,
+ * has the same columns as that of the species, sample.pivot.csv.
+*/
+
+#ifndef _LINEAGE_H
+#define _LINEAGE_H
+
+#include <table.h>
+#include <pivot.h>
+
+#include <map>
+#include <vector>
+#include <string>
+
+struct stROLLUP
+{
+    stROLLUP()
+    {
+        count = 0.0; ratio = 0.0; length = 0.0; odd = 0.0; gap = 0.0; phred = 0.0; score = 0.0;
+    }   // default constructor
+
+    const stROLLUP& operator+=( const stROLLUP& _r )
+    {
+        count += _r.count; ratio += _r.ratio; length += _r.length;
+        odd += _r.odd; gap += _r.gap; phred += _r.phred; score += _r.score;
+
+        return( *this );
+    }   // operator overloading
+
+    double count;           // number of reads
+    double ratio;           // percent identity
+    double length;          // alignment length
+    double odd;             // number of mismatches
+    double gap;             // number of gaps
+    double phred;           // read quality
+    double score;           // alignment quality
+};  // aggregate of a node of the lineage
+
+class Lineage
+{
+public:
+    Lineage(
+        const std::map<unsigned int, stTABLE>&,     // translate table
+        const std::vector<std::string>& );          // names of the ranks
+    ~Lineage();
+
+    bool Select( const std::string& );
+    unsigned int GetSize() const;
+    std::string GetRank( const unsigned int ) const;
+    void Rollup( const std::map<std::string, stPIVOT>&, std::vector<stROLLUP>& ) const;
+    bool Write( const std::string&, const unsigned int, const std::vector<stROLLUP>& ) const;
+
+private:
+    std::vector<std::string> mRank;     // names of the ranks above the species
+    std::vector<unsigned int> mSelect;  // levels of the pivot tables; 1 is the first rank
+    std::vector<std::map<std::string, unsigned int> > mName;    // nodes of every level
+    std::vector<int> mParent;           // parent of every node; -1 for the roots
+
+    unsigned int Node( const unsigned int, const std::string& );
+    static std::string Clean( const std::string& );
+};  // end of class definition
+
+#endif  // _LINEAGE_H
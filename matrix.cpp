@@ -0,0 +1,770 @@
+/*
+ * matrix.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * abundance matrix of a cohort
+ *
+ * to compile:
+ * g++ -I. -O3 matrix.cpp report.cpp placement.cpp -o matrix -fopenmp
+*/
+
+#ifndef _LIB_MATRIX
+#define _DBG_MATRIX
+#endif  // _LIB_MATRIX; the merge is linked into another program
+
+#include <token.h>
+#include <placement.h>
+#include <matrix.h>
+#include <option.h>
+
+#include <cmath>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <unistd.h>
+#include <boost/algorithm/string.hpp>
+
+/*
+ * format of the binary matrix; offset of the number of rows in the header
+ * rows read ahead by every input
+ * inputs merged at once by default; every pivot table keeps two files open
+*/
+static const char* szMAGIC = "MCATMTRX";
+static const uint32_t nVERSION = 1;
+static const long nROWS = 16;
+static const unsigned int nMaxCHUNK = 1024;
+static const unsigned int nMaxOPEN = 256;
+
+Matrix::Matrix()
+{
+    mSparse = false; mBinary = false; mMaxOpen = nMaxOPEN; mReport = NULL;
+    mPath = ( ::getenv( "TMPDIR" ) ) ? ::getenv( "TMPDIR" ) : "/tmp";
+}   // default constructor
+
+Matrix::~Matrix()
+{
+    mSample.clear();
+}   // default destructor; environmentally conscientious
+
+/*
+ * write only the cells with reads, as a list instead of a table
+*/
+void Matrix::SetSparse(
+    const bool _s )
+{
+    mSparse = _s;
+}   // end of SetSparse()
+
+/*
+ * write the binary matrix instead of the text tables
+*/
+void Matrix::SetBinary(
+    const bool _b )
+{
+    mBinary = _b;
+}   // end of SetBinary()
+
+/*
+ * number of inputs merged at once; larger cohorts are merged in groups
+*/
+void Matrix::SetMaxOpen(
+    const unsigned int _n )
+{
+    mMaxOpen = std::max( _n, 2U );
+}   // end of SetMaxOpen()
+
+/*
+ * directory of the temporary files of the groups
+*/
+void Matrix::SetTmpDir(
+    const std::string& _p )
+{
+    mPath = _p;
+}   // end of SetTmpDir()
+
+/*
+ * attach the instrumentation; NULL detaches it
+*/
+void Matrix::SetReport(
+    Report* _r )
+{
+    mReport = _r;
+}   // end of SetReport()
+
+/*
+ * merge the pivot tables of the samples into the matrix; the samples are
+ * the columns in the given order
+*/
+bool Matrix::Run(
+    const std::vector<std::string>& _f,     // pivot tables of the samples
+    const std::string& _o )                 // base name of the outputs
+{
+    const std::string suffix = ".pivot.csv";
+    std::vector<std::string> input = _f;
+    std::vector<stPART> part;
+    stSINK sink;
+    bool done = !_f.empty(), binary = false;
+
+    mSample.clear(); mCount = stCOUNT();
+
+    for ( unsigned int i = 0; i < _f.size(); ++i )
+    {
+        mSample.push_back( boost::algorithm::ends_with( _f[ i ], suffix ) ?
+            _f[ i ].substr( 0, _f[ i ].size() - suffix.size() ) : _f[ i ] );
+    }   // a sample is named after its pivot table
+
+    if ( mReport )
+    {
+        mReport->Begin( "matrix", _f.empty() ? _o : _f[ 0 ] );
+    }   // instrumentation of the stage
+
+    while ( done )
+    {
+        const bool last = !( input.size() > mMaxOpen );
+        std::vector<std::string> next;
+
+        for ( unsigned int i = 0; done && ( i < input.size() ); i += mMaxOpen )
+        {
+            const unsigned int n = std::min<unsigned int>( mMaxOpen, input.size() - i );
+            std::string name = mPath + "/matrix.XXXXXX";
+            int fd = -1;
+
+            part.assign( n, stPART() );
+            sink.file[ 0 ] = sink.file[ 1 ] = sink.file[ 2 ] = NULL; sink.binary = false; sink.rows = 0;
+
+            for ( unsigned int k = 0; k < n; ++k )
+            {
+                done = Open( part[ k ], input[ i + k ], i + k, binary ) && done;
+            }   // open the inputs of the group
+
+            if ( !last && ( ( fd = ::mkstemp( &name[ 0 ] ) ) < 0 ) )
+            {
+                done = false;
+            }   // unable to create the temporary file
+
+            if ( !( fd < 0 ) )
+            {
+                ::close( fd ); next.push_back( name );
+            }   // the group is written under this name
+
+            done = done && Begin( sink, ( last ) ? _o : name, !last || mBinary, !last || mSparse );
+            done = done && Merge( part, sink );
+            done = End( sink ) && done;
+
+            if ( last )
+            {
+                mCount.output += sink.rows; mCount.written += sink.bytes;
+            }   // groups are not counted as outputs
+
+            for ( unsigned int k = 0; k < n; ++k )
+            {
+                Close( part[ k ] );
+            }   // close the inputs of the group
+        }   // merge every group
+
+        for ( unsigned int i = 0; binary && ( i < input.size() ); ++i )
+        {
+            ::unlink( input[ i ].c_str() );
+        }   // remove the groups of the previous pass
+
+        if ( last || !done )
+        {
+            for ( unsigned int i = 0; !done && ( i < next.size() ); ++i )
+            {
+                ::unlink( next[ i ].c_str() );
+            }   // remove the groups of an incomplete pass
+
+            break;
+        }   // the matrix is complete
+
+        input.swap( next ); binary = true;
+    }   // merge the groups until they fit
+
+    if ( mReport )
+    {
+        mReport->End( mCount );
+    }   // complete the stage
+
+    return( done );
+}   // end of Run()
+
+/*
+ * streaming k-way merge of the inputs; the rows of a species are taken from
+ * all inputs at once, and the inputs that ran out of rows are refilled in
+ * parallel before the next species is taken
+*/
+bool Matrix::Merge(
+    std::vector<stPART>& _p,    // inputs, in the order of the samples
+    stSINK& _s )                // output of the merge
+{
+    std::vector<unsigned int> heap, starve, take;
+    const SortHead order( &_p );
+    stROW row;
+
+    for ( unsigned int i = 0; i < _p.size(); ++i )
+    {
+        starve.push_back( i );
+    }   // every input starts empty
+
+    while ( true )
+    {
+        #pragma omp parallel for schedule( dynamic )
+        for ( long i = 0; i < static_cast<long>( starve.size() ); ++i )
+        {
+            Fill( _p[ starve[ i ] ] );
+        }   // read ahead, one thread per input
+
+        for ( unsigned int i = 0; i < starve.size(); ++i )
+        {
+            if ( _p[ starve[ i ] ].fail )
+            {
+                ::fprintf( stderr, "matrix: malformed or unsorted input %s\n", _p[ starve[ i ] ].name.c_str() );
+                return( false );
+            }   // the merge relies on the order of the species
+
+            if ( !_p[ starve[ i ] ].done )
+            {
+                mCount.records += _p[ starve[ i ] ].row.size();
+                heap.push_back( starve[ i ] ); std::push_heap( heap.begin(), heap.end(), order );
+            }   // the input has rows again
+        }   // every refilled input
+
+        if ( heap.empty() )
+        {
+            break;
+        }   // all inputs are exhausted
+
+        starve.clear(); take.clear();
+        row.taxon = _p[ heap.front() ].row.front().taxon; row.cell.clear();
+
+        while ( !heap.empty() && ( _p[ heap.front() ].row.front().taxon == row.taxon ) )
+        {
+            take.push_back( heap.front() );
+            std::pop_heap( heap.begin(), heap.end(), order ); heap.pop_back();
+        }   // every input with the species, in the order of the samples
+
+        for ( unsigned int i = 0; i < take.size(); ++i )
+        {
+            stPART& p = _p[ take[ i ] ];
+            row.cell.insert( row.cell.end(), p.row.front().cell.begin(), p.row.front().cell.end() );
+            p.row.pop_front();
+
+            if ( p.row.empty() )
+            {
+                starve.push_back( take[ i ] ); continue;
+            }   // refilled before the next species
+
+            heap.push_back( take[ i ] ); std::push_heap( heap.begin(), heap.end(), order );
+        }   // take the cells of the species
+
+        Write( _s, row );
+
+        if ( mReport )
+        {
+            mReport->Progress( mCount );
+        }   // periodic progress
+    }   // merge the species
+
+    return( true );
+}   // end of Merge()
+
+/*
+ * open an input; a pivot table together with its index, if there is one
+*/
+bool Matrix::Open(
+    stPART& _p,                 // input to be opened
+    const std::string& _f,      // name of the input
+    const uint32_t _c,          // index of the sample of a pivot table
+    const bool _b ) const       // binary matrix of a group
+{
+    const std::string suffix = ".pivot.csv";
+    char magic[ 8 ];
+    uint32_t version = 0, samples = 0, dense;
+    uint64_t rows;
+    uint16_t n;
+    std::string name;
+
+    _p.file = ::fopen( _f.c_str(), ( _b ) ? "rb" : "r" ); _p.wsei = NULL;
+    _p.binary = _b; _p.done = false; _p.fail = false; _p.column = _c;
+    _p.abundance = 0; _p.identity = 0; _p.name = _f; _p.last.clear(); _p.taxon.clear();
+    _p.index = 0.0; _p.bytes = 0.0; _p.line = NULL; _p.size = 0; _p.next = NULL; _p.length = 0;
+
+    if ( !_p.file )
+    {
+        ::fprintf( stderr, "matrix: unable to open %s\n", _f.c_str() ); return( false );
+    }   // check the state of stream
+
+    if ( _b )
+    {
+        if ( !( ::fread( magic, 8, 1, _p.file ) == 1 ) || ::memcmp( magic, szMAGIC, 8 ) ||
+            !( ::fread( &version, 4, 1, _p.file ) == 1 ) || !( version == nVERSION ) ||
+            !( ::fread( &samples, 4, 1, _p.file ) == 1 ) || !( ::fread( &rows, 8, 1, _p.file ) == 1 ) ||
+            !( ::fread( &dense, 4, 1, _p.file ) == 1 ) )
+        {
+            return( false );
+        }   // not a binary matrix
+
+        for ( uint32_t i = 0; i < samples; ++i )
+        {
+            if ( !( ::fread( &n, 2, 1, _p.file ) == 1 ) || ::fseek( _p.file, n, SEEK_CUR ) )
+            {
+                return( false );
+            }   // names of the samples are known
+        }   // skip the names of the samples
+
+        return( true );
+    }   // a group of a previous pass
+
+    if ( ::getline( &_p.line, &_p.size, _p.file ) < 0 )
+    {
+        ::fprintf( stderr, "matrix: empty pivot table %s\n", _f.c_str() ); return( false );
+    }   // header of the pivot table
+
+    ::Tokenize( _p.line, ",\r\n", _p.field );
+
+    for ( unsigned int i = 0; i < _p.field.size(); ++i )
+    {
+        _p.abundance = ( ::strcmp( _p.field[ i ], "Abundance" ) ) ? _p.abundance : i;
+        _p.identity = ( ::strcmp( _p.field[ i ], "Identity" ) ) ? _p.identity : i;
+    }   // columns of the values
+
+    if ( !( _p.abundance > 0 ) || !( _p.identity > 0 ) )
+    {
+        ::fprintf( stderr, "matrix: not a pivot table %s\n", _f.c_str() ); return( false );
+    }   // the columns are missing
+
+    if ( boost::algorithm::ends_with( _f, suffix ) )
+    {
+        name = _f.substr( 0, _f.size() - suffix.size() ) + ".wsei.csv";
+        _p.wsei = ::fopen( name.c_str(), "r" );
+    }   // index of the species next to the pivot table
+
+    if ( _p.wsei && ( ::getline( &_p.next, &_p.length, _p.wsei ) < 0 ) )
+    {
+        ::fclose( _p.wsei ); _p.wsei = NULL;
+    }   // skip the header of the index
+
+    return( true );
+}   // end of Open()
+
+/*
+ * close an input and release its buffers
+*/
+void Matrix::Close(
+    stPART& _p )
+{
+    if ( _p.file )
+    {
+        ::fclose( _p.file );
+    }   // the input has been opened
+
+    if ( _p.wsei )
+    {
+        ::fclose( _p.wsei );
+    }   // the index has been opened
+
+    ::free( _p.line ); ::free( _p.next );
+    _p.file = NULL; _p.wsei = NULL; _p.line = NULL; _p.next = NULL;
+    _p.row.clear(); mCount.bytes += _p.bytes;
+}   // end of Close()
+
+/*
+ * read ahead a chunk of rows; the species must be in strictly increasing
+ * order. called by one thread per input
+*/
+void Matrix::Fill(
+    stPART& _p ) const
+{
+    stROW r;
+
+    while ( !_p.fail && ( _p.row.size() < nMaxCHUNK ) &&
+        ( ( _p.binary ) ? Binary( _p, r ) : Text( _p, r ) ) )
+    {
+        if ( !_p.last.empty() && !( _p.last < r.taxon ) )
+        {
+            _p.fail = true; break;
+        }   // not sorted by species
+
+        _p.last = r.taxon;
+        _p.row.push_back( stROW() ); ( _p.row.back() ).taxon.swap( r.taxon ); ( _p.row.back() ).cell.swap( r.cell );
+    }   // read the rows of the chunk
+
+    _p.done = _p.row.empty();
+}   // end of Fill()
+
+/*
+ * a row of a pivot table: taxon, abundance, identity and the others
+*/
+bool Matrix::Text(
+    stPART& _p,
+    stROW& _r ) const
+{
+    ssize_t n;
+    stCELL c;
+
+    while ( ( n = ::getline( &_p.line, &_p.size, _p.file ) ) > 0 )
+    {
+        _p.bytes += n;
+
+        if ( ::strspn( _p.line, "\r\n" ) == static_cast<size_t>( n ) )
+        {
+            continue;
+        }   // blank lines are skipped
+
+        if ( !( ::Tokenize( _p.line, ",\r\n", _p.field ) > std::max( _p.abundance, _p.identity ) ) || !*_p.field[ 0 ] )
+        {
+            _p.fail = true; return( false );
+        }   // truncated row
+
+        break;
+    }   // read the next row
+
+    if ( !( n > 0 ) )
+    {
+        return( false );
+    }   // end of the table
+
+    c.column = _p.column;
+    c.count = static_cast<uint32_t>( ::atoi( _p.field[ _p.abundance ] ) );
+    c.identity = ::atof( _p.field[ _p.identity ] );
+    _r.taxon.assign( _p.field[ 0 ] ); _r.cell.assign( 1, c );
+    ( _r.cell.back() ).index = Index( _p, _r.taxon );
+
+    return( true );
+}   // end of Text()
+
+/*
+ * a row of a binary matrix
+*/
+bool Matrix::Binary(
+    stPART& _p,
+    stROW& _r ) const
+{
+    uint16_t n;
+    uint32_t count;
+
+    if ( !( ::fread( &n, 2, 1, _p.file ) == 1 ) )
+    {
+        return( false );
+    }   // end of the matrix
+
+    _r.taxon.resize( n ); _r.cell.resize( 0 );
+
+    if ( ( n > 0 ) && !( ::fread( &_r.taxon[ 0 ], n, 1, _p.file ) == 1 ) )
+    {
+        _p.fail = true; return( false );
+    }   // truncated row
+
+    if ( !( ::fread( &count, 4, 1, _p.file ) == 1 ) )
+    {
+        _p.fail = true; return( false );
+    }   // truncated row
+
+    _r.cell.resize( count );
+
+    for ( uint32_t i = 0; i < count; ++i )
+    {
+        if ( !( ::fread( &_r.cell[ i ].column, 4, 1, _p.file ) == 1 ) ||
+            !( ::fread( &_r.cell[ i ].count, 4, 1, _p.file ) == 1 ) ||
+            !( ::fread( &_r.cell[ i ].index, 8, 1, _p.file ) == 1 ) ||
+            !( ::fread( &_r.cell[ i ].identity, 8, 1, _p.file ) == 1 ) )
+        {
+            _p.fail = true; return( false );
+        }   // truncated row
+    }   // every cell of the row
+
+    _p.bytes += 6.0 + n + 24.0 * count;
+
+    return( true );
+}   // end of Binary()
+
+/*
+ * index of a species in the sample; the index file is sorted the same way
+ * as the pivot table, so it is read along with it. the fields of the row
+ * have been used, so their storage is reused
+*/
+double Matrix::Index(
+    stPART& _p,
+    const std::string& _t ) const   // species of the row
+{
+    std::vector<const char*>& field = _p.field;
+
+    while ( _p.wsei && ( _p.taxon < _t ) )
+    {
+        if ( ::getline( &_p.next, &_p.length, _p.wsei ) < 0 )
+        {
+            ::fclose( _p.wsei ); _p.wsei = NULL; _p.taxon.clear(); break;
+        }   // no more indices
+
+        if ( ::Tokenize( _p.next, ",\r\n", field ) > 1 )
+        {
+            _p.taxon.assign( field[ 0 ] ); _p.index = ::atof( field[ 1 ] );
+        }   // species and index
+    }   // skip the species without reads
+
+    return( ( _p.taxon == _t ) ? _p.index : std::numeric_limits<double>::quiet_NaN() );
+}   // end of Index()
+
+/*
+ * create the outputs: the binary matrix, the sparse table, or the dense
+ * tables of the abundance, index and identity
+*/
+bool Matrix::Begin(
+    stSINK& _s,                 // output of the merge
+    const std::string& _o,      // name of the binary matrix or base name of the tables
+    const bool _b,              // binary matrix
+    const bool _p ) const       // only the cells with reads
+{
+    const char* szVALUE[ 3 ] = { ".abundance.csv", ".wsei.csv", ".identity.csv" };
+    const uint32_t dense = ( _p ) ? 0 : 1;
+    const uint64_t rows = 0;
+    uint16_t n;
+    bool done = true;
+
+    _s.binary = _b; _s.sparse = _p; _s.samples = mSample.size(); _s.rows = 0; _s.bytes = 0.0;
+    _s.file[ 0 ] = _s.file[ 1 ] = _s.file[ 2 ] = NULL;
+
+    if ( _b )
+    {
+        done = ( _s.file[ 0 ] = ::fopen( _o.c_str(), "wb" ) ) != NULL;
+        done = done && ( ::fwrite( szMAGIC, 8, 1, _s.file[ 0 ] ) == 1 ) &&
+            ( ::fwrite( &nVERSION, 4, 1, _s.file[ 0 ] ) == 1 ) && ( ::fwrite( &_s.samples, 4, 1, _s.file[ 0 ] ) == 1 ) &&
+            ( ::fwrite( &rows, 8, 1, _s.file[ 0 ] ) == 1 ) && ( ::fwrite( &dense, 4, 1, _s.file[ 0 ] ) == 1 );
+
+        for ( uint32_t i = 0; done && ( i < _s.samples ); ++i )
+        {
+            n = static_cast<uint16_t>( mSample[ i ].size() );
+            done = ( ::fwrite( &n, 2, 1, _s.file[ 0 ] ) == 1 ) &&
+                ( ::fwrite( mSample[ i ].data(), 1, n, _s.file[ 0 ] ) == n );
+        }   // names of the samples
+
+        return( done );
+    }   // the header of the binary matrix is rewritten at the end
+
+    if ( _p )
+    {
+        if ( ( _s.file[ 0 ] = ::fopen( ( _o + ".sparse.csv" ).c_str(), "w" ) ) == NULL )
+        {
+            return( false );
+        }   // unable to create the table
+
+        ::fprintf( _s.file[ 0 ], "%s,%s,%s,%s,%s\n", "Taxon", "Sample", "Abundance", "WSEI", "Identity" );
+
+        return( true );
+    }   // cells with reads only
+
+    for ( unsigned int k = 0; k < 3; ++k )
+    {
+        if ( ( _s.file[ k ] = ::fopen( ( _o + szVALUE[ k ] ).c_str(), "w" ) ) == NULL )
+        {
+            return( false );
+        }   // unable to create the table
+
+        ::fprintf( _s.file[ k ], "%s", "Taxon" );
+
+        for ( uint32_t i = 0; i < _s.samples; ++i )
+        {
+            ::fprintf( _s.file[ k ], ",%s", mSample[ i ].c_str() );
+        }   // one column per sample
+
+        ::fprintf( _s.file[ k ], "\n" );
+    }   // one table per value
+
+    return( true );
+}   // end of Begin()
+
+/*
+ * complete the outputs; the binary matrix gets the number of rows
+*/
+bool Matrix::End(
+    stSINK& _s ) const
+{
+    bool done = true;
+
+    _s.bytes = 0.0;
+
+    for ( unsigned int k = 0; k < 3; ++k )
+    {
+        _s.bytes += ( _s.file[ k ] ) ? ::ftell( _s.file[ k ] ) : 0;
+    }   // size of the outputs
+
+    if ( _s.binary && _s.file[ 0 ] )
+    {
+        done = !::fseek( _s.file[ 0 ], nROWS, SEEK_SET ) && ( ::fwrite( &_s.rows, 8, 1, _s.file[ 0 ] ) == 1 );
+    }   // number of rows in the header
+
+    for ( unsigned int k = 0; k < 3; ++k )
+    {
+        if ( _s.file[ k ] )
+        {
+            done = !::fclose( _s.file[ k ] ) && done; _s.file[ k ] = NULL;
+        }   // the output has been opened
+    }   // every output
+
+    return( done );
+}   // end of End()
+
+/*
+ * write a row; the cells are in the order of the samples
+*/
+void Matrix::Write(
+    stSINK& _s,
+    const stROW& _r ) const
+{
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const uint16_t n = static_cast<uint16_t>( _r.taxon.size() );
+    const uint32_t count = ( _s.sparse ) ? _r.cell.size() : _s.samples;
+    const uint32_t zero = 0;
+    unsigned int k = 0;
+
+    _s.rows += 1;
+
+    if ( _s.binary )
+    {
+        FILE* of = _s.file[ 0 ];
+        ::fwrite( &n, 2, 1, of ); ::fwrite( _r.taxon.data(), 1, n, of ); ::fwrite( &count, 4, 1, of );
+
+        for ( uint32_t i = 0; i < count; ++i )
+        {
+            const bool have = _s.sparse || ( ( k < _r.cell.size() ) && ( _r.cell[ k ].column == i ) );
+            const stCELL* c = ( have ) ? &_r.cell[ ( _s.sparse ) ? i : k++ ] : NULL;
+
+            ::fwrite( ( c ) ? &c->column : &i, 4, 1, of );
+            ::fwrite( ( c ) ? &c->count : &zero, 4, 1, of );
+            ::fwrite( ( c ) ? &c->index : &nan, 8, 1, of );
+            ::fwrite( ( c ) ? &c->identity : &nan, 8, 1, of );
+        }   // every cell of the row
+
+        return;
+    }   // binary matrix
+
+    if ( _s.sparse )
+    {
+        for ( unsigned int i = 0; i < _r.cell.size(); ++i )
+        {
+            const stCELL& c = _r.cell[ i ];
+
+            ::fprintf( _s.file[ 0 ], "%s,%s,%u,", _r.taxon.c_str(), mSample[ c.column ].c_str(), c.count );
+            ( std::isnan( c.index ) ) ? ::fprintf( _s.file[ 0 ], "NA," ) : ::fprintf( _s.file[ 0 ], "%.2f,", c.index );
+            ::fprintf( _s.file[ 0 ], "%.2f\n", c.identity );
+        }   // every cell with reads
+
+        return;
+    }   // sparse table
+
+    for ( unsigned int i = 0; i < 3; ++i )
+    {
+        ::fprintf( _s.file[ i ], "%s", _r.taxon.c_str() );
+    }   // species of the row
+
+    for ( uint32_t i = 0; i < _s.samples; ++i )
+    {
+        if ( !( ( k < _r.cell.size() ) && ( _r.cell[ k ].column == i ) ) )
+        {
+            ::fprintf( _s.file[ 0 ], ",0" ); ::fprintf( _s.file[ 1 ], ",NA" ); ::fprintf( _s.file[ 2 ], ",NA" );
+            continue;
+        }   // no reads of the species in the sample
+
+        const stCELL& c = _r.cell[ k++ ];
+
+        ::fprintf( _s.file[ 0 ], ",%u", c.count );
+        ( std::isnan( c.index ) ) ? ::fprintf( _s.file[ 1 ], ",NA" ) : ::fprintf( _s.file[ 1 ], ",%.2f", c.index );
+        ::fprintf( _s.file[ 2 ], ",%.2f", c.identity );
+    }   // every sample
+
+    for ( unsigned int i = 0; i < 3; ++i )
+    {
+        ::fprintf( _s.file[ i ], "\n" );
+    }   // end of the row
+}   // end of Write()
+
+#ifdef _DBG_MATRIX
+
+/*
+ * driver program
+ *
+ * required parameters:
+ * base name of the outputs
+ * pivot tables of the samples, sample.pivot.csv; the index of the species
+ * is read from sample.wsei.csv if there is one
+ *
+ * optional parameters:
+ * --list=F         read the names of the pivot tables from F, one per line
+ * --sparse         write the cells with reads as a list, base.sparse.csv,
+ *                  instead of base.abundance.csv, base.wsei.csv and
+ *                  base.identity.csv
+ * --binary         write the binary matrix, base.matrix.bin
+ * --max-open=N     inputs merged at once; default 256
+ * --tmp-dir=PATH   directory of the temporary files; default $TMPDIR
+ * --report=F       write the instrumentation of the run to F in json
+ * --progress       periodic progress with throughput and eta on stderr
+ * --threads=N      number of threads; default OMP_NUM_THREADS or all processors
+*/
+int main( int argc, char** argv )
+{
+    Option opt( argc, argv, "list,max-open,tmp-dir,report,threads" );
+    const std::vector<std::string>& arg = opt.GetArgs();
+    std::vector<std::string> pivot( arg.begin() + ( ( arg.empty() ) ? 0 : 1 ), arg.end() );
+    std::ifstream ifs;
+    std::string line;
+
+    if ( opt.Has( "list" ) )
+    {
+        ifs.open( opt.Get( "list" ).c_str(), std::ios::in );
+
+        while ( std::getline( ifs, line ) )
+        {
+            boost::algorithm::trim( line );
+
+            if ( !line.empty() )
+            {
+                pivot.push_back( line );
+            }   // ignore blank lines
+        }   // one pivot table per line
+    }   // names of the pivot tables
+
+    if ( arg.empty() || pivot.empty() )
+    {
+        return( 0 );
+    }   // check the number of parameters
+
+    Numa::SetThreads( opt.GetSize( "threads", 0 ) );
+    Matrix m; m.SetSparse( opt.Has( "sparse" ) ); m.SetBinary( opt.Has( "binary" ) );
+    m.SetMaxOpen( opt.GetSize( "max-open", nMaxOPEN ) );
+
+    if ( opt.Has( "tmp-dir" ) )
+    {
+        m.SetTmpDir( opt.Get( "tmp-dir" ) );
+    }   // directory of the groups
+
+    Report r; r.SetProgress( opt.Has( "progress" ) );
+
+    if ( opt.Has( "report" ) || opt.Has( "progress" ) )
+    {
+        m.SetReport( &r );
+    }   // instrumentation of the run
+
+    if ( !m.Run( pivot, ( opt.Has( "binary" ) ) ? arg[ 0 ] + ".matrix.bin" : arg[ 0 ] ) )
+    {
+        return( 1 );
+    }   // unable to build the matrix
+
+    if ( opt.Has( "report" ) )
+    {
+        r.Write( opt.Get( "report" ) );
+    }   // write the report at exit
+
+    return( 0 );
+}   // end of main()
+
+#endif  // _DBG_MATRIX
@@ -0,0 +1,151 @@
+/*
+ * matrix.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * abundance matrix of a cohort
+ *
+ * the pivot tables of the samples are already sorted by species, so the
+ * matrix is built by a streaming k-way merge: every input keeps a chunk of
+ * its rows, the smallest species of all inputs is taken from a heap, and
+ * the row of the species is written as soon as it is complete. the inputs
+ * that ran out of rows are refilled in parallel, one thread per file, so
+ * the memory only depends on the number of inputs open at once. cohorts
+ * with more inputs than that are merged in groups into temporary files,
+ * which are merged again.
+ *
+ * every cell holds the abundance, the weighted shannon index and the
+ * average percent identity of a species in a sample. the index is read from
+ * sample.wsei.csv next to sample.pivot.csv, if there is one.
+ *
+ * text output: a dense table per value, species by samples, with 0 or NA
+ * where a sample has no reads of the species; or one sparse table of the
+ * cells with reads: species, sample, abundance, index and identity.
+ *
+ * binary output, also used for the groups: magic "MCATMTRX", version,
+ * number of samples (4 bytes each), number of rows (8 bytes), dense flag
+ * (4 bytes); then the length (2 bytes) and name of every sample; then every
+ * row as the length (2 bytes) and name of the species, the number of cells
+ * (4 bytes) and every cell as sample, abundance (4 bytes each), index and
+ * identity (8 bytes each), in the order of the samples. a dense matrix has
+ * a cell for every sample; the index is nan if it is not available.
+*/
+
+#ifndef _MATRIX_H
+#define _MATRIX_H
+
+#include <report.h>
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <stdint.h>
+
+class Matrix
+{
+public:
+    Matrix();
+    ~Matrix();
+
+    bool Run( const std::vector<std::string>&, const std::string& );
+    void SetSparse( const bool );
+    void SetBinary( const bool );
+    void SetMaxOpen( const unsigned int );
+    void SetTmpDir( const std::string& );
+    void SetReport( Report* );
+
+private:
+    struct stCELL
+    {
+        uint32_t column;        // index of the sample
+        uint32_t count;         // abundance; number of reads
+        double index;           // weighted shannon index; nan if not available
+        double identity;        // average percent identity
+    };  // a species in a sample
+
+    struct stROW
+    {
+        std::string taxon;          // species
+        std::vector<stCELL> cell;   // samples with reads of the species
+    };  // a row of the matrix
+
+    struct stPART
+    {
+        FILE* file;             // pivot table or binary matrix
+        FILE* wsei;             // species level index; NULL if not available
+        bool binary;            // binary matrix of a group
+        bool done;              // no more rows
+        bool fail;              // malformed or unsorted input
+        uint32_t column;        // index of the sample of a pivot table
+        unsigned int abundance; // column of the abundance in the pivot table
+        unsigned int identity;  // column of the identity in the pivot table
+        std::string name;       // name of the input
+        std::string last;       // last species read
+        std::string taxon;      // species of the next index
+        double index;           // next index
+        double bytes;           // bytes read
+        char* line;             // buffer of the lines
+        size_t size;            // size of the buffer
+        char* next;             // buffer of the index
+        size_t length;          // size of the buffer of the index
+        std::vector<const char*> field;     // fields of the line
+        std::deque<stROW> row;  // rows read ahead
+    };  // an input of the merge
+
+    struct stSINK
+    {
+        FILE* file[ 3 ];        // abundance, index and identity; or the only file
+        bool binary;            // binary matrix
+        bool sparse;            // only the cells with reads
+        uint32_t samples;       // number of samples
+        uint64_t rows;          // rows written
+        double bytes;           // bytes written
+    };  // output of the merge
+
+    /*
+     * min-heap of the inputs by their next species; ties are broken by the
+     * order of the inputs, so the cells of a row stay in the order of the samples
+    */
+    struct SortHead
+    {
+        SortHead( const std::vector<stPART>* _p ) : p( _p ) {}
+
+        bool operator()( const unsigned int _a, const unsigned int _b ) const
+        {
+            int k = ( *p )[ _a ].row.front().taxon.compare( ( *p )[ _b ].row.front().taxon );
+
+            return( ( k ) ? ( k > 0 ) : ( _a > _b ) );
+        }   // end of operator overloading
+
+        const std::vector<stPART>* p;
+    };  // end of class SortHead
+
+    bool mSparse;           // write only the cells with reads
+    bool mBinary;           // write the binary matrix
+    unsigned int mMaxOpen;  // inputs merged at once
+    std::string mPath;      // directory of the temporary files
+    std::vector<std::string> mSample;   // names of the samples
+    Report* mReport;        // instrumentation; NULL if not attached
+    stCOUNT mCount;         // counters of the stage
+
+    bool Merge( std::vector<stPART>&, stSINK& );
+    bool Open( stPART&, const std::string&, const uint32_t, const bool ) const;
+    void Close( stPART& );
+    void Fill( stPART& ) const;
+    bool Text( stPART&, stROW& ) const;
+    bool Binary( stPART&, stROW& ) const;
+    double Index( stPART&, const std::string& ) const;
+
+    bool Begin( stSINK&, const std::string&, const bool, const bool ) const;
+    bool End( stSINK& ) const;
+    void Write( stSINK&, const stROW& ) const;
+};  // end of class definition
+
+#endif  // _MATRIX_H
@@ -0,0 +1,474 @@
+/*
+ * online.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * online strain and species level assignment
+*/
+
+#include <token.h>
+#include <reader.h>
+#include <online.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <boost/algorithm/string.hpp>
+
+/*
+ * a read without an assignment
+*/
+static const size_t nNONE = static_cast<size_t>( -1 );
+
+Online::Online(
+    const std::map<unsigned int, stTABLE>& _t ) : mTable( _t ), mStrain( _t ),
+    mSpecies( _t, std::map<unsigned int, double>() ), mRead( Codec::Order( &mCodec ) )
+{
+    mDense.clear(); mStray.clear(); mDirty.clear(); mRead.clear(); mOwner.clear(); mCandidate.clear();
+    mBest.clear(); mPivot.clear(); mAbundance.clear();
+    mRecords = 1000000.0; mSeconds = 60.0; mReady = false; mReport = NULL;
+    mIdentity = 70.0; mMinIndex = 0.15; mMinIdentity = 85.0;
+}   // default constructor
+
+Online::~Online()
+{
+    mDense.clear(); mStray.clear(); mDirty.clear(); mRead.clear(); mOwner.clear(); mCandidate.clear();
+    mBest.clear(); mPivot.clear(); mAbundance.clear();
+}   // default destructor; environmentally conscientious
+
+/*
+ * a snapshot is written after the given number of records or seconds,
+ * whichever comes first; the clock is checked as the records arrive
+*/
+void Online::SetInterval(
+    const double _n,            // records between snapshots; 0 disables
+    const double _s )           // seconds between snapshots; 0 disables
+{
+    mRecords = _n; mSeconds = _s;
+}   // end of SetInterval()
+
+/*
+ * thresholds of the strain and species level assignments
+*/
+void Online::SetThreshold(
+    const double _s,            // minimum average identity of a strain
+    const double _w,            // minimum weighted shannon index
+    const double _i )           // minimum percent identity
+{
+    mIdentity = _s; mMinIndex = _w; mMinIdentity = _i;
+    mStrain.SetIdentity( _s ); mSpecies.SetThreshold( _w, _i );
+}   // end of SetThreshold()
+
+/*
+ * attach the instrumentation; NULL detaches it
+*/
+void Online::SetReport(
+    Report* _r )
+{
+    mReport = _r;
+}   // end of SetReport()
+
+/*
+ * follow sample.summary.csv, or the standard input given as "-", until the
+ * end of the stream; the snapshots and the final tables are written as
+ * sample.strain.csv, sample.pivot.csv and, at the end, sample.assign.csv
+*/
+bool Online::Run( const std::string& _f )
+{
+    const char* szDELIMIT = ",\t\n";
+    std::vector<const char*> field;
+    std::vector<std::string> name;
+    std::string line;
+    double last, next = mRecords;
+
+    boost::algorithm::split(                // splite the entire string
+        name, _f, boost::algorithm::is_any_of( ".\n" ) );
+    mBase = ( _f == "-" ) ? "stdin" : name[ 0 ];
+
+    Reader ifs( _f );
+
+    if ( !ifs.IsOpen() )
+    {
+        return( false );
+    }   // check the state of stream
+
+    if ( mReport )
+    {
+        mReport->Begin( "online", _f );
+    }   // instrumentation of the stage
+
+    ifs.GetLine( line );    // skip the header
+    mCount = stCOUNT(); mCount.bytes = line.size() + 1; last = Report::Clock();
+
+    while ( ifs.GetLine( line ) )
+    {
+        mCount.records += 1.0; mCount.bytes += line.size() + 1;
+
+        if ( mReport )
+        {
+            mReport->Progress( mCount );
+        }   // periodic progress
+
+        if ( line.empty() || ( Tokenize( &line[ 0 ], szDELIMIT, field ) < 11 ) )
+        {
+            mCount.reject[ nREJECT_FIELD ] += 1.0; continue;
+        }   // truncated records
+
+        Update( field );
+
+        if ( ( ( mRecords > 0.0 ) && !( mCount.records < next ) ) ||
+            ( ( mSeconds > 0.0 ) && !( Report::Clock() - last < mSeconds ) ) )
+        {
+            Snapshot(); last = Report::Clock(); next = mCount.records + mRecords;
+        }   // the tables are replaced
+    }   // the records are processed as they arrive
+
+    Final();
+
+    if ( mReport )
+    {
+        mReport->End( mCount );
+    }   // complete the stage
+
+    return( true );
+}   // end of Run()
+
+/*
+ * a single record updates the strain level aggregates, the same as
+ * Strain::Assign(), and becomes a candidate of its read, the same as
+ * Species::Assign() except that the index is not known yet; records of taxa
+ * that are not in the table, e.g., not on the panel, are skipped
+*/
+void Online::Update(
+    const std::vector<const char*>& _f )    // fields of the record
+{
+    std::map<unsigned int, stPIVOT>::iterator k;
+    std::map<uint64_t, unsigned int, Codec::Order>::iterator r;
+    unsigned int tid = static_cast<unsigned int>( ::atoi( _f[ 10 ] ) );     // ncbi tid
+    stPIVOT set;
+
+    set.ratio = static_cast<double>( ::atof( _f[ 1 ] ) );       // percent identity
+    set.length = static_cast<unsigned int>( ::atoi( _f[ 2 ] ) );    // alignment length
+    set.odd = static_cast<unsigned int>( ::atoi( _f[ 3 ] ) );   // mismatches
+    set.gap = static_cast<unsigned int>( ::atoi( _f[ 4 ] ) );   // gaps
+    set.phred = static_cast<double>( ::atof( _f[ 5 ] ) );       // read quality
+    set.score = static_cast<unsigned int>( ::atoi( _f[ 6 ] ) ); // map quality
+    set.tid = tid;
+
+    if ( ( ( mStrain.mBlock ).find( tid ) == ( mStrain.mBlock ).end() ) ||
+        ( ( mSpecies.mTaxon ).find( tid ) == ( mSpecies.mTaxon ).end() ) )
+    {
+        mCount.reject[ nREJECT_TABLE ] += 1.0; return;
+    }   // taxon is not in the table, e.g., not on the panel
+
+    if ( set.ratio < mMinIdentity )
+    {
+        mCount.reject[ nREJECT_IDENTITY ] += 1.0;
+    }   // only process good alignment
+    else
+    {
+        const uint64_t rid = mCodec.Encode( _f[ 0 ], ::strlen( _f[ 0 ] ) );
+
+        if ( ( r = mRead.find( rid ) ) == mRead.end() )
+        {
+            r = mRead.insert( std::make_pair( rid, static_cast<unsigned int>( mRead.size() ) ) ).first;
+            mBest.push_back( nNONE );
+        }   // the first candidate of the read
+
+        mOwner.push_back( ( *r ).second ); mCandidate.push_back( set );
+        Offer( ( *r ).second, mCandidate.size() - 1 );
+    }   // candidate of the species level assignment
+
+    ( set.site ).push_back( static_cast<unsigned int>( ::atoi( _f[ 7 ] ) ) );
+
+    if ( ( _f.size() > 11 ) && ( ::atoi( _f[ 11 ] ) > 1 ) )
+    {
+        ( set.site ).push_back( static_cast<unsigned int>( ::atoi( _f[ 8 ] ) ) );
+        set.ratio *= 2.0; set.phred *= 2.0; set.score *= 2;
+    }   // merged paired-end template; both segments count towards the averages
+
+    std::vector<unsigned int>& dense = mDense[ tid ];
+    unsigned int local;
+
+    if ( dense.empty() )
+    {
+        dense.resize( ( mStrain.mBlock )[ tid ], 0 );
+    }   // one counter for every bin of the genomes of the taxon
+
+    for ( unsigned int i = 0; i < ( set.site ).size(); ++i )
+    {
+        ( Local( tid, ( set.site )[ i ], local ) ) ?
+            dense[ local ] += 1 : mStray[ tid ][ ( set.site )[ i ] ] += 1;
+    }   // every segment of the template
+
+    ( set.site ).clear(); mDirty.insert( tid );
+
+    ( ( k = ( mStrain.mAssign ).find( tid ) ) == ( mStrain.mAssign ).end() ) ?
+        ( mStrain.mAssign )[ tid ] = set : ( *k ).second += set;
+}   // end of Update()
+
+/*
+ * the candidate replaces the current assignment of its read if it is better;
+ * once the indices are known, only species with an index are assigned
+*/
+void Online::Offer(
+    const unsigned int _r,      // number of the read
+    const size_t _c )           // number of the candidate
+{
+    const stPIVOT& p = mCandidate[ _c ];
+    size_t& b = mBest[ _r ];
+
+    if ( mReady && ( ( mSpecies.mIndex ).find(
+        ( mSpecies.mTaxon ).find( p.tid )->second ) == ( mSpecies.mIndex ).end() ) )
+    {
+        return;
+    }   // histogram not aviable for assignment
+
+    if ( !( b == nNONE ) && !Better( mCandidate[ b ], p ) )
+    {
+        return;
+    }   // keep the current assignment
+
+    if ( !( b == nNONE ) )
+    {
+        Change( mCandidate[ b ], false );
+    }   // the read leaves its species
+
+    Change( p, true ); b = _c;
+}   // end of Offer()
+
+/*
+ * add an assignment to the aggregates of its species, or remove it
+*/
+void Online::Change(
+    const stPIVOT& _p,          // assignment
+    const bool _a )             // add the assignment; remove if false
+{
+    const std::string& sid = ( mSpecies.mTaxon ).find( _p.tid )->second;
+    std::map<std::string, stPIVOT>::iterator k = mPivot.find( sid );
+
+    if ( _a )
+    {
+        ( k == mPivot.end() ) ? mPivot[ sid ] = _p : ( *k ).second += _p;
+        mAbundance[ sid ] += 1.0; return;
+    }   // summarize the assignment
+
+    if ( !( ( mAbundance[ sid ] -= 1.0 ) > 0.0 ) )
+    {
+        mPivot.erase( k ); mAbundance.erase( sid ); return;
+    }   // the last read of the species
+
+    stPIVOT& s = ( *k ).second;
+    s.ratio -= _p.ratio; s.phred -= _p.phred; s.length -= _p.length;
+    s.odd -= _p.odd; s.gap -= _p.gap; s.score -= _p.score;
+}   // end of Change()
+
+/*
+ * the same rules as Species::Better() with the indices of the last snapshot
+*/
+bool Online::Better(
+    const stPIVOT& _a,          // current assignment
+    const stPIVOT& _p ) const   // potential assignment
+{
+    unsigned int d1 = _a.length - _a.odd;
+    unsigned int d2 = _p.length - _p.odd;
+
+    if ( d1 > d2 )
+    {
+        return( false );
+    }   // new assignment is better
+
+    if ( Rank( ( mSpecies.mTaxon ).find( _a.tid )->second ) >
+        Rank( ( mSpecies.mTaxon ).find( _p.tid )->second ) )
+    {
+        return( false );
+    }   // original shannon index is higher
+
+    return( true );
+}   // end of Better()
+
+/*
+ * weighted shannon index of a species; 0 if it has none
+*/
+double Online::Rank( const std::string& _s ) const
+{
+    std::map<std::string, double>::const_iterator i = ( mSpecies.mIndex ).find( _s );
+
+    return( ( i == ( mSpecies.mIndex ).end() ) ? 0.0 : ( *i ).second );
+}   // end of Rank()
+
+/*
+ * position of a bin among the bins of the genomes of its taxon; false if the
+ * bin lies outside of them
+*/
+bool Online::Local(
+    const unsigned int _t,      // ncbi tid
+    const unsigned int _b,      // bin of the hit
+    unsigned int& _l ) const    // position of the bin
+{
+    const std::vector<Strain::stPART>& part = ( ( mStrain.mGenome ).find( _t ) )->second;
+    unsigned int offset = 0;
+
+    for ( unsigned int g = 0; g < part.size(); ++g )
+    {
+        if ( _b < part[ g ].start )
+        {
+            return( false );
+        }   // before the genome, or between two of them
+
+        if ( !( _b > part[ g ].end ) )
+        {
+            _l = offset + _b - part[ g ].start; return( true );
+        }   // the bin of the genome
+
+        offset += part[ g ].end - part[ g ].start + 1;
+    }   // the genomes in the order of their bins
+
+    return( false );
+}   // end of Local()
+
+/*
+ * histograms of the taxa hit since the last snapshot
+*/
+void Online::Rebuild()
+{
+    std::map<unsigned int, unsigned int> none;
+    std::map<unsigned int, unsigned int>::const_iterator s;
+    std::map<unsigned int, std::map<unsigned int, unsigned int> >::const_iterator k;
+    unsigned int offset;
+    stBIN b;
+
+    for ( std::set<unsigned int>::iterator i = mDirty.begin(); !( i == mDirty.end() ); ++i )
+    {
+        const std::vector<unsigned int>& dense = mDense[ *i ];
+        const std::vector<Strain::stPART>& part = ( ( mStrain.mGenome ).find( *i ) )->second;
+        const std::map<unsigned int, unsigned int>& stray =
+            ( ( k = mStray.find( *i ) ) == mStray.end() ) ? none : ( *k ).second;
+        std::vector<stBIN>& h = ( mStrain.mHistogram )[ *i ];
+        h.clear(); offset = 0; s = stray.begin();
+
+        for ( unsigned int g = 0; g < part.size(); ++g )
+        {
+            for ( ; !( s == stray.end() ) && ( ( *s ).first < part[ g ].start ); ++s )
+            {
+                b.bin = ( *s ).first; b.count = ( *s ).second; h.push_back( b );
+            }   // hits before the genome
+
+            for ( unsigned int n = 0; n < part[ g ].end - part[ g ].start + 1; ++n )
+            {
+                if ( dense[ offset + n ] > 0 )
+                {
+                    b.bin = part[ g ].start + n; b.count = dense[ offset + n ]; h.push_back( b );
+                }   // bins without hits are not kept
+            }   // bins of the genome
+
+            offset += part[ g ].end - part[ g ].start + 1;
+        }   // the same histogram as Strain::Count()
+
+        for ( ; !( s == stray.end() ); ++s )
+        {
+            b.bin = ( *s ).first; b.count = ( *s ).second; h.push_back( b );
+        }   // hits after the last genome
+
+        ( mStrain.mCoverage )[ *i ] = std::make_pair(
+            ( h.empty() ) ? NULL : &h[ 0 ], static_cast<unsigned int>( h.size() ) );
+    }   // every taxon hit since the last snapshot
+
+    mDirty.clear();
+}   // end of Rebuild()
+
+/*
+ * replace the strain and species tables with the current state
+*/
+void Online::Snapshot()
+{
+    std::string file;
+
+    Rebuild();
+    file = mBase + ".strain.csv"; mStrain.Output( file + ".tmp" ); Replace( file );
+    mSpecies.mWeight = mStrain.GetIndex(); mSpecies.Index(); mReady = true;
+    file = mBase + ".pivot.csv"; Pivot( file + ".tmp" ); Replace( file );
+
+    mCount.output += 1.0;
+}   // end of Snapshot()
+
+/*
+ * the last snapshot; every candidate is resolved again with the final
+ * indices, the same as Species::Run()
+*/
+bool Online::Final()
+{
+    std::string file;
+
+    Rebuild();
+    file = mBase + ".strain.csv"; mStrain.Output( file + ".tmp" ); Replace( file );
+    mCount.written = Report::GetSize( file );
+
+    Species q( mTable, mStrain.GetIndex() );
+    std::vector<size_t> best( mRead.size(), mCandidate.size() );
+    q.SetThreshold( mMinIndex, mMinIdentity ); q.Resolve( mOwner, mCandidate, best );
+
+    q.mCodec.swap( mCodec );    // the keys are lent to the species level assignment
+
+    for ( std::map<uint64_t, unsigned int, Codec::Order>::iterator r = mRead.begin(); !( r == mRead.end() ); ++r )
+    {
+        if ( best[ ( *r ).second ] < mCandidate.size() )
+        {
+            ( q.mAssign ).insert( ( q.mAssign ).end(),
+                std::make_pair( ( *r ).first, mCandidate[ best[ ( *r ).second ] ] ) );
+        }   // the read is assigned
+    }   // the reads in the order of their identification
+
+    file = mBase + ".assign.csv"; q.Profile( file + ".tmp" ); Replace( file );
+    q.mCodec.swap( mCodec );
+    mCount.written += Report::GetSize( file );
+    file = mBase + ".pivot.csv"; q.Output( file + ".tmp" ); Replace( file );
+    mCount.written += Report::GetSize( file );
+    mCount.output += 1.0;
+
+    return( true );
+}   // end of Final()
+
+/*
+ * export the species aggregates, in the same format as Species::Output()
+*/
+bool Online::Pivot( const std::string& _f ) const
+{
+    FILE* of = ::fopen( _f.c_str(), "w" );
+    double count;
+
+    ::fprintf( of, "%s,%s,%s,%s,%s,%s,%s,%s\n",     // header
+        "Taxon", "Abundance", "Identity", "Alignment Length",
+        "Mismatch", "Gap", "Read Quality", "Alignment Quality" );
+
+    for ( std::map<std::string, stPIVOT>::const_iterator j = mPivot.begin(); !( j == mPivot.end() ); ++j )
+    {
+        count = mAbundance.find( ( *j ).first )->second;
+
+        ::fprintf( of, "%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+            ( ( *j ).first ).c_str(),           // taxon
+            static_cast<unsigned int>( count ), // abundance
+            ( ( *j ).second ).ratio / count,    // average percent identity
+            ( ( *j ).second ).length / count,   // average alignment length
+            ( ( *j ).second ).odd / count,      // average number of mismatches
+            ( ( *j ).second ).gap / count,      // average number of gaps
+            ( ( *j ).second ).phred / count,    // average read quality
+            ( ( *j ).second ).score / count );  // average alignment quality
+    }   // every species with assigned reads
+
+    return( static_cast<bool>( ::fclose( of ) ) );
+}   // end of Pivot()
+
+/*
+ * move the temporary file in place; rename() replaces the table at once
+*/
+bool Online::Replace( const std::string& _f ) const
+{
+    return( ::rename( ( _f + ".tmp" ).c_str(), _f.c_str() ) == 0 );
+}   // end of Replace()
@@ -0,0 +1,99 @@
+/*
+ * online.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * online strain and species level assignment
+ *
+ * the summary file is followed as it is written, e.g., through a fifo while
+ * samfile and the aligner are still running. every record updates the
+ * aggregates and the coverage histogram of its taxon, and the best candidate
+ * of its read, at once. every N records or T seconds, sample.strain.csv and
+ * sample.pivot.csv are replaced by a snapshot; a table is written to a
+ * temporary file and renamed, so a reader never sees a partial table.
+ *
+ * the hits of a taxon are counted in place, one counter for every bin of
+ * its genomes, counted from the start of the first genome; a hit outside
+ * the genomes of its taxon is kept aside, so the histograms are the same as
+ * those of the batch assignment.
+ *
+ * a snapshot only rebuilds the histograms of the taxa hit since the last
+ * one and summarizes the species that are already aggregated, so its cost
+ * depends on the number of taxa, not reads. the reads arrived before the
+ * first snapshot are resolved without the weighted shannon index, and the
+ * later ones with the index of the last snapshot; once the stream ends,
+ * every candidate is resolved again with the final index, so the last
+ * snapshot, including sample.assign.csv, is identical to the batch result.
+*/
+
+#ifndef _ONLINE_H
+#define _ONLINE_H
+
+#include <table.h>
+#include <pivot.h>
+#include <strain.h>
+#include <report.h>
+#include <species.h>
+
+#include <set>
+#include <map>
+#include <vector>
+#include <string>
+
+class Online
+{
+public:
+    Online( const std::map<unsigned int, stTABLE>& );   // translate table
+    ~Online();
+
+    bool Run( const std::string& );
+    void SetInterval( const double, const double );
+    void SetThreshold( const double, const double, const double );
+    void SetReport( Report* );
+
+private:
+    const std::map<unsigned int, stTABLE>& mTable;
+    Strain mStrain;         // strain level assignment of the reads so far
+    Species mSpecies;       // species level indices of the last snapshot
+    std::map<unsigned int, std::vector<unsigned int> > mDense;  // hits per bin of the genomes of each taxon
+    std::map<unsigned int, std::map<unsigned int, unsigned int> > mStray;   // hits outside the genomes
+    std::set<unsigned int> mDirty;              // taxa hit since the last snapshot
+
+    Codec mCodec;                               // keys of the read identifications
+    std::map<uint64_t, unsigned int, Codec::Order> mRead;   // number of each read
+    std::vector<unsigned int> mOwner;           // read of each candidate
+    std::vector<stPIVOT> mCandidate;            // candidates in the order of the file
+    std::vector<size_t> mBest;                  // current assignment of each read
+    std::map<std::string, stPIVOT> mPivot;      // aggregates of the assigned reads
+    std::map<std::string, double> mAbundance;   // number of assigned reads
+
+    std::string mBase;      // base name of the output files
+    double mRecords;        // records between snapshots; 0 disables
+    double mSeconds;        // seconds between snapshots; 0 disables
+    double mIdentity;       // minimum average identity of a strain
+    double mMinIndex;       // minimum weighted shannon index of a species
+    double mMinIdentity;    // minimum percent identity of a candidate
+    bool mReady;            // the indices of a snapshot are available
+    Report* mReport;        // instrumentation; NULL if not attached
+    stCOUNT mCount;         // counters of the stage
+
+    void Update( const std::vector<const char*>& );
+    bool Local( const unsigned int, const unsigned int, unsigned int& ) const;
+    void Offer( const unsigned int, const size_t );
+    void Change( const stPIVOT&, const bool );
+    bool Better( const stPIVOT&, const stPIVOT& ) const;
+    double Rank( const std::string& ) const;
+    void Rebuild();
+    void Snapshot();
+    bool Final();
+    bool Pivot( const std::string& ) const;
+    bool Replace( const std::string& ) const;
+};  // end of class definition
+
+#endif  // _ONLINE_H
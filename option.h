@@ -0,0 +1,164 @@
+/*
+ * option.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * minimal command line parser shared by the driver programs
+ *
+ * options are given as --name or --name=value; options listed as valued
+ * also accept the value as the next argument, i.e., --name value. all
+ * other arguments are kept in order as positional parameters.
+*/
+
+#ifndef _OPTION_H
+#define _OPTION_H
+
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <cctype>
+#include <cstdlib>
+#include <boost/algorithm/string.hpp>
+
+class Option
+{
+public:
+    Option(
+        int argc, char** argv,
+        const std::string& _v = "" )        // comma separated valued options
+    {
+        std::vector<std::string> valued;
+        std::string arg, name;
+        std::string::size_type k;
+
+        mOption.clear(); mArgs.clear();
+        boost::algorithm::split( valued, _v, boost::algorithm::is_any_of( "," ) );
+
+        for ( int i = 1; i < argc; ++i )
+        {
+            arg = argv[ i ];
+
+            if ( arg.size() < 3 || arg.compare( 0, 2, "--" ) )
+            {
+                mArgs.push_back( arg ); continue;
+            }   // positional parameter
+
+            if ( !( ( k = arg.find( '=' ) ) == std::string::npos ) )
+            {
+                mOption[ arg.substr( 2, k - 2 ) ] = arg.substr( k + 1 ); continue;
+            }   // --name=value
+
+            name = arg.substr( 2 ); mOption[ name ] = "";
+
+            if ( ( i + 1 < argc ) &&
+                !( std::find( valued.begin(), valued.end(), name ) == valued.end() ) )
+            {
+                mOption[ name ] = argv[ ++i ];
+            }   // --name value
+        }   // walk through the arguments
+    }   // default constructor
+
+    ~Option()
+    {
+        mOption.clear(); mArgs.clear();
+    }   // default destructor; environmentally conscientious
+
+    bool Has( const std::string& _n ) const
+    {
+        return( !( mOption.find( _n ) == mOption.end() ) );
+    }   // end of Has()
+
+    std::string Get( const std::string& _n, const std::string& _d = "" ) const
+    {
+        return( Has( _n ) ? mOption.find( _n )->second : _d );
+    }   // end of Get()
+
+    double GetReal( const std::string& _n, const double _d ) const
+    {
+        return( Has( _n ) ? ::atof( Get( _n ).c_str() ) : _d );
+    }   // end of GetReal()
+
+    /*
+     * comma separated list of numbers, e.g., --name=70,80,90
+    */
+    std::vector<double> GetReals( const std::string& _n, const double _d ) const
+    {
+        std::vector<std::string> field;
+        std::vector<double> value;
+
+        if ( !Has( _n ) )
+        {
+            value.push_back( _d ); return( value );
+        }   // use the default value
+
+        boost::algorithm::split( field, mOption.find( _n )->second, boost::algorithm::is_any_of( "," ) );
+
+        for ( unsigned int i = 0; i < field.size(); ++i )
+        {
+            if ( !field[ i ].empty() )
+            {
+                value.push_back( ::atof( field[ i ].c_str() ) );
+            }   // ignore empty fields
+        }   // every value of the list
+
+        if ( value.empty() )
+        {
+            value.push_back( _d );
+        }   // use the default value
+
+        return( value );
+    }   // end of GetReals()
+
+    unsigned int GetSize( const std::string& _n, const unsigned int _d ) const
+    {
+        return( Has( _n ) ? static_cast<unsigned int>( ::atoi( Get( _n ).c_str() ) ) : _d );
+    }   // end of GetSize()
+
+    /*
+     * size in bytes; the suffixes K, M and G are accepted
+    */
+    size_t GetBytes( const std::string& _n, const size_t _d ) const
+    {
+        std::string s = Get( _n );
+        char* unit = NULL;
+        double size = ::strtod( s.c_str(), &unit );
+
+        if ( !Has( _n ) )
+        {
+            return( _d );
+        }   // use the default value
+
+        switch ( ::toupper( *unit ) )
+        {
+            case 'G': size *= 1024.0;   // fall through
+            case 'M': size *= 1024.0;   // fall through
+            case 'K': size *= 1024.0; break;
+            default: break;
+        }   // scale the size
+
+        return( static_cast<size_t>( size ) );
+    }   // end of GetBytes()
+
+    const std::vector<std::string>& GetArgs() const
+    {
+        return( mArgs );
+    }   // end of GetArgs()
+
+    const std::map<std::string, std::string>& GetOptions() const
+    {
+        return( mOption );
+    }   // end of GetOptions()
+
+private:
+    std::map<std::string, std::string> mOption;
+    std::vector<std::string> mArgs;
+};  // end of class definition
+
+#endif  // _OPTION_H
@@ -0,0 +1,155 @@
+/*
+ * panel.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * panel of target taxa
+ *
+ * the panel file lists the taxa of interest, one per line, either as ncbi
+ * tid or as species name of the translation table, with or without the
+ * quotation marks; blank lines and lines starting with # are ignored. the
+ * panel is compiled into a bitmap over the genomes of the table: the gids
+ * are numbered densely in sorted order, and the bit of a genome is set if
+ * its taxon or species is on the panel. a lookup is a binary search over
+ * the gids, which are kept in one array, and a bit test.
+ *
+ * samfile drops the alignments to other genomes as soon as the reference
+ * is known, before the rest of the record is parsed; assign restricts the
+ * translation table, and thus all of its tables, to the genomes of the
+ * panel. reads whose best hit is not on the panel are assigned among the
+ * panel taxa they also hit, if any.
+*/
+
+#ifndef _PANEL_H
+#define _PANEL_H
+
+#include <table.h>
+#include <reader.h>
+
+#include <set>
+#include <map>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cctype>
+#include <stdint.h>
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+
+class Panel
+{
+public:
+    Panel()
+    {
+        mSize = 0;
+    }   // default constructor
+
+    ~Panel()
+    {
+        mGID.clear(); mBit.clear();
+    }   // default destructor; environmentally conscientious
+
+    /*
+     * compile the panel against the translation table; false if the file
+     * cannot be read or no genome of the table is on the panel
+    */
+    bool Load(
+        const std::string& _f,                          // panel file
+        const std::map<unsigned int, stTABLE>& _t )     // translation table
+    {
+        std::set<unsigned int> tid;
+        std::set<std::string> species;
+        std::string line;
+        Reader ifs( _f );
+
+        if ( !ifs.IsOpen() )
+        {
+            return( false );
+        }   // check the state of stream
+
+        while ( ifs.GetLine( line ) )
+        {
+            boost::algorithm::trim( line );
+            boost::algorithm::trim_if( line, boost::algorithm::is_any_of( "\"" ) );
+
+            if ( line.empty() || ( line[ 0 ] == '#' ) )
+            {
+                continue;
+            }   // blank lines and comments
+
+            if ( line.find_first_not_of( "0123456789" ) == std::string::npos )
+            {
+                tid.insert( static_cast<unsigned int>( ::atoi( line.c_str() ) ) ); continue;
+            }   // ncbi tid
+
+            species.insert( line );
+        }   // one taxon per line
+
+        mGID.clear(); mBit.assign( ( _t.size() + 63 ) / 64, 0 ); mSize = 0;
+
+        for ( std::map<unsigned int, stTABLE>::const_iterator i = _t.begin(); !( i == _t.end() ); ++i )
+        {
+            std::string name = ( ( *i ).second ).species;
+            boost::algorithm::trim_if( name, boost::algorithm::is_any_of( "\"" ) );
+
+            if ( ( tid.find( ( ( *i ).second ).tid ) != tid.end() ) || ( species.find( name ) != species.end() ) )
+            {
+                mBit[ mGID.size() / 64 ] |= 1ULL << ( mGID.size() % 64 ); ++mSize;
+            }   // the genome is on the panel
+
+            mGID.push_back( ( *i ).first );
+        }   // dense index of the genomes; the table is sorted by gid
+
+        return( mSize > 0 );
+    }   // end of Load()
+
+    /*
+     * test if a genome is on the panel; genomes not in the table are not
+    */
+    bool Has(
+        const unsigned int _g ) const   // ncbi gid
+    {
+        std::vector<unsigned int>::const_iterator i = std::lower_bound( mGID.begin(), mGID.end(), _g );
+        const size_t k = i - mGID.begin();
+
+        return( !( i == mGID.end() ) && ( *i == _g ) && ( ( mBit[ k / 64 ] >> ( k % 64 ) ) & 1ULL ) );
+    }   // end of Has()
+
+    /*
+     * remove the genomes that are not on the panel from the table
+    */
+    void Filter(
+        std::map<unsigned int, stTABLE>& _t ) const     // translation table
+    {
+        for ( std::map<unsigned int, stTABLE>::iterator i = _t.begin(); !( i == _t.end() ); )
+        {
+            if ( Has( ( *i ).first ) )
+            {
+                ++i; continue;
+            }   // the genome is on the panel
+
+            _t.erase( i++ );
+        }   // every genome of the table
+    }   // end of Filter()
+
+    /*
+     * number of genomes on the panel
+    */
+    unsigned int GetSize() const
+    {
+        return( mSize );
+    }   // end of GetSize()
+
+private:
+    std::vector<unsigned int> mGID;     // gids of the table, sorted; the dense index
+    std::vector<uint64_t> mBit;         // genomes on the panel, by dense index
+    unsigned int mSize;                 // number of genomes on the panel
+};  // end of class definition
+
+#endif  // _PANEL_H
@@ -15,7 +15,14 @@
 #ifndef _PIVOT_H
 #define _PIVOT_H
 
+#include <pool.h>
+#include <codec.h>
+
+#include <map>
 #include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
 
 struct stPIVOT
 {
@@ -29,6 +36,23 @@ struct stPIVOT
         *this = _t;
     }   // copy constructor
 
+#if __cplusplus >= 201103L
+    stPIVOT( stPIVOT&& _t )
+    {
+        *this = static_cast<stPIVOT&&>( _t );
+    }   // move constructor
+
+    stPIVOT& operator=( stPIVOT&& _t )
+    {
+        phred = _t.phred; ratio = _t.ratio;
+        gap = _t.gap; tid = _t.tid; odd = _t.odd;
+        score = _t.score; length = _t.length;
+        site.swap( _t.site ); ( _t.site ).clear();
+
+        return( *this );
+    }   // move assignment
+#endif
+
     ~stPIVOT()
     {
         site.clear();
@@ -60,13 +84,19 @@ struct stPIVOT
         score += _t.score;      // alignment score
         length += _t.length;    // alignment length
 
-        for ( unsigned int i = 0; i < _t.site.size(); ++i )
-        {
-            site.push_back( _t.site[ i ] );
-        }   // accumulate the binding sites
+        site.insert( site.end(), ( _t.site ).begin(), ( _t.site ).end() );
 
         return( *this );
-    }   // operator overloading
+    }   // operator overloading; accumulate the binding sites
+
+    void swap( stPIVOT& _t )
+    {
+        std::swap( phred, _t.phred ); std::swap( ratio, _t.ratio );
+        std::swap( gap, _t.gap ); std::swap( tid, _t.tid );
+        std::swap( odd, _t.odd ); std::swap( score, _t.score );
+        std::swap( length, _t.length );
+        site.swap( _t.site );
+    }   // exchange the contents without copying the binding sites
 
     double phred;           // read quality
     double ratio;           // percent identity
@@ -78,4 +108,12 @@ struct stPIVOT
     std::vector<unsigned int> site;
 };  // smart container implementation
 
+/*
+ * candidate assignments of the reads; one node per read comes from the arena
+ * of the map, which is released with the map
+ * reads are kept as the keys of their codec and ordered as their names
+*/
+typedef std::map<uint64_t, stPIVOT, Codec::Order,
+    Pool<std::pair<const uint64_t, stPIVOT> > > PivotMap;
+
 #endif  // _PIVOT_H
@@ -0,0 +1,212 @@
+/*
+ * placement.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * placement of the worker threads on the numa nodes
+*/
+
+#include <omp.h>
+#include <placement.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <sched.h>
+#include <pthread.h>
+
+/*
+ * sysfs directory of the nodes; the highest node looked for
+*/
+static const char* szNODE = "/sys/devices/system/node/node%u/cpulist";
+static const unsigned int nMaxNODE = 1024;
+
+Numa::Numa(
+    const unsigned int _n )     // number of nodes; 0 reads the topology
+{
+    std::vector<std::vector<int> > node;
+    std::vector<int> cpu, all;
+    cpu_set_t mask;
+    char name[ 64 ], line[ 4096 ];
+    FILE* ifs;
+
+    mCPU.clear(); CPU_ZERO( &mask );
+
+    if ( ::sched_getaffinity( 0, sizeof( mask ), &mask ) )
+    {
+        CPU_ZERO( &mask ); CPU_SET( 0, &mask );
+    }   // assume a single processor
+
+    for ( unsigned int i = 0; i < nMaxNODE; ++i )
+    {
+        ::snprintf( name, sizeof( name ), szNODE, i );
+
+        if ( !( ifs = ::fopen( name, "r" ) ) )
+        {
+            continue;
+        }   // node numbers may have gaps
+
+        cpu.clear();
+
+        if ( ::fgets( line, sizeof( line ), ifs ) && Parse( line, cpu ) )
+        {
+            node.push_back( std::vector<int>() );
+
+            for ( unsigned int k = 0; k < cpu.size(); ++k )
+            {
+                if ( ( cpu[ k ] < CPU_SETSIZE ) && CPU_ISSET( cpu[ k ], &mask ) )
+                {
+                    ( node.back() ).push_back( cpu[ k ] ); all.push_back( cpu[ k ] );
+                }   // only the processors the program may use
+            }   // every processor of the node
+
+            if ( ( node.back() ).empty() )
+            {
+                node.pop_back();
+            }   // nodes without usable processors or memory only nodes
+        }   // list of the processors
+
+        ::fclose( ifs );
+    }   // every node of the topology
+
+    if ( node.empty() )
+    {
+        for ( int k = 0; k < CPU_SETSIZE; ++k )
+        {
+            if ( CPU_ISSET( k, &mask ) )
+            {
+                all.push_back( k );
+            }   // every processor the program may use
+        }   // topology is not available
+
+        node.push_back( all );
+    }   // a single node
+
+    if ( !( _n > 0 ) || ( _n == node.size() ) )
+    {
+        mCPU.swap( node ); return;
+    }   // the topology as is
+
+    mCPU.resize( _n );
+
+    if ( _n < node.size() )
+    {
+        for ( unsigned int i = 0; i < node.size(); ++i )
+        {
+            mCPU[ i % _n ].insert( mCPU[ i % _n ].end(), node[ i ].begin(), node[ i ].end() );
+        }   // nodes are merged
+    }   // fewer nodes than the topology
+    else
+    {
+        for ( unsigned int k = 0; k < all.size(); ++k )
+        {
+            mCPU[ k % _n ].push_back( all[ k ] );
+        }   // processors are split
+
+        for ( unsigned int i = 0; i < _n; ++i )
+        {
+            if ( mCPU[ i ].empty() )
+            {
+                mCPU[ i ] = all;
+            }   // more virtual nodes than processors; the node shares them all
+        }   // every virtual node
+    }   // virtual nodes
+}   // default constructor
+
+Numa::~Numa()
+{
+    mCPU.clear();
+}   // default destructor; environmentally conscientious
+
+unsigned int Numa::GetNodes() const
+{
+    return( mCPU.size() );
+}   // end of GetNodes()
+
+/*
+ * node of the calling thread of a parallel region; the threads are divided
+ * into contiguous groups of about the same size
+*/
+unsigned int Numa::GetNode() const
+{
+    return( static_cast<unsigned int>( ( static_cast<unsigned long>( ::omp_get_thread_num() ) *
+        mCPU.size() ) / ::omp_get_num_threads() ) );
+}   // end of GetNode()
+
+/*
+ * pin the calling thread of a parallel region to the processors of its
+ * node; returns the node. the thread stays where it was if it may not be
+ * pinned
+*/
+unsigned int Numa::Bind() const
+{
+    unsigned int n = GetNode();
+    cpu_set_t mask;
+
+    CPU_ZERO( &mask );
+
+    for ( unsigned int k = 0; k < mCPU[ n ].size(); ++k )
+    {
+        CPU_SET( mCPU[ n ][ k ], &mask );
+    }   // processors of the node
+
+    ::pthread_setaffinity_np( ::pthread_self(), sizeof( mask ), &mask );
+
+    return( n );
+}   // end of Bind()
+
+/*
+ * number of threads of the parallel regions and of the scheduler; 0 keeps
+ * the default, OMP_NUM_THREADS or the number of processors
+*/
+void Numa::SetThreads(
+    const unsigned int _n )
+{
+    if ( _n > 0 )
+    {
+        ::omp_set_num_threads( _n );
+    }   // every later parallel region
+}   // end of SetThreads()
+
+/*
+ * parse a list of processors, e.g., 0-3,8-11
+*/
+bool Numa::Parse(
+    const char* _s,             // list of processors
+    std::vector<int>& _c )      // processors
+{
+    char* end = NULL;
+    long first, last;
+
+    while ( *_s && !( *_s == '\n' ) )
+    {
+        first = last = ::strtol( _s, &end, 10 );
+
+        if ( end == _s )
+        {
+            return( false );
+        }   // not a number
+
+        if ( *( _s = end ) == '-' )
+        {
+            last = ::strtol( _s + 1, &end, 10 ); _s = end;
+        }   // a range of processors
+
+        for ( long k = first; k <= last; ++k )
+        {
+            _c.push_back( static_cast<int>( k ) );
+        }   // every processor of the range
+
+        if ( *_s == ',' )
+        {
+            ++_s;
+        }   // the next range
+    }   // walk through the list
+
+    return( !_c.empty() );
+}   // end of Parse()
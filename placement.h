@@ -0,0 +1,55 @@
+/*
+ * placement.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * placement of the worker threads on the numa nodes
+ *
+ * the nodes and their processors are read from sysfs, restricted to the
+ * processors the program may run on. the threads of a parallel region are
+ * divided into contiguous groups, one per node, and every thread is pinned
+ * to the processors of its node. memory is placed by the kernel on the node
+ * that touches it first, so the blocks and aggregates a pinned thread
+ * allocates itself are local to its node; no numa library is needed, and
+ * the name of this header leaves <numa.h> to that library.
+ *
+ * without sysfs, or on a single node, all processors form one node. the
+ * number of nodes may also be given: nodes are then merged, or the
+ * processors split into virtual nodes, so the mode can be exercised, and
+ * its results compared, on a single node.
+ *
+ * SetThreads() sets the number of threads of every parallel region and of
+ * the workers of the scheduler, see task.h; all programs take it from
+ * --threads.
+*/
+
+#ifndef _PLACEMENT_H
+#define _PLACEMENT_H
+
+#include <vector>
+
+class Numa
+{
+public:
+    Numa( const unsigned int = 0 );     // number of nodes; 0 reads the topology
+    ~Numa();
+
+    unsigned int GetNodes() const;
+    unsigned int GetNode() const;
+    unsigned int Bind() const;
+
+    static void SetThreads( const unsigned int );
+
+private:
+    std::vector<std::vector<int> > mCPU;    // processors of every node
+
+    static bool Parse( const char*, std::vector<int>& );
+};  // end of class definition
+
+#endif  // _PLACEMENT_H
@@ -0,0 +1,222 @@
+/*
+ * pool.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * pool allocator for the nodes of node-based containers
+ *
+ * single objects are carved from blocks of nMaxNODE objects and recycled
+ * through a free list, so a map that inserts one node per read allocates
+ * from the heap once every few thousand reads. the blocks and the free list
+ * form the arena of a container: it is created by the first node the
+ * container allocates, shared only with the copies of its allocator, and
+ * released with the last of them, e.g., when the container is destroyed or
+ * swapped with an empty one. like the container, an arena must only be
+ * modified by one thread at a time; the containers of different threads do
+ * not share their arenas. the variable-length parts of the nodes, e.g., the
+ * binding sites of stPIVOT, still come from the heap.
+*/
+
+#ifndef _POOL_H
+#define _POOL_H
+
+#include <new>
+#include <vector>
+#include <cstddef>
+
+#if __cplusplus >= 201103L
+#include <type_traits>
+#endif
+
+template <typename T>
+class Pool
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U> struct rebind
+    {
+        typedef Pool<U> other;
+    };  // allocator of another type
+
+#if __cplusplus >= 201103L
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+#endif  // the arena goes with the nodes; swap() of the containers swaps it too
+
+    Pool() : mArena( NULL )
+    {
+    }   // default constructor
+
+    Pool( const Pool& _p ) : mArena( _p.mArena )
+    {
+        if ( mArena )
+        {
+            mArena->users += 1;
+        }   // the copy shares the arena
+    }   // copy constructor
+
+    template <typename U> Pool( const Pool<U>& ) : mArena( NULL )
+    {
+    }   // conversion constructor; nodes of another type have their own arena
+
+    ~Pool()
+    {
+        Release();
+    }   // default destructor
+
+    Pool& operator=( const Pool& _p )
+    {
+        if ( !( mArena == _p.mArena ) )
+        {
+            Release(); mArena = _p.mArena;
+
+            if ( mArena )
+            {
+                mArena->users += 1;
+            }   // share the arena of the other allocator
+        }   // not the same arena
+
+        return( *this );
+    }   // operator overloading
+
+    pointer address( reference _x ) const
+    {
+        return( &_x );
+    }   // end of address()
+
+    const_pointer address( const_reference _x ) const
+    {
+        return( &_x );
+    }   // end of address()
+
+    size_type max_size() const
+    {
+        return( static_cast<size_type>( -1 ) / sizeof( T ) );
+    }   // end of max_size()
+
+    void construct( pointer _p, const T& _v )
+    {
+        new ( _p ) T( _v );
+    }   // end of construct()
+
+    void destroy( pointer _p )
+    {
+        _p->~T();
+    }   // end of destroy()
+
+    pointer allocate( const size_type _n, const void* = 0 )
+    {
+        if ( !( _n == 1 ) )
+        {
+            return( static_cast<pointer>( ::operator new( _n * sizeof( T ) ) ) );
+        }   // arrays come from the heap
+
+        if ( !mArena )
+        {
+            mArena = new stARENA();
+        }   // the first node of the container
+
+        if ( !mArena->free )
+        {
+            Grow();
+        }   // the free list is empty
+
+        stNODE* p = mArena->free; mArena->free = p->next;
+
+        return( reinterpret_cast<pointer>( p ) );
+    }   // end of allocate()
+
+    void deallocate( pointer _p, const size_type _n )
+    {
+        if ( !( _n == 1 ) )
+        {
+            ::operator delete( _p ); return;
+        }   // arrays go back to the heap
+
+        stNODE* p = reinterpret_cast<stNODE*>( _p );
+        p->next = mArena->free; mArena->free = p;
+    }   // end of deallocate()
+
+    bool operator==( const Pool& _p ) const
+    {
+        return( mArena == _p.mArena );
+    }   // nodes are only freed to the arena they came from
+
+    bool operator!=( const Pool& _p ) const
+    {
+        return( !( mArena == _p.mArena ) );
+    }   // nodes are only freed to the arena they came from
+
+private:
+    union stNODE
+    {
+        stNODE* next;       // next free node
+        char data[ sizeof( T ) ];   // storage of the object
+        double align;       // alignment of the storage
+        void* pointer;      // alignment of the storage
+    };  // a node of the pool
+
+    struct stARENA
+    {
+        stARENA()
+        {
+            free = NULL; users = 1;
+        }   // default constructor
+
+        stNODE* free;               // free list of the arena
+        std::vector<stNODE*> block; // blocks of the arena
+        unsigned int users;         // allocators sharing the arena
+    };  // nodes of a container
+
+    static const unsigned int nMaxNODE = 4096;
+    stARENA* mArena;        // arena of the container; NULL until its first node
+
+    /*
+     * add a block of nodes to the free list
+    */
+    void Grow()
+    {
+        stNODE* block = static_cast<stNODE*>( ::operator new( nMaxNODE * sizeof( stNODE ) ) );
+
+        ( mArena->block ).push_back( block );
+
+        for ( unsigned int i = 0; i < nMaxNODE; ++i )
+        {
+            block[ i ].next = mArena->free; mArena->free = block + i;
+        }   // link the nodes
+    }   // end of Grow()
+
+    /*
+     * leave the arena; the last allocator returns its blocks to the heap
+    */
+    void Release()
+    {
+        if ( mArena && !( mArena->users -= 1 ) )
+        {
+            for ( unsigned int i = 0; i < ( mArena->block ).size(); ++i )
+            {
+                ::operator delete( ( mArena->block )[ i ] );
+            }   // every block of the arena
+
+            delete mArena;
+        }   // the last allocator of the arena
+
+        mArena = NULL;
+    }   // end of Release()
+};  // end of class definition
+
+#endif  // _POOL_H
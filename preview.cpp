@@ -0,0 +1,369 @@
+/*
+ * preview.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * approximate abundance preview from a subsample of the summary file
+*/
+
+#include <hash.h>
+#include <reader.h>
+#include <strain.h>
+#include <species.h>
+#include <preview.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <sys/stat.h>
+#include <boost/algorithm/string.hpp>
+
+/*
+ * size of a chunk in bytes
+ * size of the blocks read from a chunk, and the first look back for the
+ * line that precedes it
+ * quantile of the normal distribution for the 95% error bounds
+*/
+static const off_t nMaxCHUNK = 1 << 20;
+static const size_t nMaxBLOCK = 1 << 16;
+static const double nMaxQUANTILE = 1.96;
+
+Preview::Preview(
+    const std::map<unsigned int, stTABLE>& _t ) : mTable( _t )
+{
+    mChunk.clear(); mCount.clear();
+    mTotal = 0; mFraction = 0.01; mReads = 0.0; mSeed = 0;
+    mStrain = 70.0; mIndex = 0.15; mIdentity = 85.0;
+}   // default constructor
+
+Preview::~Preview()
+{
+    mChunk.clear(); mCount.clear();
+}   // default destructor; environmentally conscientious
+
+/*
+ * fraction of the summary file to be read
+*/
+void Preview::SetFraction(
+    const double _f )
+{
+    mFraction = std::min( 1.0, std::max( 0.0, _f ) ); mReads = 0.0;
+}   // end of SetFraction()
+
+/*
+ * approximate number of reads to be sampled; the fraction is estimated from
+ * the density of reads in the first chunk
+*/
+void Preview::SetReads(
+    const double _r )
+{
+    mReads = _r;
+}   // end of SetReads()
+
+void Preview::SetSeed(
+    const uint64_t _s )
+{
+    mSeed = _s;
+}   // end of SetSeed()
+
+/*
+ * thresholds of the strain and species level assignments of the subsample
+*/
+void Preview::SetThreshold(
+    const double _s,            // minimum average identity of a strain
+    const double _w,            // minimum weighted shannon index
+    const double _i )           // minimum percent identity
+{
+    mStrain = _s; mIndex = _w; mIdentity = _i;
+}   // end of SetThreshold()
+
+/*
+ * sample the summary file and perform the assignments on the subsample
+ *
+ * sample.summary.csv produces sample_preview.summary.csv and the regular
+ * outputs of the subsample, i.e., sample_preview.strain.csv,
+ * sample_preview.pivot.csv and sample_preview.assign.csv; the extrapolated
+ * abundances are written to sample.preview.csv
+*/
+bool Preview::Run( const std::string& _f )
+{
+    const char* szDELIMIT = ".\n";
+    std::vector<std::string> field;
+    std::string base, file;
+
+    boost::algorithm::split(                // splite the entire string
+        field, _f, boost::algorithm::is_any_of( szDELIMIT ) );
+    base = field[ 0 ]; file = base + "_preview.summary.csv";
+
+    if ( !Sample( _f, file ) )
+    {
+        return( false );
+    }   // unable to sample the file
+
+    Strain p( mTable );                 // strain level assignment
+    p.SetIdentity( mStrain ); p.Run( file );
+    Species q( mTable, p.GetIndex() );  // species level assignment
+    q.SetThreshold( mIndex, mIdentity ); q.Run( file );
+
+    return( Bound( base + "_preview.assign.csv", base + ".preview.csv" ) );
+}   // end of Run()
+
+/*
+ * copy the reads of the selected chunks
+ *
+ * a chunk is read from the first line that starts within the chunk; lines
+ * that continue the read of the previous line are skipped, and the last
+ * read is completed beyond the end of the chunk. the line that precedes
+ * the chunk is found by looking back further until a whole line starts
+ * before the chunk, so the lines may be of any length.
+*/
+bool Preview::Sample(
+    const std::string& _i,      // summary file
+    const std::string& _o )     // subsample
+{
+    std::string line, name, last, prev;
+    off_t head, size, start, end, at, pos, back;
+    double fraction = mFraction;
+    struct stat s;
+    bool skip;
+    FILE* of;
+
+    Reader ifs( _i );
+
+    if ( !ifs.IsOpen() || ::stat( _i.c_str(), &s ) || !S_ISREG( s.st_mode ) )
+    {
+        return( false );
+    }   // the chunks are read from their offsets
+
+    ifs.GetLine( line ); head = line.size() + 1; size = s.st_size;
+    mTotal = static_cast<unsigned int>( ( std::max( size, head ) - head + nMaxCHUNK - 1 ) / nMaxCHUNK );
+    mChunk.clear(); mCount.clear();
+
+    if ( mReads > 0.0 )
+    {
+        fraction = std::min( 1.0, mReads / ( Density( _i, head, size ) * ( size - head ) + 1.0 ) );
+    }   // fraction from the target number of reads
+
+    if ( ( of = ::fopen( _o.c_str(), "w" ) ) == NULL )
+    {
+        return( false );
+    }   // unable to write the subsample
+
+    ::fprintf( of, "%s\n", line.c_str() );
+
+    for ( unsigned int k = 0; k < mTotal; ++k )
+    {
+        if ( !( Unit64( Mix64( mSeed ^ Mix64( k ) ) ) < fraction ) )
+        {
+            continue;
+        }   // chunk is not selected
+
+        start = head + k * nMaxCHUNK; end = start + nMaxCHUNK;
+
+        for ( back = nMaxBLOCK; ; back *= 2 )
+        {
+            at = std::max( head, start - back );
+            Reader r( _i, nMaxBLOCK, at );
+            pos = at; prev.clear();
+
+            if ( !r.IsOpen() )
+            {
+                ::fclose( of ); return( false );
+            }   // unable to read the chunk
+
+            if ( ( at > head ) && r.GetLine( line ) )
+            {
+                pos += line.size() + 1;
+            }   // skip the partial line
+
+            if ( ( at > head ) && !( pos < start ) )
+            {
+                continue;
+            }   // no whole line before the chunk; look back further
+
+            while ( ( pos < start ) && r.GetLine( line ) )
+            {
+                pos += line.size() + 1; prev = GetName( line.c_str() );
+            }   // the read that precedes the chunk
+
+            mCount.push_back( 0.0 ); last.clear(); skip = !prev.empty();
+
+            while ( r.GetLine( line ) )
+            {
+                at = pos; pos += line.size() + 1; name = GetName( line.c_str() );
+
+                if ( skip && ( name == prev ) )
+                {
+                    continue;
+                }   // the read belongs to the previous chunk
+
+                if ( !( at < end ) && !( name == last ) )
+                {
+                    break;
+                }   // the last read of the chunk is complete
+
+                if ( !( name == last ) )
+                {
+                    mChunk[ name ] = mCount.size() - 1; mCount.back() += 1.0;
+                }   // a new read in the chunk
+
+                skip = false; last = name;
+                ::fprintf( of, "%s\n", line.c_str() );
+            }   // copy the reads of the chunk
+
+            break;
+        }   // look back as far as the longest line
+    }   // walk through the chunks
+
+    std::cout << "preview: " << mCount.size() << " of " << mTotal << " chunks, "
+        << mChunk.size() << " reads" << std::endl;
+
+    return( ::fclose( of ) == 0 );
+}   // end of Sample()
+
+/*
+ * extrapolate the abundances of the subsample
+ *
+ * the selected chunks are treated as a simple random sample of clusters.
+ * the abundance of a species is estimated as the expansion of its chunk
+ * totals, and its proportion as the ratio to the reads in the chunks; both
+ * variances are taken from the variation between chunks
+*/
+bool Preview::Bound(
+    const std::string& _i,      // read assignments of the subsample
+    const std::string& _o ) const   // extrapolated abundances
+{
+    std::map<std::string, std::vector<double> > count;
+    std::map<std::string, unsigned int>::const_iterator k;
+    std::string line;
+    const char* taxon;
+    double m = static_cast<double>( mCount.size() ), c = mTotal;
+    double n = 0.0, x, p, mean, var, pvar;
+    FILE* of;
+
+    Reader ifs( _i );
+
+    if ( !ifs.IsOpen() )
+    {
+        return( false );
+    }   // check the state of stream
+
+    ifs.GetLine( line );    // skip the header
+
+    while ( ifs.GetLine( line ) )
+    {
+        taxon = line.c_str();
+
+        for ( unsigned int i = 0; ( i < 9 ) && taxon; ++i )
+        {
+            taxon = ::strchr( taxon, ',' ); taxon = ( taxon ) ? taxon + 1 : NULL;
+        }   // the species name is the last column and may contain commas
+
+        if ( !taxon || ( ( k = mChunk.find( GetName( line.c_str() ) ) ) == mChunk.end() ) )
+        {
+            continue;
+        }   // malformed line
+
+        if ( count.find( taxon ) == count.end() )
+        {
+            count[ taxon ].assign( mCount.size(), 0.0 );
+        }   // a new species
+
+        count[ taxon ][ k->second ] += 1.0;
+    }   // count the reads of each species in each chunk
+
+    if ( ( of = ::fopen( _o.c_str(), "w" ) ) == NULL )
+    {
+        return( false );
+    }   // unable to write the abundances
+
+    for ( unsigned int i = 0; i < mCount.size(); ++i )
+    {
+        n += mCount[ i ];
+    }   // number of sampled reads
+
+    ::fprintf( of, "%s,%s,%s,%s,%s,%s,%s,%s\n",     // header
+        "Taxon", "Sampled", "Abundance", "Lower", "Upper",
+        "Proportion", "Proportion Lower", "Proportion Upper" );
+
+    for ( std::map<std::string, std::vector<double> >::iterator i = count.begin(); !( i == count.end() ); ++i )
+    {
+        std::vector<double>& y = ( *i ).second;
+        x = 0.0; var = 0.0; pvar = 0.0;
+
+        for ( unsigned int j = 0; j < y.size(); ++j )
+        {
+            x += y[ j ];
+        }   // sampled reads of the species
+
+        mean = x / m; p = ( n > 0.0 ) ? x / n : 0.0;
+
+        for ( unsigned int j = 0; ( j < y.size() ) && ( m > 1.0 ); ++j )
+        {
+            var += ( y[ j ] - mean ) * ( y[ j ] - mean ) / ( m - 1.0 );
+            pvar += ( y[ j ] - p * mCount[ j ] ) * ( y[ j ] - p * mCount[ j ] ) / ( m - 1.0 );
+        }   // variation between chunks
+
+        var = c * c * ( 1.0 - m / c ) * var / m;
+        pvar = ( n > 0.0 ) ? ( 1.0 - m / c ) * pvar * m / ( n * n ) : 0.0;
+
+        ::fprintf( of, "%s,%d,%.2f,%.2f,%.2f,%.6f,%.6f,%.6f\n",
+            ( ( *i ).first ).c_str(),                           // taxon
+            static_cast<unsigned int>( x ),                     // sampled reads
+            c * mean,                                           // estimated abundance
+            std::max( 0.0, c * mean - nMaxQUANTILE * ::sqrt( var ) ),
+            c * mean + nMaxQUANTILE * ::sqrt( var ),
+            p,                                                  // estimated proportion
+            std::max( 0.0, p - nMaxQUANTILE * ::sqrt( pvar ) ),
+            std::min( 1.0, p + nMaxQUANTILE * ::sqrt( pvar ) ) );
+    }   // export the extrapolated abundances
+
+    return( ::fclose( of ) == 0 );
+}   // end of Bound()
+
+/*
+ * number of reads per byte in the first chunk
+*/
+double Preview::Density(
+    const std::string& _f,      // summary file
+    const off_t _h,             // end of the header
+    const off_t _z ) const      // size of the file
+{
+    std::string line, name, last;
+    double reads = 0.0;
+    off_t pos = _h;
+
+    Reader ifs( _f, nMaxBLOCK, _h );
+
+    while ( ( pos < _h + nMaxCHUNK ) && ifs.GetLine( line ) )
+    {
+        pos += line.size() + 1;
+
+        if ( !( ( name = GetName( line.c_str() ) ) == last ) )
+        {
+            reads += 1.0; last = name;
+        }   // a new read
+    }   // count the reads in the first chunk
+
+    return( reads / std::max<double>( 1.0, std::min( nMaxCHUNK, _z - _h ) ) );
+}   // end of Density()
+
+/*
+ * read identification; the first column of a line
+*/
+std::string Preview::GetName(
+    const char* _s ) const
+{
+    const char* p = ::strchr( _s, ',' );
+
+    return( ( p ) ? std::string( _s, p - _s ) : std::string( _s ) );
+}   // end of GetName()
@@ -0,0 +1,69 @@
+/*
+ * preview.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * approximate abundance preview from a subsample of the summary file
+ *
+ * the summary file is divided into chunks of fixed size, and a chunk is
+ * selected if the hash of its position falls below the sampling fraction.
+ * only the selected chunks are read; all others are skipped. a read belongs
+ * to the chunk in which its first line starts, so all alignments (and both
+ * mates) of a read are either kept or dropped together. this assumes that
+ * the lines of a read are contiguous, as samfile writes them; the lines of
+ * a read that is split over the file are sampled as separate reads, each
+ * with the chunk of its own first line. the summary is read from offsets,
+ * so it must be a regular file rather than a pipe. the regular strain
+ * and species level assignments are then performed on the subsample, and
+ * the abundances are extrapolated with error bounds estimated from the
+ * variation between chunks.
+*/
+
+#ifndef _PREVIEW_H
+#define _PREVIEW_H
+
+#include <table.h>
+
+#include <map>
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+class Preview
+{
+public:
+    Preview( const std::map<unsigned int, stTABLE>& );
+    ~Preview();
+
+    bool Run( const std::string& );
+    void SetFraction( const double );
+    void SetReads( const double );
+    void SetSeed( const uint64_t );
+    void SetThreshold( const double, const double, const double );
+
+private:
+    const std::map<unsigned int, stTABLE>& mTable;
+    std::map<std::string, unsigned int> mChunk;     // selected chunk of each read
+    std::vector<double> mCount;                     // number of reads in each selected chunk
+    unsigned int mTotal;    // number of chunks in the summary file
+    double mFraction;       // sampling fraction
+    double mReads;          // target number of reads; 0 uses the fraction
+    uint64_t mSeed;         // seed of the chunk selection
+    double mStrain;         // minimum average identity of a strain
+    double mIndex;          // minimum weighted shannon index of a species
+    double mIdentity;       // minimum percent identity of a candidate
+
+    bool Sample( const std::string&, const std::string& );
+    bool Bound( const std::string&, const std::string& ) const;
+    double Density( const std::string&, const off_t, const off_t ) const;
+    std::string GetName( const char* ) const;
+};  // end of class definition
+
+#endif  // _PREVIEW_H
@@ -0,0 +1,243 @@
+/*
+ * query.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * records of a few taxa or of a range of bins from the store of a summary
+ *
+ * only the blocks whose index lists one of the taxa, or bins in the range,
+ * are read; they are decompressed and filtered by all threads at once and
+ * written in the order of the index, i.e., by partition, then in the order
+ * of the summary. the output is a summary file of the matching records.
+ *
+ * to compile:
+ * g++ -I. -O3 query.cpp store.cpp report.cpp placement.cpp -o query -fopenmp -lz
+*/
+
+#include <placement.h>
+#include <store.h>
+#include <option.h>
+#include <report.h>
+
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct stQUERY
+{
+    std::set<unsigned int> tid; // taxa; all taxa if empty
+    bool bins;              // only the records in the range of bins
+    unsigned int left;      // lowest bin
+    unsigned int right;     // highest bin
+};  // records to be pulled
+
+/*
+ * test if the index of a block lists a taxon of the query within the bins
+*/
+static bool Select(
+    const Store::stBLOCK& _b,   // block of the index
+    const stQUERY& _q )         // query
+{
+    for ( std::map<uint32_t, stSPAN>::const_iterator i = ( _b.taxa ).begin(); !( i == ( _b.taxa ).end() ); ++i )
+    {
+        if ( !( _q.tid ).empty() && ( ( _q.tid ).find( ( *i ).first ) == ( _q.tid ).end() ) )
+        {
+            continue;
+        }   // taxon not asked for
+
+        if ( !_q.bins || !( ( *i ).second.right < _q.left || ( *i ).second.left > _q.right ) )
+        {
+            return( true );
+        }   // the bins of the taxon overlap the range
+    }   // taxa of the block
+
+    return( false );
+}   // end of Select()
+
+/*
+ * test if a line of the summary matches the query; the numeric fields
+ * follow the quoted read identification
+*/
+static bool Match(
+    const char* _s,             // line of the summary
+    const char* _e,             // end of the line
+    const stQUERY& _q )         // query
+{
+    unsigned long field[ 11 ];  // identity to tid; the first field is not used
+    const char* p = _s;
+    char* next = NULL;
+
+    while ( ( _e > p ) && !( *( _e - 1 ) == '"' ) )
+    {
+        --_e;
+    }   // closing quote of the read identification
+
+    p = _e;
+
+    for ( unsigned int i = 1; i < 11; ++i )
+    {
+        if ( !( *p == ',' ) )
+        {
+            return( false );
+        }   // truncated records
+
+        field[ i ] = ::strtoul( p + 1, &next, 10 ); p = next;
+
+        while ( *p == '.' || ( ( *p >= '0' ) && ( *p <= '9' ) ) )
+        {
+            ++p;
+        }   // fractions of the real numbers
+    }   // identity, length, mismatches, gaps, qualities, bins, gid and tid
+
+    if ( !( _q.tid ).empty() && ( ( _q.tid ).find( field[ 10 ] ) == ( _q.tid ).end() ) )
+    {
+        return( false );
+    }   // taxon not asked for
+
+    return( !_q.bins ||
+        ( !( field[ 7 ] < _q.left ) && !( field[ 7 ] > _q.right ) ) ||
+        ( !( field[ 8 ] < _q.left ) && !( field[ 8 ] > _q.right ) ) );
+}   // end of Match()
+
+/*
+ * driver program
+ *
+ * required parameters:
+ * store of the summary, sample.store, written by samfile --store
+ *
+ * optional parameters:
+ * output file; the standard output by default
+ * --tid=T1,T2,...  records of the taxa
+ * --bins=L,R       records with a segment in the bins L to R
+ * --report=F       write the instrumentation of the run to F in json
+ * --progress       periodic progress with throughput and eta on stderr
+ * --threads=N      number of threads; default OMP_NUM_THREADS or all processors
+*/
+int main( int argc, char** argv )
+{
+    Option opt( argc, argv, "tid,bins,report,threads" );
+    const std::vector<std::string>& arg = opt.GetArgs();
+    std::vector<double> tid = opt.GetReals( "tid", 0.0 );
+    std::vector<double> bins = opt.GetReals( "bins", 0.0 );
+    std::vector<size_t> block;
+    stQUERY q;
+    stCOUNT total;              // counters of the query
+    Store store;
+
+    if ( arg.empty() )
+    {
+        return( 0 );
+    }   // check the number of parameters
+
+    Numa::SetThreads( opt.GetSize( "threads", 0 ) );
+
+    if ( !store.Open( arg[ 0 ] ) )
+    {
+        ::fprintf( stderr, "query: unable to read %s\n", arg[ 0 ].c_str() ); return( 1 );
+    }   // the store and its index
+
+    for ( unsigned int i = 0; opt.Has( "tid" ) && ( i < tid.size() ); ++i )
+    {
+        ( q.tid ).insert( static_cast<unsigned int>( tid[ i ] ) );
+    }   // taxa of the query
+
+    q.bins = opt.Has( "bins" ) && ( bins.size() > 1 );
+    q.left = ( q.bins ) ? static_cast<unsigned int>( bins[ 0 ] ) : 0;
+    q.right = ( q.bins ) ? static_cast<unsigned int>( bins[ 1 ] ) : 0;
+
+    const std::vector<Store::stBLOCK>& index = store.GetBlocks();
+
+    for ( size_t i = 0; i < index.size(); ++i )
+    {
+        if ( Select( index[ i ], q ) )
+        {
+            block.push_back( i );
+        }   // the block may hold records of the query
+    }   // the blocks to be read
+
+    FILE* ofs = ( arg.size() > 1 ) ? ::fopen( arg[ 1 ].c_str(), "w" ) : stdout;
+    Report r; r.SetProgress( opt.Has( "progress" ) );
+    const bool report = opt.Has( "report" ) || opt.Has( "progress" );
+    bool done = ( ofs != NULL );
+
+    if ( !ofs )
+    {
+        ::fprintf( stderr, "query: unable to write %s\n", arg[ 1 ].c_str() ); return( 1 );
+    }   // unable to write the output
+
+    if ( report )
+    {
+        r.Begin( "query", arg[ 0 ] );
+    }   // instrumentation of the query
+
+    ::fprintf( ofs, "%s\n", store.GetHeader().c_str() ); total.written = store.GetHeader().size() + 1;
+
+    #pragma omp parallel
+    {
+        std::string chunk;                  // lines of a block
+        std::string match;                  // lines of the query
+        const char* next; const char* end; const char* line;
+        stCOUNT count;                      // counters of the block
+
+        #pragma omp for ordered schedule( dynamic )
+        for ( long i = 0; i < static_cast<long>( block.size() ); ++i )
+        {
+            const Store::stBLOCK& b = index[ block[ i ] ];
+            bool read = store.Read( b, chunk );
+
+            match.clear(); count = stCOUNT();
+
+            for ( next = chunk.data(), end = next + chunk.size(); read && ( next < end ); )
+            {
+                line = next; next = static_cast<const char*>( ::memchr( line, '\n', end - line ) ) + 1;
+
+                if ( Match( line, next - 1, q ) )
+                {
+                    match.append( line, next - line ); count.output += 1.0;
+                }   // the record is part of the query
+            }   // every line ends with a newline
+
+            count.records = b.records; count.bytes = b.length; count.written = match.size();
+
+            #pragma omp ordered
+            {
+                ::fwrite( match.data(), 1, match.size(), ofs );
+                done = done && read; total += count;
+
+                if ( report )
+                {
+                    r.Progress( total );
+                }   // periodic progress
+            }   // in the order of the index
+        }   // every block of the query
+    }   // end of the parallel section
+
+    if ( report )
+    {
+        r.End( total );
+    }   // complete the query
+
+    if ( opt.Has( "report" ) )
+    {
+        r.Write( opt.Get( "report" ) );
+    }   // write the report at exit
+
+    if ( !done )
+    {
+        ::fprintf( stderr, "query: %s is damaged\n", arg[ 0 ].c_str() );
+    }   // a block could not be read
+
+    if ( !( ofs == stdout ) )
+    {
+        done = !::fclose( ofs ) && done;
+    }   // the standard output is left open
+
+    return( ( done ) ? 0 : 1 );
+}   // end of main()
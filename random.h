@@ -0,0 +1,141 @@
+/*
+ * random.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * deterministic pseudo random number generator (splitmix64)
+ *
+ * the sequence only depends on the seed, so independent streams are
+ * obtained by seeding each stream with a different counter, e.g., the
+ * replicate or the thread number.
+*/
+
+#ifndef _RANDOM_H
+#define _RANDOM_H
+
+#include <hash.h>
+
+#include <cmath>
+#include <stdint.h>
+
+class Random
+{
+public:
+    Random( const uint64_t _s = 0 )
+    {
+        mState = Mix64( _s );
+    }   // default constructor
+
+    ~Random()
+    {
+    }   // default destructor
+
+    uint64_t Next()
+    {
+        mState += 0x9e3779b97f4a7c15ULL; return( Mix64( mState ) );
+    }   // end of Next()
+
+    /*
+     * uniform on [0, 1)
+    */
+    double Uniform()
+    {
+        return( Unit64( Next() ) );
+    }   // end of Uniform()
+
+    /*
+     * uniform on [0, n)
+    */
+    unsigned int Range( const unsigned int _n )
+    {
+        return( static_cast<unsigned int>( Uniform() * _n ) );
+    }   // end of Range()
+
+    /*
+     * standard normal; box-muller transformation
+    */
+    double Normal()
+    {
+        double u = 1.0 - Uniform(), v = Uniform();
+
+        return( ::sqrt( -2.0 * ::log( u ) ) * ::cos( 6.283185307179586 * v ) );
+    }   // end of Normal()
+
+    /*
+     * number of successes in n trials; meant for a small number of trials
+    */
+    unsigned int Binomial( const unsigned int _n, const double _p )
+    {
+        unsigned int k = 0;
+
+        for ( unsigned int i = 0; i < _n; ++i )
+        {
+            k += ( Uniform() < _p ) ? 1 : 0;
+        }   // count the successes
+
+        return( k );
+    }   // end of Binomial()
+
+    /*
+     * poisson with mean m; multiplication of uniforms for small means and
+     * the transformed rejection of hormann (ptrs) otherwise
+    */
+    unsigned int Poisson( const double _m )
+    {
+        double u, v, us, k;
+
+        if ( !( _m > 0.0 ) )
+        {
+            return( 0 );
+        }   // degenerate distribution
+
+        if ( _m < 10.0 )
+        {
+            double limit = ::exp( -_m ), p = Uniform();
+
+            for ( k = 0.0; p > limit; k += 1.0 )
+            {
+                p *= Uniform();
+            }   // multiply until the product falls below the limit
+
+            return( static_cast<unsigned int>( k ) );
+        }   // small mean
+
+        double slam = ::sqrt( _m ), loglam = ::log( _m );
+        double b = 0.931 + 2.53 * slam, a = -0.059 + 0.02483 * b;
+        double invalpha = 1.1239 + 1.1328 / ( b - 3.4 ), vr = 0.9277 - 3.6224 / ( b - 2.0 );
+
+        while ( true )
+        {
+            u = Uniform() - 0.5; v = Uniform(); us = 0.5 - ::fabs( u );
+            k = ::floor( ( 2.0 * a / us + b ) * u + _m + 0.43 );
+
+            if ( ( us >= 0.07 ) && ( v <= vr ) )
+            {
+                return( static_cast<unsigned int>( k ) );
+            }   // quick acceptance
+
+            if ( ( k < 0.0 ) || ( ( us < 0.013 ) && ( v > us ) ) )
+            {
+                continue;
+            }   // quick rejection
+
+            if ( ::log( v ) + ::log( invalpha ) - ::log( a / ( us * us ) + b ) <=
+                -_m + k * loglam - ::lgamma( k + 1.0 ) )
+            {
+                return( static_cast<unsigned int>( k ) );
+            }   // acceptance
+        }   // transformed rejection
+    }   // end of Poisson()
+
+private:
+    uint64_t mState;
+};  // end of class definition
+
+#endif  // _RANDOM_H
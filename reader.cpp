@@ -0,0 +1,243 @@
+/*
+ * reader.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * read-ahead reader of text files
+*/
+
+#include <reader.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+ * number of blocks read ahead of the consumers
+*/
+static const unsigned int nMaxDEPTH = 2;
+
+Reader::Reader(
+    const std::string& _f,      // name of the file
+    const size_t _s,            // size of a block
+    const off_t _o )            // offset of the first byte; regular files only
+{
+    mSize = ( _s > 0 ) ? _s : 1 << 20; mRead = _o; mOffset = 0;
+    mAsync = false; mDone = false; mStop = false; mStream = false;
+    mFile = ( _f == "-" ) ? ::dup( 0 ) : ::open( _f.c_str(), O_RDONLY );
+
+    ::pthread_mutex_init( &mLock, NULL );
+    ::pthread_cond_init( &mFull, NULL ); ::pthread_cond_init( &mEmpty, NULL );
+
+    if ( mFile < 0 )
+    {
+        mDone = true; return;
+    }   // unable to open the file
+
+    struct stat s;
+    mStream = !::fstat( mFile, &s ) && !S_ISREG( s.st_mode );
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise( mFile, _o, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+
+    mAsync = ( ::pthread_create( &mThread, NULL, Start, this ) == 0 );
+}   // default constructor
+
+Reader::~Reader()
+{
+    if ( mAsync )
+    {
+        ::pthread_mutex_lock( &mLock ); mStop = true;
+        ::pthread_cond_signal( &mEmpty ); ::pthread_mutex_unlock( &mLock );
+        ::pthread_join( mThread, NULL );
+    }   // stop the read-ahead thread
+
+    if ( !( mFile < 0 ) )
+    {
+        ::close( mFile );
+    }   // close the file
+
+    ::pthread_cond_destroy( &mFull ); ::pthread_cond_destroy( &mEmpty );
+    ::pthread_mutex_destroy( &mLock );
+}   // default destructor
+
+bool Reader::IsOpen() const
+{
+    return( !( mFile < 0 ) );
+}   // end of IsOpen()
+
+/*
+ * take the next block; the storage of the block passed in is reused
+ * the remainder of a block partially consumed by GetLine() comes first
+*/
+bool Reader::Next(
+    std::string& _b )
+{
+    if ( mOffset < mBlock.size() )
+    {
+        _b.assign( mBlock, mOffset, std::string::npos ); mOffset = mBlock.size();
+        return( true );
+    }   // remainder of the current block
+
+    return( Take( _b ) );
+}   // end of Next()
+
+/*
+ * take the next line without the newline
+*/
+bool Reader::GetLine(
+    std::string& _l )
+{
+    const char* p;
+
+    while ( !( mOffset < mBlock.size() ) )
+    {
+        if ( !Take( mBlock ) )
+        {
+            return( false );
+        }   // end of the file
+
+        mOffset = 0;
+    }   // the current block is consumed
+
+    p = static_cast<const char*>(
+        ::memchr( mBlock.data() + mOffset, '\n', mBlock.size() - mOffset ) );
+
+    _l.assign( mBlock, mOffset, p - mBlock.data() - mOffset ); mOffset = p - mBlock.data() + 1;
+
+    return( true );
+}   // end of GetLine()
+
+void* Reader::Start( void* _r )
+{
+    static_cast<Reader*>( _r )->Fill(); return( NULL );
+}   // end of Start()
+
+/*
+ * body of the read-ahead thread
+*/
+void Reader::Fill()
+{
+    std::string block;
+    bool more = true;
+
+    while ( more )
+    {
+        ::pthread_mutex_lock( &mLock );
+
+        while ( !( mReady.size() < nMaxDEPTH ) && !mStop )
+        {
+            ::pthread_cond_wait( &mEmpty, &mLock );
+        }   // wait for the consumers
+
+        if ( mStop )
+        {
+            ::pthread_mutex_unlock( &mLock ); break;
+        }   // the reader is closing
+
+        if ( !mSpare.empty() )
+        {
+            block.swap( mSpare.back() ); mSpare.pop_back();
+        }   // reuse the storage of a consumed block
+
+        ::pthread_mutex_unlock( &mLock );
+
+        more = Load( block );
+
+        ::pthread_mutex_lock( &mLock );
+
+        if ( !block.empty() )
+        {
+            mReady.push_back( std::string() ); ( mReady.back() ).swap( block );
+        }   // hand the block to the consumers
+
+        mDone = !more;
+        ::pthread_cond_broadcast( &mFull ); ::pthread_mutex_unlock( &mLock );
+    }   // read until the end of the file
+}   // end of Fill()
+
+/*
+ * read the next block that ends with a complete line
+ * returns false at the end of the file
+*/
+bool Reader::Load(
+    std::string& _b )
+{
+    std::string::size_type last = std::string::npos, have;
+    ssize_t n = 0;
+
+    _b.swap( mCarry ); mCarry.clear();
+
+    while ( last == std::string::npos )
+    {
+        have = _b.size(); _b.resize( have + mSize );
+
+        while ( ( ( n = ( mStream ) ? ::read( mFile, &_b[ have ], mSize ) :
+            ::pread( mFile, &_b[ have ], mSize, mRead ) ) < 0 ) && ( errno == EINTR ) )
+        {
+        }   // interrupted by a signal; pipes are read as the data arrive
+
+        if ( !( n > 0 ) )
+        {
+            _b.resize( have );
+
+            if ( !_b.empty() && !( _b[ have - 1 ] == '\n' ) )
+            {
+                _b.push_back( '\n' );
+            }   // the last line of the file lacks the newline
+
+            return( false );
+        }   // end of the file
+
+        _b.resize( have + n ); mRead += n;
+        last = _b.rfind( '\n' );
+    }   // a line may be longer than a block
+
+    mCarry.assign( _b, last + 1, std::string::npos ); _b.resize( last + 1 );
+
+    return( true );
+}   // end of Load()
+
+/*
+ * wait for the next block
+*/
+bool Reader::Take(
+    std::string& _b )
+{
+    if ( !mAsync && mDone )
+    {
+        _b.clear(); return( false );
+    }   // end of the file
+
+    if ( !mAsync )
+    {
+        mDone = !Load( _b ); return( !_b.empty() );
+    }   // no read-ahead thread; read in the caller
+
+    ::pthread_mutex_lock( &mLock );
+
+    while ( mReady.empty() && !mDone )
+    {
+        ::pthread_cond_wait( &mFull, &mLock );
+    }   // wait for the read-ahead thread
+
+    if ( mReady.empty() )
+    {
+        ::pthread_mutex_unlock( &mLock ); _b.clear(); return( false );
+    }   // end of the file
+
+    mSpare.push_back( std::string() ); ( mSpare.back() ).swap( _b );
+    _b.swap( mReady.front() ); mReady.pop_front();
+    ::pthread_cond_signal( &mEmpty ); ::pthread_mutex_unlock( &mLock );
+
+    return( true );
+}   // end of Take()
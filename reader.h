@@ -0,0 +1,77 @@
+/*
+ * reader.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * read-ahead reader of text files
+ *
+ * a dedicated thread reads the file in large blocks with pread() while the
+ * consumers work on the previous blocks; at most nMaxDEPTH blocks are read
+ * ahead. every block ends with a newline, even if the last line of the file
+ * lacks one, and a line longer than the block simply makes the block larger,
+ * so there is no limit on the length of a line. consumers either take whole
+ * blocks with Next(), or single lines with GetLine(); both must be called
+ * from one thread at a time, e.g., in a critical region. blocks are
+ * exchanged with swap(), so their storage is recycled between the reader
+ * and the consumers.
+ *
+ * pipes, fifos and the standard input, given as "-", are read with read()
+ * instead; a block is handed over as soon as it holds a complete line, so
+ * the consumers follow a stream while it is being written.
+ *
+ * a regular file may be read from an offset other than its beginning; the
+ * first line is then whatever follows the offset, possibly a partial line.
+*/
+
+#ifndef _READER_H
+#define _READER_H
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <pthread.h>
+#include <sys/types.h>
+
+class Reader
+{
+public:
+    Reader( const std::string&, const size_t = 1 << 20, const off_t = 0 );
+    ~Reader();
+
+    bool IsOpen() const;
+    bool Next( std::string& );
+    bool GetLine( std::string& );
+
+private:
+    int mFile;                      // file descriptor; -1 if not open
+    size_t mSize;                   // size of a block
+    off_t mRead;                    // offset of the next read
+    bool mStream;                   // not a regular file; pread() is not available
+    std::string mCarry;             // incomplete line of the last block read
+
+    std::deque<std::string> mReady; // blocks read ahead
+    std::vector<std::string> mSpare;    // storage to be reused
+    std::string mBlock;             // block consumed by GetLine()
+    size_t mOffset;                 // next line in the block
+
+    pthread_t mThread;              // read-ahead thread
+    pthread_mutex_t mLock;
+    pthread_cond_t mFull;           // a block is ready
+    pthread_cond_t mEmpty;          // a block has been taken
+    bool mAsync;                    // the read-ahead thread is running
+    bool mDone;                     // end of the file has been reached
+    bool mStop;                     // the reader is closing
+
+    static void* Start( void* );
+    void Fill();
+    bool Load( std::string& );
+    bool Take( std::string& );
+};  // end of class definition
+
+#endif  // _READER_H
@@ -0,0 +1,283 @@
+/*
+ * report.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * instrumentation of the processing stages
+*/
+
+#include <report.h>
+
+#include <ctime>
+#include <cstdio>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+/*
+ * names of the reasons in the report; same order as the enumeration
+ * calls between two progress checks; must be a power of two
+*/
+static const char* szREJECT[ nMaxREJECT ] = {
+    "field", "unaligned", "reference", "table", "reduced", "duplicate", "index", "identity", "panel" };
+static const unsigned int nMaxTICK = 4096;
+
+Report::Report()
+{
+    mStage.clear(); mProgress = false; mTick = 0; mLast = 0.0;
+}   // default constructor
+
+Report::~Report()
+{
+    mStage.clear();
+}   // default destructor; environmentally conscientious
+
+/*
+ * periodic progress with throughput and estimated time of completion
+*/
+void Report::SetProgress(
+    const bool _p )
+{
+    mProgress = _p;
+}   // end of SetProgress()
+
+/*
+ * start a stage
+*/
+void Report::Begin(
+    const std::string& _n,      // name of the stage
+    const std::string& _f )     // name of the input file
+{
+    stSTAGE s;
+    s.name = _n; s.input = _f; s.size = GetSize( _f );
+    s.wall = Clock(); s.cpu = GetCPU(); s.rss = 0;
+
+    mStage.push_back( s ); mTick = 0; mLast = s.wall;
+}   // end of Begin()
+
+/*
+ * report the progress of the current stage
+ * called from the critical region of the reader with the running counters
+*/
+void Report::Progress(
+    const stCOUNT& _c )
+{
+    if ( !mProgress || mStage.empty() || ( ++mTick & ( nMaxTICK - 1 ) ) )
+    {
+        return;
+    }   // only check the clock once in a while
+
+    const stSTAGE& s = mStage.back();
+    double now = Clock(), elapsed = now - s.wall;
+    double rate = ( elapsed > 0.0 ) ? _c.bytes / elapsed : 0.0;
+
+    if ( now - mLast < 1.0 )
+    {
+        return;
+    }   // at most once every second
+
+    mLast = now;
+    ::fprintf( stderr, "\r%s: %.1f%%, %.0f records, %.0f records/s, %.2f MB/s, eta %.0f s   ",
+        s.name.c_str(), ( s.size > 0.0 ) ? 100.0 * _c.bytes / s.size : 0.0,
+        _c.records, _c.records / elapsed, rate / 1048576.0,
+        ( ( rate > 0.0 ) && ( s.size > _c.bytes ) ) ? ( s.size - _c.bytes ) / rate : 0.0 );
+}   // end of Progress()
+
+/*
+ * complete the current stage
+*/
+void Report::End(
+    const stCOUNT& _c )
+{
+    if ( mStage.empty() )
+    {
+        return;
+    }   // no stage has been started
+
+    stSTAGE& s = mStage.back();
+    s.wall = Clock() - s.wall; s.cpu = GetCPU() - s.cpu;
+    s.rss = GetRSS(); s.count = _c;
+
+    if ( mProgress )
+    {
+        ::fprintf( stderr, "\r%s: %.0f records in %.2f s, %.0f records/s%30s\n",
+            s.name.c_str(), _c.records, s.wall, ( s.wall > 0.0 ) ? _c.records / s.wall : 0.0, "" );
+    }   // final progress of the stage
+}   // end of End()
+
+/*
+ * records and bytes processed by a thread of the given numa node
+ * called from the critical region at the end of the parallel section
+*/
+void Report::Node(
+    const unsigned int _n,      // numa node of the thread
+    const stCOUNT& _c )         // counters of the thread
+{
+    if ( mStage.empty() )
+    {
+        return;
+    }   // no stage has been started
+
+    stSTAGE& s = mStage.back();
+
+    if ( !( _n < s.node.size() ) )
+    {
+        s.node.resize( _n + 1 ); s.thread.resize( _n + 1, 0 );
+    }   // the first thread of the node
+
+    s.node[ _n ].records += _c.records; s.node[ _n ].bytes += _c.bytes; s.thread[ _n ] += 1;
+}   // end of Node()
+
+/*
+ * write the report in json
+*/
+bool Report::Write(
+    const std::string& _f ) const
+{
+    FILE* of = ::fopen( _f.c_str(), "w" );
+    double wall = 0.0, cpu = 0.0;
+    bool first;
+
+    if ( !of )
+    {
+        return( false );
+    }   // unable to write the report
+
+    for ( unsigned int i = 0; i < mStage.size(); ++i )
+    {
+        wall += mStage[ i ].wall; cpu += mStage[ i ].cpu;
+    }   // totals of all stages
+
+    ::fprintf( of, "{\n  \"wall_seconds\": %.6f,\n  \"cpu_seconds\": %.6f,\n  \"peak_rss_kb\": %ld,\n",
+        wall, cpu, GetRSS() );
+    ::fprintf( of, "  \"stages\": [\n" );
+
+    for ( unsigned int i = 0; i < mStage.size(); ++i )
+    {
+        const stSTAGE& s = mStage[ i ];
+        const stCOUNT& c = s.count;
+        double t = ( s.wall > 0.0 ) ? s.wall : 1e-9;
+
+        ::fprintf( of, "    {\n      \"stage\": \"%s\",\n      \"input\": \"%s\",\n",
+            Escape( s.name ).c_str(), Escape( s.input ).c_str() );
+        ::fprintf( of, "      \"wall_seconds\": %.6f,\n      \"cpu_seconds\": %.6f,\n", s.wall, s.cpu );
+        ::fprintf( of, "      \"records_in\": %.0f,\n      \"bytes_in\": %.0f,\n", c.records, c.bytes );
+        ::fprintf( of, "      \"records_out\": %.0f,\n      \"bytes_out\": %.0f,\n", c.output, c.written );
+        ::fprintf( of, "      \"records_per_second\": %.1f,\n      \"bytes_per_second\": %.1f,\n",
+            c.records / t, c.bytes / t );
+        ::fprintf( of, "      \"wait_seconds\": %.6f,\n      \"peak_rss_kb\": %ld,\n", c.wait, s.rss );
+
+        if ( c.reject[ nREJECT_DUPLICATE ] > 0.0 )
+        {
+            ::fprintf( of, "      \"duplicate_rate\": %.6f,\n", c.reject[ nREJECT_DUPLICATE ] /
+                ( c.output + c.reject[ nREJECT_DUPLICATE ] + c.reject[ nREJECT_REDUCED ] ) );
+        }   // hit rate of the deduplication window
+
+        if ( !s.node.empty() )
+        {
+            ::fprintf( of, "      \"nodes\": [\n" );
+
+            for ( unsigned int j = 0; j < s.node.size(); ++j )
+            {
+                ::fprintf( of, "        {\"node\": %d, \"threads\": %d, \"records_in\": %.0f, \"bytes_in\": %.0f, "
+                    "\"records_per_second\": %.1f, \"bytes_per_second\": %.1f}%s\n", j, s.thread[ j ],
+                    s.node[ j ].records, s.node[ j ].bytes, s.node[ j ].records / t, s.node[ j ].bytes / t,
+                    ( j + 1 < s.node.size() ) ? "," : "" );
+            }   // throughput of every node
+
+            ::fprintf( of, "      ],\n" );
+        }   // threads placed on numa nodes
+        ::fprintf( of, "      \"rejected\": {" ); first = true;
+
+        for ( unsigned int j = 0; j < nMaxREJECT; ++j )
+        {
+            if ( c.reject[ j ] > 0.0 )
+            {
+                ::fprintf( of, "%s\"%s\": %.0f", ( first ) ? "" : ", ", szREJECT[ j ], c.reject[ j ] );
+                first = false;
+            }   // only the reasons that occurred
+        }   // rejected records by reason
+
+        ::fprintf( of, "}\n    }%s\n", ( i + 1 < mStage.size() ) ? "," : "" );
+    }   // every stage
+
+    ::fprintf( of, "  ]\n}\n" );
+
+    return( ::fclose( of ) == 0 );
+}   // end of Write()
+
+/*
+ * monotonic wall clock in seconds
+*/
+double Report::Clock()
+{
+    struct timespec t; ::clock_gettime( CLOCK_MONOTONIC, &t );
+
+    return( t.tv_sec + t.tv_nsec * 1e-9 );
+}   // end of Clock()
+
+/*
+ * size of a file in bytes; 0 if the file does not exist
+*/
+double Report::GetSize(
+    const std::string& _f )
+{
+    struct stat s;
+
+    return( ( ::stat( _f.c_str(), &s ) == 0 ) ? static_cast<double>( s.st_size ) : 0.0 );
+}   // end of GetSize()
+
+/*
+ * processor time of all threads in seconds
+*/
+double Report::GetCPU() const
+{
+    struct rusage u; ::getrusage( RUSAGE_SELF, &u );
+
+    return( u.ru_utime.tv_sec + u.ru_stime.tv_sec + ( u.ru_utime.tv_usec + u.ru_stime.tv_usec ) * 1e-6 );
+}   // end of GetCPU()
+
+/*
+ * peak resident set size of the process in kilobytes
+*/
+long Report::GetRSS() const
+{
+    struct rusage u; ::getrusage( RUSAGE_SELF, &u );
+
+    return( u.ru_maxrss );
+}   // end of GetRSS()
+
+/*
+ * a string as the contents of a json string; quotation marks, backslashes
+ * and control characters are escaped
+*/
+std::string Report::Escape(
+    const std::string& _s )
+{
+    std::string e;
+    char buffer[ 8 ];
+
+    for ( unsigned int i = 0; i < _s.size(); ++i )
+    {
+        if ( ( _s[ i ] == '"' ) || ( _s[ i ] == '\\' ) )
+        {
+            e += '\\'; e += _s[ i ];
+        }   // escaped by a backslash
+        else if ( static_cast<unsigned char>( _s[ i ] ) < 0x20 )
+        {
+            ::snprintf( buffer, sizeof( buffer ), "\\u%04x", _s[ i ] ); e += buffer;
+        }   // control characters, e.g., a newline in a file name
+        else
+        {
+            e += _s[ i ];
+        }   // as is
+    }   // every character
+
+    return( e );
+}   // end of Escape()
@@ -0,0 +1,121 @@
+/*
+ * report.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * instrumentation of the processing stages
+ *
+ * every stage keeps its own counters; the records and bytes read are
+ * counted in the critical region of the reader, everything else per
+ * thread, and the counters are handed to the report once the stage
+ * completes. the time spent waiting for the critical regions is only
+ * measured when a report is attached, so the programs run without any
+ * measurable overhead otherwise.
+ *
+ * with the threads placed on numa nodes, every thread also hands over the
+ * records and bytes it processed itself, which are reported per node.
+*/
+
+#ifndef _REPORT_H
+#define _REPORT_H
+
+#include <vector>
+#include <string>
+
+/*
+ * reasons for records to be rejected
+*/
+enum
+{
+    nREJECT_FIELD = 0,      // header lines and truncated records
+    nREJECT_UNALIGNED,      // not aligned properly, according to the aligner
+    nREJECT_REFERENCE,      // reference name does not carry the ncbi gid
+    nREJECT_TABLE,          // gid is not in the translation table
+    nREJECT_REDUCED,        // removed by the best-hit reduction
+    nREJECT_DUPLICATE,      // duplicate of a recent alignment of the read
+    nREJECT_INDEX,          // taxon without weighted shannon index
+    nREJECT_IDENTITY,       // percent identity below the threshold
+    nREJECT_PANEL,          // genome is not on the panel of target taxa
+    nMaxREJECT
+};
+
+struct stCOUNT
+{
+    stCOUNT()
+    {
+        records = 0.0; bytes = 0.0; output = 0.0; written = 0.0; wait = 0.0;
+
+        for ( unsigned int i = 0; i < nMaxREJECT; ++i )
+        {
+            reject[ i ] = 0.0;
+        }   // no records rejected yet
+    }   // default constructor
+
+    const stCOUNT& operator+=( const stCOUNT& _c )
+    {
+        records += _c.records; bytes += _c.bytes;
+        output += _c.output; written += _c.written; wait += _c.wait;
+
+        for ( unsigned int i = 0; i < nMaxREJECT; ++i )
+        {
+            reject[ i ] += _c.reject[ i ];
+        }   // accumulate the rejected records
+
+        return( *this );
+    }   // accumulate the counters of a thread
+
+    double records;         // records read
+    double bytes;           // bytes read
+    double output;          // records written
+    double written;         // bytes written
+    double wait;            // seconds spent waiting for the critical regions
+    double reject[ nMaxREJECT ];    // records rejected by reason
+};  // counters of a stage
+
+class Report
+{
+public:
+    Report();
+    ~Report();
+
+    void SetProgress( const bool );
+    void Begin( const std::string&, const std::string& );
+    void Progress( const stCOUNT& );
+    void End( const stCOUNT& );
+    void Node( const unsigned int, const stCOUNT& );
+    bool Write( const std::string& ) const;
+
+    static double Clock();
+    static double GetSize( const std::string& );
+
+private:
+    struct stSTAGE
+    {
+        std::string name;   // name of the stage
+        std::string input;  // name of the input file
+        double size;        // size of the input file
+        double wall;        // elapsed time in seconds
+        double cpu;         // processor time in seconds
+        long rss;           // peak resident set size in kilobytes
+        stCOUNT count;      // counters of the stage
+        std::vector<stCOUNT> node;          // records and bytes of every numa node
+        std::vector<unsigned int> thread;   // threads of every numa node
+    };  // a single stage
+
+    std::vector<stSTAGE> mStage;
+    bool mProgress;         // periodic progress on stderr
+    unsigned int mTick;     // calls since the last progress check
+    double mLast;           // time of the last progress
+
+    double GetCPU() const;
+    long GetRSS() const;
+    static std::string Escape( const std::string& );
+};  // end of class definition
+
+#endif  // _REPORT_H
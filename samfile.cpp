@@ -35,18 +35,26 @@
  * Revised on February 13, 2013
 */
 
+#ifndef _LIB_SAMTOOL
 #define _DBG_SAMTOOL
+#endif  // _LIB_SAMTOOL; the parser is linked into another program
 
 #include <omp.h>
 #include <table.h>
+#include <reader.h>
+#include <option.h>
 #include <samfile.h>
+#include <source.h>
+#include <cache.h>
 
 #include <map>
+#include <set>
 #include <cmath>
+#include <algorithm>
 #include <cstdio>
 #include <cctype>
 #include <cstdlib>
-#include <fstream>
+#include <cstring>
 #include <iostream>
 #include <boost/algorithm/string.hpp>
 
@@ -55,6 +63,8 @@
 */
 SamFile::SamFile()
 {
+    mPaired = false; mByTID = false; mBest = 0; mReport = NULL; mNuma = NULL; mDedup = 0;
+    mFormat = nFORMAT_SAM; mStore = NULL; mPanel = NULL; mScale = 1.0 / nBinWIDTH; mIdentity = 85.0;
 }   // default constructor
 
 /*
@@ -65,6 +75,8 @@ SamFile::SamFile(
     const std::string& _ifs,    // name of alignment file
     const std::string& _ofs )   // name of summary file
 {
+    mPaired = false; mByTID = false; mBest = 0; mReport = NULL; mNuma = NULL; mDedup = 0;
+    mFormat = nFORMAT_SAM; mStore = NULL; mPanel = NULL; mScale = 1.0 / nBinWIDTH; mIdentity = 85.0;
     Run( _t, _ifs, _ofs );      // multi-threaded version
 }   // default constructor
 
@@ -72,98 +84,593 @@ SamFile::~SamFile()
 {
 }   // default destructor; environmentally conscientious
 
+/*
+ * merge the concordant mates of paired-end templates
+*/
+void SamFile::SetPaired(
+    const bool _p )
+{
+    mPaired = _p;
+}   // end of SetPaired()
+
+/*
+ * reduce the alignments of each read before they are written
+ * the best hit of each taxon, the hits of the top taxa, or both; the
+ * hits below the minimum percent identity of the species level assignment
+ * rank after all others, as they are never assigned
+*/
+void SamFile::SetBest(
+    const unsigned int _k,      // number of top hits; 0 keeps all
+    const bool _t,              // best hit of each taxon
+    const double _i )           // minimum percent identity of a candidate
+{
+    mBest = _k; mByTID = _t; mIdentity = _i;
+}   // end of SetBest()
+
+/*
+ * attach the instrumentation; NULL detaches it
+*/
+void SamFile::SetReport(
+    Report* _r )
+{
+    mReport = _r;
+}   // end of SetReport()
+
+/*
+ * pin the threads to the numa nodes; NULL detaches it
+*/
+void SamFile::SetNuma(
+    const Numa* _n )
+{
+    mNuma = _n;
+}   // end of SetNuma()
+
+/*
+ * collapse the duplicate alignments of every read
+*/
+void SamFile::SetDedup(
+    const unsigned int _w )     // slots of the window of every thread; 0 disables
+{
+    mDedup = _w;
+}   // end of SetDedup()
+
+/*
+ * format of the alignment file; sam by default
+*/
+void SamFile::SetFormat(
+    const unsigned int _f )     // one of nFORMAT_SAM, nFORMAT_BAM and nFORMAT_BLAST
+{
+    mFormat = _f;
+}   // end of SetFormat()
+
+/*
+ * also write the records to a store partitioned by taxon; NULL detaches it.
+ * the store must have been created, and is closed by the caller.
+*/
+void SamFile::SetStore(
+    Store* _s )
+{
+    mStore = _s;
+}   // end of SetStore()
+
+/*
+ * keep only the alignments to the genomes of the panel; NULL detaches it
+*/
+void SamFile::SetPanel(
+    const Panel* _p )
+{
+    mPanel = _p;
+}   // end of SetPanel()
+
+/*
+ * width of the histogram bins in bases; 1 kb by default
+*/
+void SamFile::SetWidth(
+    const unsigned int _w )     // width of a bin
+{
+    mScale = 1.0 / ( ( _w ) ? _w : nBinWIDTH );
+}   // end of SetWidth()
+
+/*
+ * parse the alignment file with the source of its format
+*/
+bool SamFile::Run(
+    const std::map<unsigned int, stTABLE>& _t,  // translation table
+    const std::string& _ifs,            // name of alignment file
+    const std::string& _ofs ) const     // name of summary file
+{
+    if ( mFormat == nFORMAT_BAM )
+    {
+        BamSource s( *this, _ifs ); return( Scan( s, _t, _ifs, _ofs ) );
+    }   // binary sam
+
+    if ( mFormat == nFORMAT_BLAST )
+    {
+        BlastSource s( *this, _ifs ); return( Scan( s, _t, _ifs, _ofs ) );
+    }   // tabular blast
+
+    SamSource s( *this, _ifs );
+
+    return( Scan( s, _t, _ifs, _ofs ) );
+}   // end of Run()
+
 /*
  * parse the string and assign the variables
  * using gnu regular expression library
  * single thread version
+ *
+ * in mate-aware mode, the first segment of a concordant pair is read
+ * together with the line that follows it, which bowtie always reports as
+ * the second segment of the same template
+ *
+ * in best-hit mode, all consecutive lines of the same read are handed to a
+ * thread as one group; the first line of the next read is kept aside
 */
-bool SamFile::Run(
+template <class T> bool SamFile::Scan(
+    T& _s,                              // source of the records
     const std::map<unsigned int, stTABLE>& _t,  // translation table
     const std::string& _ifs,            // name of alignment file
     const std::string& _ofs ) const     // name of summary file
 {
-    const char* szDELIMIT = "\t\n";
-    const char* szNCBIBAR = "|";
-    const unsigned int nMaxBUFFER = 4096;
+    const bool grouped = mByTID || ( mBest > 0 ) || ( mDedup > 0 );
 
-    std::ifstream ifs( _ifs.c_str(), std::ios::in );
     FILE* ofs = ::fopen( _ofs.c_str(), "w" );
+    std::string pending;        // first line of the next read
+    std::string header;         // first line of the summary
+    stCOUNT total;              // counters of the stage
+
+    if ( mReport )
+    {
+        mReport->Begin( "samfile", _ifs );
+    }   // instrumentation of the stage
 
-    ::fprintf( ofs, "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s\n",
-        "Read ID", "Identity", "Length", "Mismatch", "Gaps",
-        "Read Quality", "Map Quality", "Left", "Right", "GID", "TID" );
+    header = "Read ID,Identity,Length,Mismatch,Gaps,Read Quality,Map Quality,Left,Right,GID,TID";
+    header += ( mPaired ) ? ",Segments" : "";
+    ::fprintf( ofs, "%s\n", header.c_str() );
+
+    if ( mStore )
+    {
+        mStore->SetHeader( header );
+    }   // the store keeps the header of the summary
 
     #pragma omp parallel
     {
-        std::vector<std::string> field, ncbi;
-        std::map<char, unsigned int> cigar;
-        char buffer[ nMaxBUFFER ];
-        unsigned int site;
+        std::string buffer;                 // line taken from the reader
+        std::vector<std::string> line;      // lines of the same read
+        std::vector<stSAM> record;          // parsed alignments of the read
+        std::vector<stSEEN> seen( mDedup ); // recent alignments of the thread
+        std::vector<Store::stBLOCK> full;   // blocks of the store to be written
+        std::string text;                   // line of the summary
+        unsigned int size, last, why;
         bool run = false; stSAM sam;
+        stCOUNT count;                      // counters of the thread
+        stCOUNT local;                      // records and bytes of the thread
+        unsigned int node = ( mNuma ) ? mNuma->Bind() : 0;
+        double wait = 0.0;
 
         do
         {
+            wait = ( mReport ) ? Report::Clock() : 0.0;
+
             #pragma omp critical
             {
-                run = ifs.getline( buffer, nMaxBUFFER );
+                size = 0;
+
+                if ( mReport )
+                {
+                    count.wait += Report::Clock() - wait;
+                }   // time spent waiting for the reader
+
+                if ( !pending.empty() )
+                {
+                    Stash( line, size, pending ); pending.clear();
+                }   // the read has been started by the previous group
+                else if ( _s.Next( buffer ) )
+                {
+                    Stash( line, size, buffer ); total.bytes += buffer.size() + 1;
+                }   // the first line of the read
+
+                while ( grouped && ( size > 0 ) && _s.Next( buffer ) )
+                {
+                    total.bytes += buffer.size() + 1;
+
+                    if ( !_s.IsGroup( line[ 0 ], buffer ) )
+                    {
+                        pending.swap( buffer ); break;
+                    }   // the line belongs to the next read
+
+                    Stash( line, size, buffer );
+                }   // collect all alignments of the same read
+
+                if ( !grouped && mPaired && ( size > 0 ) &&
+                    IsPair( _s.GetFlag( line[ 0 ] ) ) && _s.Next( buffer ) )
+                {
+                    Stash( line, size, buffer ); total.bytes += buffer.size() + 1;
+                }   // the second segment follows the first
+
+                total.records += size;
+
+                if ( mReport )
+                {
+                    mReport->Progress( total );
+                }   // periodic progress
             }   // the critical region
 
-            if ( !run )
+            if ( !( run = ( size > 0 ) ) )
             {
                 continue;
             }   // no more data to process
 
-            boost::algorithm::split(                // splite the entire string
-                field, buffer, boost::algorithm::is_any_of( szDELIMIT ) );
-            sam.flag = static_cast<unsigned int>( ::atoi( ( field[ 1 ] ).c_str() ) );
+            record.clear(); last = size; local.records += size;
 
-            if ( ( field[ 5 ] ).length() < 3 )
+            for ( unsigned int i = 0; i < size; ++i )
             {
-                continue;
-            }   // not mached properly, according to the aligner
+                local.bytes += line[ i ].size() + 1;
 
-            boost::algorithm::split(                // split the ncbi annotation
-                ncbi, field[ 2 ], boost::algorithm::is_any_of( szNCBIBAR ) );
-            sam.gid = static_cast<unsigned int>( ::atoi( ( ncbi[ 1 ] ).c_str() ) );
+                if ( !_s.Parse( _t, line[ i ], sam, why ) )
+                {
+                    count.reject[ why ] += 1.0; continue;
+                }   // alignment is not retained
+
+                if ( mPaired && ( last + 1 == i ) && ( ( record.back() ).segment == 1 ) &&
+                    IsPair( ( record.back() ).flag ) && Merge( record.back(), sam ) )
+                {
+                    continue;
+                }   // both segments are now in one template
+
+                record.push_back( sam ); last = i;
+            }   // parse the alignments
+
+            if ( mDedup > 0 )
+            {
+                last = record.size(); Dedup( record, seen );
+                count.reject[ nREJECT_DUPLICATE ] += last - record.size();
+            }   // duplicates never change the assignment of the read
+
+            if ( mByTID || ( mBest > 0 ) )
+            {
+                last = record.size(); Reduce( record );
+                count.reject[ nREJECT_REDUCED ] += last - record.size();
+            }   // only keep the hits that may win the assignment
 
-            if ( _t.find( sam.gid ) == _t.end() )
+            if ( record.empty() )
             {
                 continue;
-            }   // for whatever the reason, gid is not in the table
-
-            ExCIGAR( field[ 5 ], cigar );           // extract cigar string
-            sam.qname = field[ 0 ];                 // query template name
-            sam.alen = cigar[ 'M' ];                // alignment length
-            sam.phred = Sanger( field[ 10 ] );      // phred-scaled score
-            sam.off = ExMD( field );                // number of mismatches
-            sam.gap = cigar[ 'I' ] + cigar[ 'D' ];  // gaps in alignment
-            sam.tid = ( _t.find( sam.gid )->second ).tid;
-            site = static_cast<unsigned int>( ::atoi( ( field[ 3 ] ).c_str() ) );
-            sam.site = SetBin( site ) + ( _t.find( sam.gid )->second ).start;
-            sam.mapq = static_cast<unsigned int>( ::atoi( ( field[ 4 ] ).c_str() ) );
-            sam.ratio = static_cast<double>( sam.alen - sam.off + cigar[ 'I' ] )
-                / ( sam.alen + cigar[ 'I' ] + cigar[ 'S' ] );
+            }   // nothing left to export
+
+            wait = ( mReport ) ? Report::Clock() : 0.0;
 
             #pragma omp critical
             {
-                ::fprintf( ofs, "\"%s\",%.2f,%d,%d,%d,%.2f,%d,%d,%d,%d,%d\n",
-                    sam.qname.c_str(),  // query template name
-                    100.0 * sam.ratio,  // percent identity
-                    sam.alen,           // alignment length
-                    sam.off,            // number of mismatches
-                    sam.gap,            // number of gaps; deletions + insertions
-                    sam.phred,          // phred-scaled based quality score
-                    sam.mapq,           // mapping (alignment) quality
-                    sam.site,           // 1-base leftmost mapping position
-                    sam.site,           // 1-base rightmost mapping position
-                    sam.gid,            // ncbi genome identification
-                    sam.tid );          // ncbi taxonomy identification
+                if ( mReport )
+                {
+                    count.wait += Report::Clock() - wait;
+                }   // time spent waiting for the writer
+
+                for ( unsigned int i = 0; i < record.size(); ++i )
+                {
+                    Export( text, record[ i ] ); ::fwrite( text.data(), 1, text.size(), ofs );
+
+                    if ( mStore )
+                    {
+                        mStore->Add( text, record[ i ].tid, record[ i ].site, record[ i ].mate, full );
+                    }   // the partition of the taxon
+                }   // write the records of the read
             }   // the critical region
+
+            for ( unsigned int i = 0; i < full.size(); ++i )
+            {
+                mStore->Flush( full[ i ] );
+            }   // compressed outside of the critical region
+
+            full.clear(); count.output += record.size();
         } while ( run );    // merge the alignments
+
+        #pragma omp critical
+        {
+            total += count;
+
+            if ( mNuma && mReport )
+            {
+                mReport->Node( node, local );
+            }   // throughput of the numa node
+        }   // the critical region
     }   // end of the parallel section
 
-    ifs.close(); return( static_cast<bool>( fclose( ofs ) ) );
-}   // end of Assign()
+    total.written = ::ftell( ofs );
+
+    if ( mReport )
+    {
+        mReport->End( total );
+    }   // complete the stage
+
+    return( static_cast<bool>( fclose( ofs ) ) );
+}   // end of Scan()
+
+/*
+ * parse a single alignment record
+ * returns false if the record should not appear in the summary
+*/
+bool SamFile::Parse(
+    const std::map<unsigned int, stTABLE>& _t,  // translation table
+    const char* _s,                             // alignment record
+    stSAM& _r,                                  // parsed record
+    unsigned int& _w ) const                    // reason the record is rejected
+{
+    const char* szDELIMIT = "\t\n";
+
+    const char* field[ 12 ];                // mandatory fields and the optional tags
+    unsigned int cigar[ 128 ];              // lengths of the cigar operations
+    unsigned int n = 0;
+    std::map<unsigned int, stTABLE>::const_iterator k;
+    const char* p = ( mPanel ) ? ::strchr( _s, '\t' ) : NULL;
+
+    p = ( p ) ? ::strchr( p + 1, '\t' ) : NULL;   // reference name
+    p = ( p ) ? ::strpbrk( p + 1, "|\t\n" ) : NULL;
+
+    if ( p && ( *p == '|' ) && !mPanel->Has( static_cast<unsigned int>( ::atoi( p + 1 ) ) ) )
+    {
+        _w = ( _t.count( static_cast<unsigned int>( ::atoi( p + 1 ) ) ) ) ? nREJECT_PANEL : nREJECT_TABLE;
+        return( false );
+    }   // genome is not on the panel; the rest of the record is not parsed
+
+    for ( field[ 0 ] = p = _s; *p && ( n < 11 ); ++p )
+    {
+        if ( ( *p == '\t' ) || ( *p == '\n' ) )
+        {
+            field[ ++n ] = p + 1;
+        }   // the next field starts after the delimiter
+    }   // the fields point into the record; nothing is copied
+
+    if ( n < 10 )
+    {
+        _w = nREJECT_FIELD; return( false );
+    }   // header lines and truncated records
+
+    _r.flag = static_cast<unsigned int>( ::atoi( field[ 1 ] ) );
+
+    if ( ::strcspn( field[ 5 ], szDELIMIT ) < 3 )
+    {
+        _w = nREJECT_UNALIGNED; return( false );
+    }   // not mached properly, according to the aligner
+
+    if ( !( p = static_cast<const char*>( ::memchr( field[ 2 ], '|', ::strcspn( field[ 2 ], szDELIMIT ) ) ) ) )
+    {
+        _w = nREJECT_REFERENCE; return( false );
+    }   // reference name does not carry the ncbi gid
+
+    _r.gid = static_cast<unsigned int>( ::atoi( p + 1 ) );
+
+    if ( ( k = _t.find( _r.gid ) ) == _t.end() )
+    {
+        _w = nREJECT_TABLE; return( false );
+    }   // for whatever the reason, gid is not in the table
+
+    ExCIGAR( field[ 5 ], cigar );           // extract cigar string
+    _r.qname.assign( field[ 0 ], ::strcspn( field[ 0 ], szDELIMIT ) );  // query template name
+    _r.alen = cigar[ 'M' ];                 // alignment length
+    _r.phred = Sanger( field[ 10 ], ::strcspn( field[ 10 ], szDELIMIT ) );   // phred-scaled score
+    _r.off = ( n > 10 ) ? ExMD( field[ 11 ] ) : 0;  // number of mismatches
+    _r.gap = cigar[ 'I' ] + cigar[ 'D' ];   // gaps in alignment
+    _r.tid = ( k->second ).tid;
+    _r.pos = static_cast<unsigned int>( ::atoi( field[ 3 ] ) );
+    _r.site = SetBin( _r.pos ) + ( k->second ).start;
+    _r.mapq = static_cast<unsigned int>( ::atoi( field[ 4 ] ) );
+    _r.hit = _r.alen - _r.off + cigar[ 'I' ];
+    _r.span = _r.alen + cigar[ 'I' ] + cigar[ 'S' ];
+    _r.ratio = static_cast<double>( _r.hit ) / _r.span;
+    _r.mate = _r.site; _r.segment = 1;
+
+    return( true );
+}   // end of Parse()
+
+/*
+ * merge the second segment into the first one
+ * both segments must belong to the same template and the same genome
+*/
+bool SamFile::Merge(
+    stSAM& _a,                  // first segment
+    const stSAM& _b ) const     // second segment
+{
+    if ( _a.qname.compare( _b.qname ) || !( _a.gid == _b.gid ) || !IsLast( _b.flag ) )
+    {
+        return( false );
+    }   // not the mates of the same template
+
+    _a.alen += _b.alen;         // combined alignment length
+    _a.off += _b.off;           // combined number of mismatches
+    _a.gap += _b.gap;           // combined number of gaps
+    _a.hit += _b.hit; _a.span += _b.span;
+    _a.ratio = static_cast<double>( _a.hit ) / _a.span;
+    _a.phred = 0.5 * ( _a.phred + _b.phred );
+    _a.mapq = ( _a.mapq + _b.mapq ) / 2;
+    _a.mate = _b.site;          // keep the bin of the second segment
+    _a.segment += _b.segment;
+
+    return( true );
+}   // end of Merge()
+
+/*
+ * keep the best hits of a read
+ *
+ * best hit of each taxon: hits are sorted by taxon, identity threshold and
+ * matched length, and only the first hit of each taxon is kept. top hits:
+ * the taxa are ranked by their best hits, the hits below the identity
+ * threshold last, and all hits of the top taxa are kept, so the coverage of
+ * these taxa is the same as without the reduction; taxa whose best hits tie
+ * with the last one are kept as well because the assignment resolves ties
+ * with the weighted shannon index. the coverage of the other taxa is lost,
+ * and their index may fall below the threshold of the species level
+ * assignment, so the reduction may change the assignments
+*/
+void SamFile::Reduce(
+    std::vector<stSAM>& _r ) const
+{
+    std::vector<stSAM> keep;
+    std::set<unsigned int> top;         // the top taxa of the read
+    unsigned int k = mBest;
+
+    if ( mByTID )
+    {
+        std::sort( _r.begin(), _r.end(), SortEx( mIdentity ) );
+
+        for ( unsigned int i = 0; i < _r.size(); ++i )
+        {
+            if ( keep.empty() || !( ( keep.back() ).tid == _r[ i ].tid ) )
+            {
+                keep.push_back( stSAM() ); ( keep.back() ).swap( _r[ i ] );
+            }   // first hit is the best hit of the taxon
+        }   // walk through the sorted hits
+
+        _r.swap( keep );
+    }   // best hit of each taxon
+
+    if ( ( k == 0 ) || !( _r.size() > k ) )
+    {
+        return;
+    }   // nothing else to remove
+
+    std::stable_sort( _r.begin(), _r.end(), SortHit( mIdentity ) );
+
+    for ( unsigned int i = 0, last = 0; i < _r.size(); last = i++ )
+    {
+        if ( !( top.size() < k ) && SortHit( mIdentity )( _r[ last ], _r[ i ] ) )
+        {
+            break;
+        }   // neither one of the top taxa nor a tie with the last one
+
+        top.insert( _r[ i ].tid );
+    }   // the first hit of a taxon is its best
+
+    keep.clear();
+
+    for ( unsigned int i = 0; i < _r.size(); ++i )
+    {
+        if ( !( top.find( _r[ i ].tid ) == top.end() ) )
+        {
+            keep.push_back( stSAM() ); ( keep.back() ).swap( _r[ i ] );
+        }   // every hit of the top taxa
+    }   // in the order of the rank
+
+    _r.swap( keep );
+}   // end of Reduce()
+
+/*
+ * remove the alignments already seen in the window of the thread; the
+ * first one is kept. a slot holds the last alignment hashed to it, so a
+ * duplicate is only missed once its original has been overwritten
+*/
+void SamFile::Dedup(
+    std::vector<stSAM>& _r,             // alignments of the read
+    std::vector<stSEEN>& _w ) const     // window of the thread
+{
+    unsigned int keep = 0, match, pair;
+    uint64_t h;
+
+    for ( unsigned int i = 0; i < _r.size(); ++i )
+    {
+        match = _r[ i ].alen - _r[ i ].off;
+        pair = ( _r[ i ].flag & 0xc0 ) | _r[ i ].segment;
+        h = Hash64( _r[ i ].qname.data(), _r[ i ].qname.size(),
+            Mix64( ( static_cast<uint64_t>( _r[ i ].gid ) << 32 ) | _r[ i ].pos ) ^
+            Mix64( ( static_cast<uint64_t>( _r[ i ].mate ) << 32 ) | match ) ^
+            Mix64( pair ) ) | 1;
+        stSEEN& s = _w[ h % _w.size() ];
+
+        if ( ( s.hash == h ) && ( s.gid == _r[ i ].gid ) && ( s.pos == _r[ i ].pos ) &&
+            ( s.mate == _r[ i ].mate ) && ( s.match == match ) && ( s.pair == pair ) &&
+            ( s.qname == _r[ i ].qname ) )
+        {
+            continue;
+        }   // the same alignment has been seen
+
+        s.hash = h; s.qname = _r[ i ].qname; s.gid = _r[ i ].gid; s.pos = _r[ i ].pos;
+        s.mate = _r[ i ].mate; s.match = match; s.pair = pair;
+
+        if ( !( keep == i ) )
+        {
+            _r[ keep ].swap( _r[ i ] );
+        }   // close the gap
+
+        ++keep;
+    }   // every alignment of the read
+
+    _r.resize( keep );
+}   // end of Dedup()
+
+/*
+ * format a record as a line of the summary file
+*/
+void SamFile::Export(
+    std::string& _f,            // line, with the newline
+    const stSAM& _s ) const
+{
+    char buffer[ 256 ];
+    int n = ::snprintf( buffer, sizeof( buffer ), "\",%.2f,%d,%d,%d,%.2f,%d,%d,%d,%d,%d",
+        100.0 * _s.ratio,   // percent identity
+        _s.alen,            // alignment length
+        _s.off,             // number of mismatches
+        _s.gap,             // number of gaps; deletions + insertions
+        _s.phred,           // phred-scaled based quality score
+        _s.mapq,            // mapping (alignment) quality
+        _s.site,            // bin of the leftmost segment
+        _s.mate,            // bin of the rightmost segment
+        _s.gid,             // ncbi genome identification
+        _s.tid );           // ncbi taxonomy identification
+    n += ::snprintf( buffer + n, sizeof( buffer ) - n, ( mPaired ) ? ",%d\n" : "\n", _s.segment );
+
+    _f.assign( 1, '"' ); _f.append( _s.qname ); _f.append( buffer, n );
+}   // end of Export()
+
+/*
+ * retrieve the alignment flag, i.e., the second field, of a record
+*/
+unsigned int SamFile::GetFlag(
+    const char* _s ) const
+{
+    const char* p = ::strchr( _s, '\t' );
+
+    return( ( p ) ? static_cast<unsigned int>( ::atoi( p + 1 ) ) : 0 );
+}   // end of GetFlag()
+
+/*
+ * first segment of a concordantly aligned pair
+*/
+bool SamFile::IsPair(
+    const unsigned int _f ) const
+{
+    return( ( _f & 0x01 ) && IsAligned( _f ) && IsMapped( _f ) && IsFirst( _f ) );
+}   // end of IsPair()
+
+/*
+ * test if a line carries the same query name, i.e., the first field, as
+ * the first line of a read
+*/
+bool SamFile::IsGroup(
+    const std::string& _g,      // first line of the read
+    const char* _s ) const      // line to be tested
+{
+    std::string::size_type k = _g.find( '\t' );
+
+    return( !( k == std::string::npos ) &&
+        ( ::strncmp( _g.c_str(), _s, k + 1 ) == 0 ) );
+}   // end of IsGroup()
+
+/*
+ * keep a copy of the line; storage of the previous lines is reused
+*/
+void SamFile::Stash(
+    std::vector<std::string>& _l,   // lines of the read
+    unsigned int& _n,               // number of lines in use
+    const std::string& _s ) const   // line to be kept; records of bam are binary
+{
+    if ( _n < _l.size() )
+    {
+        _l[ _n++ ].assign( _s ); return;
+    }   // reuse the storage
+
+    _l.push_back( _s ); ++_n;
+}   // end of Stash()
 
 /*
  * The SAM FLAGS field, the second field in a SAM record, has multiple bits that
@@ -215,54 +722,47 @@ bool SamFile::IsLast(
 unsigned int SamFile::SetBin(
     const unsigned int _s ) const
 {
-    return( static_cast<unsigned int>( ::lrint( _s * 0.001 ) ) );
+    return( static_cast<unsigned int>( ::lrint( _s * mScale ) ) );
 }   // end of SetBin()
 
 /*
  * calculate the phred-scaled base quality score
 */
 double SamFile::Sanger(
-    const std::string& _s ) const
+    const char* _s,             // base qualities
+    const size_t _n ) const     // number of bases
 {
     const unsigned int nMaxOFFSET = 33;
     double s = 0.0;
 
-    for ( unsigned int i = 0; i < _s.size(); ++i )
+    for ( size_t i = 0; i < _n; ++i )
     {
         s += ( static_cast<unsigned int>( _s[ i ] ) - nMaxOFFSET );
     }   // accumulate the score
 
-    return( ( _s.size() > 1 ) ? ( s / _s.size() ) : 0.0 );
+    return( ( _n > 1 ) ? ( s / _n ) : 0.0 );
 }   // end of Sanger()
 
 /*
- * extract the cigar string
+ * extract the cigar string; the lengths of the operations, MIDNSHP=X, are
+ * indexed by their characters
 */
 bool SamFile::ExCIGAR(
-    const std::string& _s,
-    std::map<char, unsigned int>& _m ) const
+    const char* _s,             // cigar string; ends at a delimiter
+    unsigned int* _m ) const    // lengths of the operations; 128 entries
 {
-    char tag;
-    const char* cigar = "MIDNSHP=X";
-    std::string buffer;
-    buffer.clear(); _m.clear();
+    unsigned int length = 0;
 
-    for ( unsigned int i = 0; i < ::strlen( cigar ); ++i )
-    {
-        _m.insert( std::pair<char, unsigned int>( cigar[ i ], 0 ) );
-    }   // initialize the map
+    ::memset( _m, 0, 128 * sizeof( unsigned int ) );
 
-    for ( unsigned int t = 0; t < _s.size(); ++t )
+    for ( ; *_s && !( *_s == '\t' ) && !( *_s == '\n' ); ++_s )
     {
-        tag = _s[ t ];
-
-        if ( ::isalpha( tag ) )
+        if ( ::isdigit( *_s ) )
         {
-            _m[ tag ] += static_cast<unsigned int>( ::atoi( buffer.c_str() ) );
-            buffer.clear(); continue;
-        }   // assign the value
+            length = 10 * length + ( *_s - '0' ); continue;
+        }   // length of the operation
 
-        buffer.push_back( tag );    // add a character to the string
+        _m[ *_s & 0x7f ] += length; length = 0;
     }   // parse the cigar string
 
     return( true );
@@ -280,23 +780,24 @@ bool SamFile::ExCIGAR(
  * ought to match the CIGAR string.
 */
 unsigned int SamFile::ExMD(
-    const std::vector<std::string>& _s ) const
+    const char* _s ) const      // optional tags; they begin at the field 11
 {
     unsigned int m = 0;
     const char* tag = "MD:Z:";
+    const char* p = _s;
 
-    for ( unsigned int i = 11; i < _s.size(); ++i )
+    while ( p )
     {
-        if ( ( _s[ i ] ).find( tag ) == std::string::npos )
+        if ( !::strncmp( p, tag, 5 ) )
         {
-            continue;
-        }   // the md tag is not found
+            for ( p += 5; *p && !( *p == '\t' ) && !( *p == '\n' ); ++p )
+            {
+                m += ::isalpha( *p ) ? 1 : 0;
+            }   // accumulate the number of mismatches
+        }   // the md tag is found
 
-        for ( unsigned int t = ::strlen( tag ); t < ( _s[ i ] ).size(); ++t )
-        {
-            m += ::isalpha( ( _s[ i ] )[ t ] ) ? 1 : 0;
-        }   // accumulate the number of mismatches
-    }   // optional tages begin at 11
+        p = ::strchr( p, '\t' ); p = ( p ) ? p + 1 : NULL;
+    }   // every optional tag
 
     return( m );
 }   // end of ExMD()
@@ -310,35 +811,147 @@ unsigned int SamFile::ExMD(
  * translation table
  * alignment file generated by bowtie
  * ouput filename
+ *
+ * optional parameters:
+ * --paired     merge concordant mates into one template-level record
+ * --best=tid   keep the best hit of each taxon for every read
+ * --best=N     keep the hits of the top N taxa by matched length for
+ *              every read; --best may change the assignments
+ * --min-identity=P  minimum percent identity of a candidate, the same as that
+ *              of assign; --best ranks the hits below it last; default 85
+ * --report=F   write the instrumentation of the run to F in json
+ * --progress   periodic progress with throughput and eta on stderr
+ * --numa       pin the threads to the numa nodes; --numa=N for N nodes
+ * --dedup      collapse the alignments of a read identical in segment, genome,
+ *              position and matched length; --dedup=N for a window of N alignments
+ *              per thread, default 65536
+ * --cache=D    reuse the summary of a previous run with the same inputs and
+ *              options from the cache directory D, or keep it there
+ * --cache-size=SIZE    size limit of the cache, e.g., 20G; least recently
+ *              used entries are removed first; default unlimited
+ * --format=F   format of the alignment file: sam, bam or blast (tabular,
+ *              -outfmt 6); default bam for files ending in .bam, sam otherwise
+ * --store      also write the records partitioned by taxon into sample.store
+ *              and its index, sample.store.idx, for the query program
+ * --partitions=N   partitions of the store; default 64
+ * --threads=N  number of threads; default OMP_NUM_THREADS or all processors
+ * --panel=F    keep only the alignments to the taxa listed in F, one tid or
+ *              species name per line
+ * --bin-width=W    width of the histogram bins in bases; default 1000. assign
+ *              must be given the same width
 */
 int main( int argc, char** argv )
 {
-    if ( argc < 4 )
+    Option opt( argc, argv, "best,min-identity,report,cache,cache-size,format,partitions,threads,panel,bin-width" );
+    const std::vector<std::string>& arg = opt.GetArgs();
+
+    if ( arg.size() < 3 )
     {
         return( 0 );
     }   // check the number of parameters
 
-    const unsigned int nMaxBUFFER = 2048;
-
-    stTABLE a;
-    char buffer[ nMaxBUFFER ];
     std::map<unsigned int, stTABLE> table;
-    std::ifstream ifs( argv[ 1 ], std::ios::in );
+    std::vector<std::string> output( 1, arg[ 2 ] );
+    std::vector<std::string> field;
+    boost::algorithm::split( field, arg[ 2 ], boost::algorithm::is_any_of( ".\n" ) );
+
+    if ( opt.Has( "store" ) )
+    {
+        output.push_back( field[ 0 ] + ".store" ); output.push_back( field[ 0 ] + ".store.idx" );
+    }   // the store is an output as well
+
+    Cache c( opt.Get( "cache" ), opt.GetBytes( "cache-size", 0 ) );
+
+    if ( opt.Has( "cache" ) )
+    {
+        c.AddText( "samfile" ); c.AddFile( arg[ 0 ] ); c.AddFile( arg[ 1 ] );
+        c.AddOptions( opt.GetOptions(), "cache,cache-size,report,progress,numa,threads,panel" );
 
-    if ( ifs.fail() )
+        if ( opt.Has( "panel" ) )
+        {
+            c.AddFile( opt.Get( "panel" ) );
+        }   // the contents of the panel, not its name
+
+        if ( c.Fetch( output ) )
+        {
+            ::printf( "restored from cache: %s\n", c.GetKey().c_str() ); return( 0 );
+        }   // the same inputs have been parsed before
+    }   // check the cache first
+
+    if ( !LoadTable( arg[ 0 ], table ) )
     {
         return( 0 );
-    }   // check the state of stream
+    }   // load the translation table
+
+    Numa::SetThreads( opt.GetSize( "threads", 0 ) );
+    SetWidth( table, opt.GetSize( "bin-width", nBinWIDTH ) );
+    SamFile s; s.SetPaired( opt.Has( "paired" ) ); s.SetWidth( opt.GetSize( "bin-width", nBinWIDTH ) );
+    const std::string format = opt.Get( "format",
+        boost::algorithm::iends_with( arg[ 1 ], ".bam" ) ? "bam" : "sam" );
+
+    if ( !( format == "sam" ) && !( format == "bam" ) && !( format == "blast" ) )
+    {
+        ::fprintf( stderr, "samfile: unknown format %s\n", format.c_str() ); return( 1 );
+    }   // check the format of the alignment file
+
+    s.SetFormat( ( format == "bam" ) ? nFORMAT_BAM : ( ( format == "blast" ) ? nFORMAT_BLAST : nFORMAT_SAM ) );
+
+    if ( opt.Has( "best" ) )
+    {
+        ( opt.Get( "best" ) == "tid" ) ?
+            s.SetBest( 0, true, opt.GetReal( "min-identity", 85.0 ) ) :
+            s.SetBest( opt.GetSize( "best", 0 ), false, opt.GetReal( "min-identity", 85.0 ) );
+    }   // best-hit reduction of every read
+
+    if ( opt.Has( "dedup" ) )
+    {
+        s.SetDedup( opt.GetSize( "dedup", 0 ) ? opt.GetSize( "dedup", 0 ) : 65536 );
+    }   // deduplication of the alignments
+
+    Report r; r.SetProgress( opt.Has( "progress" ) );
+    Numa numa( opt.GetSize( "numa", 0 ) );
 
-    ifs.getline( buffer, nMaxBUFFER );  // skip the header
+    if ( opt.Has( "report" ) || opt.Has( "progress" ) )
+    {
+        s.SetReport( &r );
+    }   // instrumentation of the run
+
+    if ( opt.Has( "numa" ) )
+    {
+        s.SetNuma( &numa );
+    }   // threads placed on the numa nodes
+
+    Panel panel;
+
+    if ( opt.Has( "panel" ) && !panel.Load( opt.Get( "panel" ), table ) )
+    {
+        ::fprintf( stderr, "samfile: no taxon of %s is in the table\n", opt.Get( "panel" ).c_str() ); return( 1 );
+    }   // target taxa
+
+    s.SetPanel( ( opt.Has( "panel" ) ) ? &panel : NULL );
+    Store store;
 
-    while ( ifs.getline( buffer, nMaxBUFFER ) )
+    if ( opt.Has( "store" ) && !store.Create( field[ 0 ] + ".store", opt.GetSize( "partitions", 64 ) ) )
     {
-        a = buffer; table[ a.gid ] = a;
-    }   // parse the file
+        ::fprintf( stderr, "samfile: unable to write %s.store\n", field[ 0 ].c_str() ); return( 1 );
+    }   // records partitioned by taxon
 
-    ifs.close();
-    SamFile s; s.Run( table, argv[ 2 ], argv[ 3 ] );
+    s.SetStore( ( opt.Has( "store" ) ) ? &store : NULL ); s.Run( table, arg[ 1 ], arg[ 2 ] );
+
+    if ( opt.Has( "store" ) && !( store.SetSource( arg[ 2 ] ) && store.Close() ) )
+    {
+        ::fprintf( stderr, "samfile: unable to write %s.store\n", field[ 0 ].c_str() ); return( 1 );
+    }   // the index is written once all records are in the store
+
+    if ( opt.Has( "cache" ) )
+    {
+        c.Store( output );
+    }   // keep the summary for the next run
+
+    if ( opt.Has( "report" ) )
+    {
+        r.Write( opt.Get( "report" ) );
+    }   // write the report at exit
 
     return( 0 );
 }   // end of main()
@@ -27,23 +27,66 @@
  * Revised on January 24, 2013
  * Revised on February 3, 2013
  * Revised on February 14, 2013
+ *
+ * mate-aware mode merges the concordant segments of a paired-end template
+ * into a single record; the second segment keeps its own histogram bin
+ *
+ * best-hit mode reads all alignments of a read as one group, which bowtie
+ * reports consecutively, and keeps either the best hit of each taxon or the
+ * top hits by matched length
+ *
+ * deduplication collapses the alignments of a read that are identical in
+ * genome, histogram bins and matched length; every thread remembers the
+ * recent alignments in a hashed window, and the reads are handed to the
+ * threads as groups, the same as in best-hit mode
+ *
+ * the records are taken from a source of the input format, see source.h;
+ * the parser is compiled once for every source
+ *
+ * the records may also be written to a store partitioned by taxon, see
+ * store.h; the lines are the same as those of the summary
+ *
+ * with a panel of target taxa, see panel.h, the alignments to the other
+ * genomes are rejected as soon as the reference name is found, before the
+ * record is split into its fields
+ *
+ * the bins are 1 kb wide unless set otherwise; the translation table must be
+ * scaled to the same width, see SetWidth() of table.h
 */
 
 #ifndef _SAMFILE_H
 #define _SAMFILE_H
 
 #include <table.h>
+#include <report.h>
+#include <placement.h>
+#include <hash.h>
+#include <store.h>
+#include <panel.h>
 
 #include <map>
 #include <list>
+#include <cstdio>
+#include <cstdlib>
 #include <vector>
 #include <string>
 
+/*
+ * formats of the alignment file
+*/
+enum
+{
+    nFORMAT_SAM = 0,        // text sam, e.g., written by bowtie
+    nFORMAT_BAM,            // binary sam
+    nFORMAT_BLAST           // tabular blast, -outfmt 6
+};
+
 struct stSAM
 {
     stSAM()
     {
-        qname.clear();
+        qname.clear(); alen = 0; gap = 0; off = 0; flag = 0; site = 0; mate = 0; pos = 0;
+        hit = 0; span = 0; segment = 1; tid = 0; gid = 0; mapq = 0; ratio = 0.0; phred = 0.0;
     }   // default constructor
 
     stSAM( const stSAM& _s )
@@ -51,6 +94,37 @@ struct stSAM
         *this = _s;
     }   // copy constructor
 
+    stSAM& operator=( const stSAM& _s )
+    {
+        qname = _s.qname; Copy( _s ); return( *this );
+    }   // assignment
+
+#if __cplusplus >= 201103L
+    stSAM( stSAM&& _s )
+    {
+        swap( _s );
+    }   // move constructor
+
+    stSAM& operator=( stSAM&& _s )
+    {
+        qname.swap( _s.qname ); Copy( _s ); return( *this );
+    }   // move assignment
+#endif
+
+    void swap( stSAM& _s )
+    {
+        stSAM t; t.Copy( *this ); Copy( _s ); _s.Copy( t );
+        qname.swap( _s.qname );
+    }   // exchange the contents without copying the query name
+
+    void Copy( const stSAM& _s )
+    {
+        alen = _s.alen; gap = _s.gap; off = _s.off; flag = _s.flag;
+        site = _s.site; mate = _s.mate; pos = _s.pos; hit = _s.hit; span = _s.span;
+        segment = _s.segment; tid = _s.tid; gid = _s.gid; mapq = _s.mapq;
+        ratio = _s.ratio; phred = _s.phred;
+    }   // copy the numeric fields
+
     ~stSAM()
     {
         qname.clear();
@@ -61,7 +135,12 @@ struct stSAM
     unsigned int gap;       // number of gaps; deletions and insertions
     unsigned int off;       // number of mismatches
     unsigned int flag;      // alignment flag reported by bowtie
-    unsigned int site;      // 1-base leftmost mapping position
+    unsigned int site;      // histogram bin of the leftmost mapping position
+    unsigned int mate;      // histogram bin of the second segment
+    unsigned int pos;       // 1-base leftmost mapping position
+    unsigned int hit;       // identical bases; numerator of percent identity
+    unsigned int span;      // read bases; denominator of percent identity
+    unsigned int segment;   // number of segments in the record
     unsigned int tid;       // ncbi taxonomy identification
     unsigned int gid;       // ncbi genome identification
     unsigned int mapq;      // mapping quality; alignment quality score
@@ -84,8 +163,50 @@ public:
     bool Run(
         const std::map<unsigned int, stTABLE>&,
         const std::string&, const std::string& ) const;
+    void SetPaired( const bool );
+    void SetBest( const unsigned int, const bool = false, const double = 85.0 );
+    void SetReport( Report* );
+    void SetNuma( const Numa* );
+    void SetDedup( const unsigned int );
+    void SetFormat( const unsigned int );
+    void SetStore( Store* );
+    void SetPanel( const Panel* );
+    void SetWidth( const unsigned int );
 
 private:
+    struct stSEEN
+    {
+        stSEEN()
+        {
+            hash = 0; gid = 0; pos = 0; mate = 0; match = 0; pair = 0;
+        }   // default constructor; the slot is empty
+
+        uint64_t hash;          // hash of the alignment; 0 if the slot is empty
+        std::string qname;      // query template name
+        unsigned int gid;       // ncbi genome identification
+        unsigned int pos;       // leftmost mapping position
+        unsigned int mate;      // bin of the rightmost segment
+        unsigned int match;     // matched length; alignment length without mismatches
+        unsigned int pair;      // first or second in pair, and number of segments
+    };  // a slot of the deduplication window
+
+    bool mPaired;           // merge concordant mates into templates
+    bool mByTID;            // keep the best hit of each taxon
+    unsigned int mBest;     // keep the hits of the top taxa by matched length; 0 keeps all
+    double mIdentity;       // hits below the percent identity rank after all others
+    Report* mReport;        // instrumentation; NULL if not attached
+    const Numa* mNuma;      // placement of the threads; NULL if not attached
+    unsigned int mDedup;    // slots of the deduplication window; 0 disables
+    unsigned int mFormat;   // format of the alignment file
+    Store* mStore;          // records partitioned by taxon; NULL if not attached
+    const Panel* mPanel;    // target taxa; NULL keeps all genomes of the table
+    double mScale;          // bins per base; the reciprocal of the width of a bin
+
+    friend class Kernel;    // microbenchmarks of the parsing kernels
+    friend class SamSource; // record sources of the formats
+    friend class BamSource;
+    friend class BlastSource;
+
     /*
      * A typical use of a function object is in writing callback functions.
      * A callback in procedural languages, such as C, may be performed by using
@@ -97,6 +218,8 @@ private:
     */
     struct SortEx
     {
+        SortEx( const double _i = 0.0 ) : identity( _i ) {}
+
         bool TestTID( const stSAM& _a, const stSAM& _b ) const
         {
             return( _a.tid > _b.tid );
@@ -110,42 +233,105 @@ private:
             return( ( i > j ) ? true : false );
         }   // end of TestSize()
 
+        /*
+         * the percent identity as written to the summary, which is what the
+         * species level assignment compares with its threshold
+        */
+        static double Percent( const stSAM& _s )
+        {
+            char buffer[ 32 ];
+
+            ::snprintf( buffer, sizeof( buffer ), "%.2f", 100.0 * _s.ratio );
+            return( ::atof( buffer ) );
+        }   // end of Percent()
+
+        bool TestGate( const stSAM& _a, const stSAM& _b ) const
+        {
+            return( !( Percent( _a ) < identity ) && ( Percent( _b ) < identity ) );
+        }   // end of TestGate()
+
         bool TestName( const stSAM& _a, const stSAM& _b ) const
         {
-            return( ( _a.qname.compare( _b.qname ) == 0 ) ? true : false );
+            return( ( _a.qname.compare( _b.qname ) < 0 ) ? true : false );
         }   // end of TestName()
 
         /*
          * sorting criteria
          * 1. read identification
          * 2. ncbi taxonomy identification
-         * 3. alignmnet lengths (without mismatches)
+         * 3. percent identity at or above the threshold of the assignment
+         * 4. alignmnet lengths (without mismatches)
+         *
+         * each criterion is only consulted if the previous ones are equal
         */
         bool operator()( const stSAM& _a, const stSAM& _b ) const
         {
-            if ( TestName( _a, _b ) )
+            if ( TestName( _a, _b ) || TestName( _b, _a ) )
             {
-                return( true );
+                return( TestName( _a, _b ) );
             }   // check the query name
 
-            if ( TestTID( _a, _b ) )
+            if ( TestTID( _a, _b ) || TestTID( _b, _a ) )
             {
-                return( true );
+                return( TestTID( _a, _b ) );
             }   // check the taxnomy identification
 
+            if ( TestGate( _a, _b ) || TestGate( _b, _a ) )
+            {
+                return( TestGate( _a, _b ) );
+            }   // check the percent identity
+
             return( TestSize( _a, _b ) );
         }   // end of operator overloading
+
+        double identity;    // minimum percent identity of a candidate
     };  // end of class SortEx
 
-    double Sanger( const std::string& ) const;
+    /*
+     * sorting criteria for the hits of a single read, the same as those of
+     * the species level assignment as far as they are known to the parser
+     * 1. percent identity at or above the threshold of the assignment
+     * 2. alignmnet lengths (without mismatches)
+    */
+    struct SortHit
+    {
+        SortHit( const double _i = 0.0 ) : rank( _i ) {}
+
+        bool operator()( const stSAM& _a, const stSAM& _b ) const
+        {
+            if ( rank.TestGate( _a, _b ) || rank.TestGate( _b, _a ) )
+            {
+                return( rank.TestGate( _a, _b ) );
+            }   // check the percent identity
+
+            return( rank.TestSize( _a, _b ) );
+        }   // end of operator overloading
+
+        SortEx rank;        // criteria of the hits
+    };  // end of class SortHit
+
+    double Sanger( const char*, const size_t ) const;
     unsigned int SetBin( const unsigned int ) const;
-    unsigned int ExMD( const std::vector<std::string>& ) const;
+    unsigned int ExMD( const char* ) const;
 
     bool IsLast( const unsigned int ) const;
     bool IsFirst( const unsigned int ) const;
     bool IsMapped( const unsigned int ) const;
     bool IsAligned( const unsigned int ) const;
-    bool ExCIGAR( const std::string&, std::map<char, unsigned int>& ) const;
+    bool ExCIGAR( const char*, unsigned int* ) const;
+
+    unsigned int GetFlag( const char* ) const;
+    bool IsPair( const unsigned int ) const;
+    bool IsGroup( const std::string&, const char* ) const;
+    void Stash( std::vector<std::string>&, unsigned int&, const std::string& ) const;
+    void Reduce( std::vector<stSAM>& ) const;
+    void Dedup( std::vector<stSAM>&, std::vector<stSEEN>& ) const;
+    bool Merge( stSAM&, const stSAM& ) const;
+    void Export( std::string&, const stSAM& ) const;
+    bool Parse( const std::map<unsigned int, stTABLE>&, const char*, stSAM&, unsigned int& ) const;
+
+    template <class T> bool Scan( T&, const std::map<unsigned int, stTABLE>&,
+        const std::string&, const std::string& ) const;
 };  // end of class definition
 
 #endif  // _SAMTOOL_H
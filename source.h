@@ -0,0 +1,480 @@
+/*
+ * source.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * record sources of the parser
+ *
+ * a source takes the records of one input format and turns them into the
+ * same alignments, stSAM, so the grouping, merging, reduction and summary of
+ * the parser do not depend on the format. the parser is a template of the
+ * source, and every source offers the same members:
+ *
+ * IsOpen()     the input could be opened
+ * Next()       the next record; called from one thread at a time
+ * IsGroup()    the record belongs to the same read as the first one
+ * GetFlag()    alignment flag of the record; 0 if the format has none
+ * Parse()      the alignment of the record; false if it is rejected
+ *
+ * no member is virtual and all of them are defined in the class, so the
+ * per-record path of every format is compiled, and inlined, on its own.
+ *
+ * SamSource    text sam, e.g., written by bowtie; parsed by SamFile::Parse()
+ * BamSource    binary sam, i.e., bgzf compressed records read with zlib
+ * BlastSource  tabular blast, -outfmt 6: qseqid, sseqid, pident, length,
+ *              mismatch, gapopen, qstart, qend, sstart, send, evalue and
+ *              bitscore; the gid is taken from the subject id, gi|123|...
+ *              or 123, the same as the reference name of the sam formats
+*/
+
+#ifndef _SOURCE_H
+#define _SOURCE_H
+
+#include <table.h>
+#include <reader.h>
+#include <report.h>
+#include <samfile.h>
+
+#include <map>
+#include <cmath>
+#include <cctype>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+#include <unistd.h>
+#include <stdint.h>
+
+class SamSource
+{
+public:
+    SamSource(
+        const SamFile& _p,          // parser of the records
+        const std::string& _f ) :   // name of alignment file; "-" is the standard input
+        mParser( _p ), mFile( _f )
+    {
+    }   // default constructor
+
+    bool IsOpen() const
+    {
+        return( mFile.IsOpen() );
+    }   // end of IsOpen()
+
+    bool Next( std::string& _r )
+    {
+        return( mFile.GetLine( _r ) );
+    }   // end of Next()
+
+    bool IsGroup( const std::string& _g, const std::string& _r ) const
+    {
+        return( mParser.IsGroup( _g, _r.c_str() ) );
+    }   // end of IsGroup()
+
+    unsigned int GetFlag( const std::string& _r ) const
+    {
+        return( mParser.GetFlag( _r.c_str() ) );
+    }   // end of GetFlag()
+
+    bool Parse(
+        const std::map<unsigned int, stTABLE>& _t,  // translation table
+        const std::string& _r,                      // alignment record
+        stSAM& _s,                                  // parsed record
+        unsigned int& _w ) const                    // reason the record is rejected
+    {
+        return( mParser.Parse( _t, _r.c_str(), _s, _w ) );
+    }   // end of Parse()
+
+private:
+    const SamFile& mParser;
+    Reader mFile;
+};  // end of class SamSource
+
+/*
+ * every record is the size of the block followed by the block: reference,
+ * position (0-base), length of the name, mapping quality, bin, number of
+ * cigar operations, flag, length of the sequence, mate reference, mate
+ * position and template length, then the name, cigar, sequence, qualities
+ * and optional tags. the names of the references are in the header
+*/
+class BamSource
+{
+public:
+    BamSource(
+        const SamFile& _p,          // parser of the records
+        const std::string& _f ) :   // name of alignment file; "-" is the standard input
+        mParser( _p )
+    {
+        mFile = ( _f == "-" ) ? ::gzdopen( ::dup( 0 ), "rb" ) : ::gzopen( _f.c_str(), "rb" );
+
+        if ( mFile )
+        {
+            ::gzbuffer( mFile, 1 << 20 );
+        }   // same block size as the reader
+
+        if ( mFile && !Header() )
+        {
+            ::gzclose( mFile ); mFile = NULL;
+        }   // not a bam file
+    }   // default constructor
+
+    ~BamSource()
+    {
+        if ( mFile )
+        {
+            ::gzclose( mFile );
+        }   // the file has been opened
+    }   // default destructor
+
+    bool IsOpen() const
+    {
+        return( mFile != NULL );
+    }   // end of IsOpen()
+
+    bool Next( std::string& _r )
+    {
+        int32_t size;
+
+        if ( !mFile || !Read( &size, 4 ) || ( size < 32 ) )
+        {
+            return( false );
+        }   // end of the file or a truncated record
+
+        _r.resize( size );
+
+        return( Read( &_r[ 0 ], size ) );
+    }   // end of Next()
+
+    bool IsGroup( const std::string& _g, const std::string& _r ) const
+    {
+        return( ::strcmp( _g.c_str() + 32, _r.c_str() + 32 ) == 0 );
+    }   // end of IsGroup()
+
+    unsigned int GetFlag( const std::string& _r ) const
+    {
+        return( Get<uint16_t>( _r, 14 ) );
+    }   // end of GetFlag()
+
+    /*
+     * the same fields as SamFile::Parse(); the base qualities are stored
+     * without the offset of 33, and 0xff if they are missing
+    */
+    bool Parse(
+        const std::map<unsigned int, stTABLE>& _t,  // translation table
+        const std::string& _r,                      // alignment record
+        stSAM& _s,                                  // parsed record
+        unsigned int& _w ) const                    // reason the record is rejected
+    {
+        const int32_t ref = Get<int32_t>( _r, 0 );
+        const unsigned int name = Get<uint8_t>( _r, 8 );
+        const unsigned int ops = Get<uint16_t>( _r, 12 );
+        const int32_t length = Get<int32_t>( _r, 16 );
+        const size_t cigar = 32 + name;
+        const size_t qual = cigar + 4 * ops + ( length + 1 ) / 2;
+        unsigned int op[ 16 ] = { 0 }, v;
+        std::map<unsigned int, stTABLE>::const_iterator k;
+
+        if ( ( length < 0 ) || ( _r.size() < qual + length ) )
+        {
+            _w = nREJECT_FIELD; return( false );
+        }   // truncated record
+
+        _s.flag = GetFlag( _r );
+
+        if ( ( ref < 0 ) || ( ops == 0 ) )
+        {
+            _w = nREJECT_UNALIGNED; return( false );
+        }   // not mached properly, according to the aligner
+
+        if ( !( static_cast<size_t>( ref ) < mGID.size() ) || ( mGID[ ref ] < 0 ) )
+        {
+            _w = nREJECT_REFERENCE; return( false );
+        }   // reference name does not carry the ncbi gid
+
+        _s.gid = static_cast<unsigned int>( mGID[ ref ] );
+
+        if ( ( k = _t.find( _s.gid ) ) == _t.end() )
+        {
+            _w = nREJECT_TABLE; return( false );
+        }   // for whatever the reason, gid is not in the table
+
+        if ( mParser.mPanel && !( mParser.mPanel )->Has( _s.gid ) )
+        {
+            _w = nREJECT_PANEL; return( false );
+        }   // genome is not on the panel; the cigar is not decoded
+
+        for ( unsigned int i = 0; i < ops; ++i )
+        {
+            v = Get<uint32_t>( _r, cigar + 4 * i ); op[ v & 0x0f ] += v >> 4;
+        }   // operations in the order of MIDNSHP=X
+
+        _s.qname.assign( _r.c_str() + 32 );     // query template name
+        _s.alen = op[ 0 ];                      // alignment length
+        _s.phred = Sanger( _r, qual, length );  // phred-scaled score
+        _s.off = ExMD( _r, qual + length );     // number of mismatches
+        _s.gap = op[ 1 ] + op[ 2 ];             // gaps in alignment
+        _s.tid = ( k->second ).tid;
+        _s.pos = static_cast<unsigned int>( Get<int32_t>( _r, 4 ) + 1 );
+        _s.site = mParser.SetBin( _s.pos ) + ( k->second ).start;
+        _s.mapq = Get<uint8_t>( _r, 9 );
+        _s.hit = _s.alen - _s.off + op[ 1 ];
+        _s.span = _s.alen + op[ 1 ] + op[ 4 ];
+        _s.ratio = static_cast<double>( _s.hit ) / _s.span;
+        _s.mate = _s.site; _s.segment = 1;
+
+        return( true );
+    }   // end of Parse()
+
+private:
+    const SamFile& mParser;
+    gzFile mFile;                   // bgzf is a series of gzip members
+    std::vector<int> mGID;          // gid of every reference; -1 if none
+
+    bool Read( void* _p, const unsigned int _n )
+    {
+        return( ::gzread( mFile, _p, _n ) == static_cast<int>( _n ) );
+    }   // end of Read()
+
+    /*
+     * magic "BAM\1", length and text of the sam header, number of
+     * references, then the length, name and size of every reference
+    */
+    bool Header()
+    {
+        char magic[ 4 ];
+        int32_t n, size;
+        std::string name;
+
+        if ( !Read( magic, 4 ) || ::memcmp( magic, "BAM\1", 4 ) || !Read( &n, 4 ) || ( n < 0 ) )
+        {
+            return( false );
+        }   // not a bam file
+
+        name.resize( n + 1 );
+
+        if ( ( n > 0 ) && !Read( &name[ 0 ], n ) )
+        {
+            return( false );
+        }   // text of the header is not used
+
+        if ( !Read( &n, 4 ) || ( n < 0 ) )
+        {
+            return( false );
+        }   // number of references
+
+        for ( int32_t i = 0; i < n; ++i )
+        {
+            if ( !Read( &size, 4 ) || ( size < 1 ) )
+            {
+                return( false );
+            }   // length of the name
+
+            name.resize( size );
+
+            if ( !Read( &name[ 0 ], size ) || !Read( &size, 4 ) )
+            {
+                return( false );
+            }   // name and size of the reference
+
+            const char* bar = ::strchr( name.c_str(), '|' );
+            mGID.push_back( ( bar ) ? ::atoi( bar + 1 ) : -1 );
+        }   // split the names once, not for every record
+
+        return( true );
+    }   // end of Header()
+
+    template <class T> static T Get( const std::string& _r, const size_t _o )
+    {
+        T v; ::memcpy( &v, _r.data() + _o, sizeof( T ) ); return( v );
+    }   // little endian field at the offset; fields are not aligned
+
+    static double Sanger( const std::string& _r, const size_t _o, const int32_t _n )
+    {
+        double s = 0.0;
+
+        if ( ( _n < 2 ) || ( static_cast<unsigned char>( _r[ _o ] ) == 0xff ) )
+        {
+            return( 0.0 );
+        }   // no base qualities
+
+        for ( int32_t i = 0; i < _n; ++i )
+        {
+            s += static_cast<unsigned char>( _r[ _o + i ] );
+        }   // accumulate the score
+
+        return( s / _n );
+    }   // end of Sanger()
+
+    /*
+     * optional tags: name (2 bytes), type and value; a value of type B is an
+     * array of the subtype, preceded by the number of elements
+    */
+    static unsigned int ExMD( const std::string& _r, size_t _o )
+    {
+        const char* p = _r.data();
+        const char* nul;
+        unsigned int m = 0, size;
+
+        while ( _o + 3 < _r.size() )
+        {
+            const char type = p[ _o + 2 ];
+            const bool md = ( p[ _o ] == 'M' ) && ( p[ _o + 1 ] == 'D' );
+            _o += 3;
+
+            switch ( type )
+            {
+                case 'A': case 'c': case 'C': _o += 1; break;
+                case 's': case 'S': _o += 2; break;
+                case 'i': case 'I': case 'f': _o += 4; break;
+                case 'Z': case 'H':
+                    if ( !( nul = static_cast<const char*>( ::memchr( p + _o, 0, _r.size() - _o ) ) ) )
+                    {
+                        return( m );
+                    }   // unterminated string
+
+                    for ( ; md && ( p + _o < nul ); ++_o )
+                    {
+                        m += ::isalpha( p[ _o ] ) ? 1 : 0;
+                    }   // accumulate the number of mismatches
+
+                    _o = nul - p + 1; break;
+                case 'B':
+                    if ( _o + 5 > _r.size() )
+                    {
+                        return( m );
+                    }   // truncated array
+
+                    size = ( ::strchr( "cC", p[ _o ] ) ) ? 1 : ( ( ::strchr( "sS", p[ _o ] ) ) ? 2 : 4 );
+                    _o += 5 + size * Get<uint32_t>( _r, _o + 1 ); break;
+                default:
+                    return( m );
+            }   // skip the value
+        }   // walk through the tags
+
+        return( m );
+    }   // end of ExMD()
+};  // end of class BamSource
+
+class BlastSource
+{
+public:
+    BlastSource(
+        const SamFile& _p,          // parser of the records
+        const std::string& _f ) :   // name of alignment file; "-" is the standard input
+        mParser( _p ), mFile( _f )
+    {
+    }   // default constructor
+
+    bool IsOpen() const
+    {
+        return( mFile.IsOpen() );
+    }   // end of IsOpen()
+
+    bool Next( std::string& _r )
+    {
+        return( mFile.GetLine( _r ) );
+    }   // end of Next()
+
+    bool IsGroup( const std::string& _g, const std::string& _r ) const
+    {
+        return( mParser.IsGroup( _g, _r.c_str() ) );
+    }   // blast reports the hits of a query consecutively
+
+    unsigned int GetFlag( const std::string& ) const
+    {
+        return( 0 );
+    }   // single segment; mate-aware mode does not apply
+
+    /*
+     * blast has neither base qualities nor a mapping quality; the read
+     * quality is 0, the same as a sam record without qualities, and the
+     * mapping quality 255, i.e., not available. the alignment length counts
+     * the gaps, and the gaps are the number of gap openings
+    */
+    bool Parse(
+        const std::map<unsigned int, stTABLE>& _t,  // translation table
+        const std::string& _r,                      // alignment record
+        stSAM& _s,                                  // parsed record
+        unsigned int& _w ) const                    // reason the record is rejected
+    {
+        const char* field[ 12 ];
+        const char* p = _r.c_str();
+        unsigned int n = 1, start, end;
+        std::map<unsigned int, stTABLE>::const_iterator k;
+
+        for ( field[ 0 ] = p; *p && ( n < 12 ); ++p )
+        {
+            if ( *p == '\t' )
+            {
+                field[ n++ ] = p + 1;
+            }   // start of the next field
+        }   // positions of the fields
+
+        if ( ( n < 12 ) || ( *field[ 0 ] == '#' ) )
+        {
+            _w = nREJECT_FIELD; return( false );
+        }   // comment lines of -outfmt 7 and truncated records
+
+        _s.flag = 0;
+
+        if ( !( p = GetGID( field[ 1 ], field[ 2 ] - 1 ) ) )
+        {
+            _w = nREJECT_REFERENCE; return( false );
+        }   // subject id does not carry the ncbi gid
+
+        _s.gid = static_cast<unsigned int>( ::atoi( p ) );
+
+        if ( ( k = _t.find( _s.gid ) ) == _t.end() )
+        {
+            _w = nREJECT_TABLE; return( false );
+        }   // for whatever the reason, gid is not in the table
+
+        if ( mParser.mPanel && !( mParser.mPanel )->Has( _s.gid ) )
+        {
+            _w = nREJECT_PANEL; return( false );
+        }   // genome is not on the panel
+
+        start = static_cast<unsigned int>( ::atoi( field[ 8 ] ) );
+        end = static_cast<unsigned int>( ::atoi( field[ 9 ] ) );
+
+        _s.qname.assign( field[ 0 ], field[ 1 ] - 1 );  // query template name
+        _s.alen = static_cast<unsigned int>( ::atoi( field[ 3 ] ) );
+        _s.phred = 0.0;
+        _s.off = static_cast<unsigned int>( ::atoi( field[ 4 ] ) );
+        _s.gap = static_cast<unsigned int>( ::atoi( field[ 5 ] ) );
+        _s.tid = ( k->second ).tid;
+        _s.pos = ( start < end ) ? start : end;
+        _s.site = mParser.SetBin( _s.pos ) + ( k->second ).start;
+        _s.mapq = 255;
+        _s.ratio = 0.01 * ::atof( field[ 2 ] );
+        _s.span = _s.alen;
+        _s.hit = static_cast<unsigned int>( ::lrint( _s.ratio * _s.span ) );
+        _s.mate = _s.site; _s.segment = 1;
+
+        return( true );
+    }   // end of Parse()
+
+private:
+    const SamFile& mParser;
+    Reader mFile;
+
+    /*
+     * digits of the gid in the subject id: the field after the first bar,
+     * or the whole id if it is a number; NULL if there is none
+    */
+    static const char* GetGID( const char* _b, const char* _e )
+    {
+        const char* bar = static_cast<const char*>( ::memchr( _b, '|', _e - _b ) );
+        const char* p = ( bar ) ? bar + 1 : _b;
+
+        return( ( ( p < _e ) && ::isdigit( *p ) ) ? p : NULL );
+    }   // end of GetGID()
+};  // end of class BlastSource
+
+#endif  // _SOURCE_H
@@ -13,33 +13,80 @@
  * revised on April 17, 2013
 */
 
+#include <token.h>
+#include <reader.h>
 #include <species.h>
 
 #include <cstdio>
 #include <cstdlib>
-#include <fstream>
+#include <cstring>
 #include <boost/algorithm/string.hpp>
 
+/*
+ * estimated number of bytes used by an assignment
+*/
+static const unsigned int nMaxENTRY = 136;
+
 Species::Species(
     const std::map<unsigned int, stTABLE>& _t,
-    const std::map<unsigned int, double>& _w )
+    const std::map<unsigned int, double>& _w ) : mAssign( Codec::Order( &mCodec ) )
 {
-    const double nMIN = 0.15;
     std::map<unsigned int, stTABLE> t = _t;
-    std::map<unsigned int, double> w = _w;
-    std::string sid;
-    mTaxon.clear(); mIndex.clear();
+    mTaxon.clear(); mIndex.clear(); mWeight = _w;
+    mSpill = NULL; mBudget = 0; mMemory = 0; mReport = NULL; mNuma = NULL; mLineage = NULL;
+    mReader = NULL; mScheduler = NULL; mTurn = 0;
+    mMinIndex = 0.15; mMinIdentity = 85.0;
+    mReplicate = 0; mLevel = 0.95; mSeed = 0;
 
     for ( std::map<unsigned int, stTABLE>::iterator i = t.begin(); !( i == t.end() ); ++i )
     {
         mTaxon[ ( ( *i ).second ).tid ] = ( ( *i ).second ).species;
     }   // iterate through the records
 
-    for ( std::map<unsigned int, double>::iterator j = w.begin(); !( j == w.end() ); ++j )
+    t.clear(); Index();
+}   // end of copy constructor
+
+Species::~Species()
+{
+    mTaxon.clear(); mIndex.clear(); delete mSpill;
+}   // default destructor; environmentally conscientious
+
+/*
+ * limit the memory used by the read assignments
+ * candidates are spilled to temporary files in the given directory
+*/
+void Species::SetMemory(
+    const size_t _b,            // memory budget in bytes; 0 is unlimited
+    const std::string& _p )     // directory of the temporary files
+{
+    mBudget = _b; mPath = _p;
+}   // end of SetMemory()
+
+/*
+ * minimum weighted shannon index of a species and minimum percent identity
+ * of a candidate assignment
+*/
+void Species::SetThreshold(
+    const double _w,            // minimum weighted shannon index
+    const double _i )           // minimum percent identity
+{
+    mMinIndex = _w; mMinIdentity = _i; Index();
+}   // end of SetThreshold()
+
+/*
+ * record the weighted shannon index on the species level
+ * the best index of the strains counts for the species
+*/
+void Species::Index()
+{
+    std::string sid;
+    mIndex.clear();
+
+    for ( std::map<unsigned int, double>::iterator j = mWeight.begin(); !( j == mWeight.end() ); ++j )
     {
         sid = mTaxon.find( ( *j ).first )->second;
 
-        if ( ( *j ).second < nMIN )
+        if ( ( *j ).second < mMinIndex )
         {
             continue;
         }   // eliminate histogram with low index
@@ -47,53 +94,198 @@ Species::Species(
         mIndex[ sid ] = ( mIndex.find( sid ) == mIndex.end() ) ?
             ( *j ).second : std::max( mIndex.find( sid )->second, ( *j ).second );
     }   // record the weighted shannon index on the species level
+}   // end of Index()
 
-    t.clear(); w.clear();
-}   // end of copy constructor
+/*
+ * export the weighted shannon index on the species level; the reads are not
+ * needed, so the file may be written from the saved histograms alone
+*/
+bool Species::WriteIndex( const std::string& _f )
+{
+    FILE* of = ::fopen( _f.c_str(), "w" );
 
-Species::~Species()
+    ::fprintf( of, "%s,%s\n", "Taxon", "WSEI" );
+
+    for ( std::map<std::string, double>::iterator i = mIndex.begin(); !( i == mIndex.end() ); ++i )
+    {
+        ::fprintf( of, "%s,%.2f\n", ( ( *i ).first ).c_str(), ( *i ).second );
+    }   // every species with an index
+
+    return( static_cast<bool>( ::fclose( of ) ) );
+}   // end of WriteIndex()
+
+/*
+ * confidence intervals of the abundances from bootstrap replicates of the
+ * reads; see bootstrap.h
+*/
+void Species::SetBootstrap(
+    const unsigned int _b,      // number of replicates; 0 disables
+    const double _c,            // confidence level
+    const uint64_t _s )         // seed of the replicates
 {
-    mTaxon.clear(); mIndex.clear();
-}   // default destructor; environmentally conscientious
+    mReplicate = _b; mLevel = _c; mSeed = _s;
+}   // end of SetBootstrap()
+
+/*
+ * bootstrap replicates of the abundance and the proportion of every species
+ *
+ * a read is assigned to one species only, so a species with n reads counts
+ * a poisson number of reads with mean n in a replicate; the replicates run
+ * in parallel, each with its own random number stream
+*/
+void Species::Bootstrap(
+    std::map<std::string, stBOUND>& _c,         // intervals of the abundance
+    std::map<std::string, stBOUND>& _p ) const  // intervals of the proportion
+{
+    std::vector<const std::string*> sid;
+    std::vector<double> reads, count, ratio, column;
+
+    for ( std::map<std::string, stPIVOT>::const_iterator i = mPivot.begin(); !( i == mPivot.end() ); ++i )
+    {
+        sid.push_back( &( *i ).first ); reads.push_back( ( ( ( *i ).second ).site ).size() );
+    }   // species in a fixed order
+
+    const unsigned int n = sid.size();
+    count.resize( mReplicate * n ); ratio.resize( mReplicate * n ); _c.clear(); _p.clear();
+
+    #pragma omp parallel for schedule( static )
+    for ( int b = 0; b < static_cast<int>( mReplicate ); ++b )
+    {
+        Random r = Replicate( mSeed, b );
+        double total = 0.0;
+
+        for ( unsigned int g = 0; g < n; ++g )
+        {
+            total += ( count[ b * n + g ] = r.Poisson( reads[ g ] ) );
+        }   // resample the reads of every species
+
+        for ( unsigned int g = 0; g < n; ++g )
+        {
+            ratio[ b * n + g ] = ( total > 0.0 ) ? count[ b * n + g ] / total : 0.0;
+        }   // proportions of the replicate
+    }   // every replicate
+
+    column.resize( mReplicate );
+
+    for ( unsigned int g = 0; g < n; ++g )
+    {
+        for ( unsigned int b = 0; b < mReplicate; ++b )
+        {
+            column[ b ] = count[ b * n + g ];
+        }   // abundance of the replicates
+
+        _c[ *sid[ g ] ] = Bound( column, mLevel );
+
+        for ( unsigned int b = 0; b < mReplicate; ++b )
+        {
+            column[ b ] = ratio[ b * n + g ];
+        }   // proportion of the replicates
+
+        _p[ *sid[ g ] ] = Bound( column, mLevel );
+    }   // intervals of every species
+}   // end of Bootstrap()
+
+/*
+ * attach the instrumentation; NULL detaches it
+*/
+void Species::SetReport(
+    Report* _r )
+{
+    mReport = _r;
+}   // end of SetReport()
+
+/*
+ * pin the threads to the numa nodes; NULL detaches it
+*/
+void Species::SetNuma(
+    const Numa* _n )
+{
+    mNuma = _n;
+}   // end of SetNuma()
+
+/*
+ * also write the pivot tables of the higher ranks; NULL detaches it
+*/
+void Species::SetLineage(
+    const Lineage* _l )
+{
+    mLineage = _l;
+}   // end of SetLineage()
+
+/*
+ * export the pivot tables of the higher ranks, e.g., sample.genus.pivot.csv
+ * for the base name sample; the aggregates of the species are rolled up once
+ * for all ranks
+*/
+bool Species::WriteRank( const std::string& _b )
+{
+    std::vector<stROLLUP> rollup;
+    std::string file;
+    bool done = true;
+
+    if ( !mLineage || !mLineage->GetSize() )
+    {
+        return( true );
+    }   // only the species level
+
+    mLineage->Rollup( mPivot, rollup );
+
+    for ( unsigned int i = 0; i < mLineage->GetSize(); ++i )
+    {
+        file = _b + "." + mLineage->GetRank( i ) + ".pivot.csv";
+        done = mLineage->Write( file, i, rollup ) && done;
+        mCount.written += Report::GetSize( file );
+    }   // every rank asked for
+
+    return( done );
+}   // end of WriteRank()
 
 bool Species::Run( const std::string& _f )
 {
     const char* szDELIMIT = ".\n";
     std::string file;
     std::vector<std::string> field;
-    mAssign.clear();
+    Codec codec;
+    mAssign.clear(); mPivot.clear(); mMemory = 0; mCount = stCOUNT(); mCodec.swap( codec );
 
     boost::algorithm::split(                // splite the entire string
         field, _f, boost::algorithm::is_any_of( szDELIMIT ) );
 
+    if ( mReport )
+    {
+        mReport->Begin( "species", _f );
+    }   // instrumentation of the stage
+
     Assign( _f );
-    file = field[ 0 ] + ".pivot.csv"; Output( file );
     file = field[ 0 ] + ".assign.csv"; Profile( file );
-    mAssign.clear();
+    mCount.written = Report::GetSize( file );
+    file = field[ 0 ] + ".pivot.csv"; Output( file );
+    mCount.written += Report::GetSize( file ); WriteRank( field[ 0 ] );
+    file = field[ 0 ] + ".wsei.csv"; WriteIndex( file );
+    mCount.written += Report::GetSize( file );
+    PivotMap( Codec::Order( &mCodec ) ).swap( mAssign ); mPivot.clear();
+
+    if ( mReport )
+    {
+        mReport->End( mCount );
+    }   // complete the stage
+
+    delete mSpill; mSpill = NULL;
 
     return( true );
 }   // end of Run()
 
 /*
- * determine which potential assignment is better
- * histograms have been trimmed to remove taxons that are not actually
- * present in the community
+ * test if the new candidate replaces the current assignment
  *
  * 1. assign to taxon if percent identity is higher
  * 2. use shannon index to resolve conflict if ncecessary
- *
- * revised on April 23, 2013
 */
-bool Species::Assign(
-    const std::string& _r,      // read identification
+bool Species::Better(
+    const stPIVOT& _a,          // current assignment
     const stPIVOT& _p )         // potential assignment
 {
-    if ( mAssign.find( _r ) == mAssign.end() )
-    {
-        mAssign[ _r ] = _p; return( true );
-    }   // new record has arrived
-
-    unsigned int d1 = mAssign[ _r ].length - mAssign[ _r ].odd;
+    unsigned int d1 = _a.length - _a.odd;
     unsigned int d2 = _p.length - _p.odd;
 
     if ( d1 > d2 )
@@ -101,148 +293,415 @@ bool Species::Assign(
         return( false );
     }   // new assignment is better
 
-    std::string s1 = mTaxon.find( mAssign[ _r ].tid )->second;
-    std::string s2 = mTaxon.find( _p.tid )->second;
+    const std::string& s1 = mTaxon.find( _a.tid )->second;
+    const std::string& s2 = mTaxon.find( _p.tid )->second;
 
     if ( mIndex[ s1 ] > mIndex[ s2 ] )
     {
         return( false );
     }   // original shannon index is higher
 
-    mAssign[ _r ] = _p; return( true );
+    return( true );
+}   // end of Better()
+
+/*
+ * resolve the candidates kept in the order of the file, with the same rules
+ * as Assign(); the best candidate of every read is the number of candidates
+ * if none of them is retained
+*/
+void Species::Resolve(
+    const std::vector<unsigned int>& _o,    // read of each candidate
+    const std::vector<stPIVOT>& _c,         // candidates in the order of the file
+    std::vector<size_t>& _b )               // best candidate of each read
+{
+    const size_t none = _c.size();
+
+    for ( size_t i = 0; i < _c.size(); ++i )
+    {
+        const stPIVOT& p = _c[ i ];
+        size_t& b = _b[ _o[ i ] ];
+
+        if ( ( p.ratio < mMinIdentity ) ||
+            ( mIndex.find( mTaxon.find( p.tid )->second ) == mIndex.end() ) )
+        {
+            continue;
+        }   // candidate is not retained with these thresholds
+
+        if ( ( b == none ) || Better( _c[ b ], p ) )
+        {
+            b = i;
+        }   // resolve the conflict
+    }   // candidates arrive in the order of the file
+}   // end of Resolve()
+
+/*
+ * determine which potential assignment is better
+ * histograms have been trimmed to remove taxons that are not actually
+ * present in the community
+ *
+ * 1. assign to taxon if percent identity is higher
+ * 2. use shannon index to resolve conflict if ncecessary
+ *
+ * once the assignments exceed the memory budget, they are written as the
+ * first run and all further candidates are spilled as they arrive; the
+ * conflicts are then resolved while the runs are merged
+ *
+ * revised on April 23, 2013
+*/
+bool Species::Assign(
+    const uint64_t _r,          // key of read identification
+    const stPIVOT& _p )         // potential assignment
+{
+    PivotMap::iterator i;
+
+    if ( mSpill )
+    {
+        mSpill->Push( _r, _p );
+        return( ( mSpill->GetSize() > mBudget ) ? mSpill->Flush() : true );
+    }   // candidates are resolved after all of them have arrived
+
+    if ( !( ( i = mAssign.find( _r ) ) == mAssign.end() ) )
+    {
+        if ( !Better( ( *i ).second, _p ) )
+        {
+            return( false );
+        }   // keep the current assignment
+
+        ( *i ).second = _p; return( true );
+    }   // resolve the conflict
+
+    mAssign[ _r ] = _p; mMemory += nMaxENTRY;
+
+    if ( ( mBudget > 0 ) && ( mMemory > mBudget ) )
+    {
+        mSpill = new Spill( mPath, &mCodec ); mSpill->Dump( mAssign );
+        PivotMap( Codec::Order( &mCodec ) ).swap( mAssign ); mMemory = 0;
+    }   // memory budget exceeded; switch to external storage
+
+    return( true );
 }   // end of Assign()
 
 /*
  * species level assignment
  * summarize the alignment file and generate the output
+ *
+ * the summary is read by a chain of tasks, one block at a time: the task of
+ * a block submits the task that parses it, followed by the task that
+ * assigns its candidates, and the task of the next block. with the workers
+ * placed on numa nodes, every block is copied to storage of the worker
+ * before it is parsed. the candidates of a block that is parsed before
+ * those of the blocks ahead of it wait in a reorder buffer, so the
+ * candidates are assigned in the order of the file, whatever the timing of
+ * the workers; ties are resolved the same way by every run
 */
 bool Species::Assign( const std::string& _f )
 {
-    const double min = 85.0;
-    const char* szDELIMIT = ",\t\n";
-    const unsigned int nMaxBUFFER = 2048;
-    char header[ nMaxBUFFER ];
+    std::string header;
 
-    std::ifstream ifs( _f.c_str(), std::ios::in );
+    Reader ifs( _f );
 
-    if ( ifs.fail() )
+    if ( !ifs.IsOpen() )
     {
         return( false );
     }   // check the state of stream
 
-    ifs.getline( header, nMaxBUFFER );  // skip the header
+    ifs.GetLine( header );  // skip the header
+    mCount.bytes = header.size() + 1;
+
+    Scheduler s; s.SetNuma( mNuma );
+
+    mReader = &ifs; mScheduler = &s; mTurn = 0; mWorker.assign( ::omp_get_max_threads(), stWORKER() );
+    mStep.push_back( Call<Species>( this, &Species::Feed, 0 ) ); s.Submit( &mStep.back() );
+
+    s.Run();
 
-    #pragma omp parallel
+    for ( unsigned int i = 0; i < mWorker.size(); ++i )
     {
-        char buffer[ nMaxBUFFER ];
-        std::vector<std::string> field;
-        std::string rid;
-        stPIVOT set; bool run = false;
+        if ( mNuma && mReport && ( mWorker[ i ].mine.records > 0.0 ) )
+        {
+            mReport->Node( mWorker[ i ].node, mWorker[ i ].mine );
+        }   // throughput of the numa node
+
+        mCount += mWorker[ i ].count;
+    }   // counters of every worker
+
+    mStep.clear(); mText.clear(); mBatch.clear(); mWorker.clear();
+    mReader = NULL; mScheduler = NULL;
+
+    return( true );
+}   // end of Assign()
+
+/*
+ * task: take the next block of the summary; the block is parsed by a task
+ * of its own, and the next block is taken by another task. only one of
+ * these tasks runs at a time, so the reader is not locked.
+*/
+void Species::Feed(
+    const unsigned int _b )     // number of the block
+{
+    Call<Species>* scan = NULL;
+    Call<Species>* turn = NULL;
+    Call<Species>* next = NULL;
+    std::string block;
 
-        do
+    if ( !mReader->Next( block ) )
+    {
+        return;
+    }   // no more data to process
+
+    #pragma omp critical
+    {
+        mText.push_back( std::string() ); ( mText.back() ).swap( block );
+        mStep.push_back( Call<Species>( this, &Species::Scan, _b ) ); scan = &mStep.back();
+        mStep.push_back( Call<Species>( this, &Species::Turn, _b ) ); turn = &mStep.back();
+        mStep.push_back( Call<Species>( this, &Species::Feed, _b + 1 ) ); next = &mStep.back();
+    }   // the critical region
+
+    scan->Then( turn ); mScheduler->Submit( turn );
+    mScheduler->Submit( next ); mScheduler->Submit( scan );     // the worker parses the block next
+}   // end of Feed()
+
+/*
+ * task: parse the candidates of a block of the summary; they wait in the
+ * reorder buffer for their turn
+*/
+void Species::Scan(
+    const unsigned int _b )     // number of the block
+{
+    const char* szDELIMIT = ",\t\n";
+    stWORKER& w = mWorker[ ::omp_get_thread_num() ];
+    std::string block;                  // lines of the block
+    std::string chunk;                  // copy of the block on the node of the worker
+    char* buffer = NULL; char* next = NULL; char* end = NULL;
+    std::vector<const char*> field;
+    std::map<unsigned int, std::string>::const_iterator k;
+    std::vector<std::string> rid;       // candidates of the block
+    std::vector<stPIVOT> set;
+    unsigned int size = 0;              // number of candidates in use
+    double lines = 0.0;
+    double wait = ( mReport ) ? Report::Clock() : 0.0;
+
+    rid.swap( ( w.spare ).rid ); set.swap( ( w.spare ).set );
+
+    #pragma omp critical
+    {
+        block.swap( mText[ _b ] );
+    }   // the critical region
+
+    w.count.wait += ( mReport ) ? Report::Clock() - wait : 0.0;
+
+    if ( mNuma )
+    {
+        chunk.assign( block ); w.node = mNuma->GetNode();
+    }   // the storage of the worker was first touched on its node
+
+    next = ( mNuma ) ? &chunk[ 0 ] : &block[ 0 ]; end = next + block.size();
+
+    while ( next < end )
+    {
+        buffer = next; lines += 1.0;    // every block ends with a newline
+        next = static_cast<char*>( ::memchr( buffer, '\n', end - buffer ) );
+        *next++ = '\0';
+
+        if ( !( size < rid.size() ) )
         {
-            #pragma omp critical
-            {
-                run = ifs.getline( buffer, nMaxBUFFER );
-            }   // the critical region
+            rid.push_back( std::string() ); set.push_back( stPIVOT() );
+        }   // storage of the candidates is reused between blocks
 
-            if ( !run )
-            {
-                continue;
-            }   // no more data to process
+        if ( Tokenize( buffer, szDELIMIT, field ) < 11 )
+        {
+            w.count.reject[ nREJECT_FIELD ] += 1.0; continue;
+        }   // truncated records
 
-            boost::algorithm::split(                // splite the entire string
-                field, buffer, boost::algorithm::is_any_of( szDELIMIT ) );
-            set.tid = static_cast<unsigned int>( ::atoi( field[ 10 ].c_str() ) );   // ncbi tid
+        set[ size ].tid = static_cast<unsigned int>( ::atoi( field[ 10 ] ) );   // ncbi tid
 
-            if ( mIndex.find( mTaxon[ set.tid ] ) == mIndex.end() )
-            {
-                continue;
-            }   // histogram not aviable for assignment
+        if ( ( ( k = mTaxon.find( set[ size ].tid ) ) == mTaxon.end() ) ||
+            ( mIndex.find( ( *k ).second ) == mIndex.end() ) )
+        {
+            w.count.reject[ nREJECT_INDEX ] += 1.0; continue;
+        }   // histogram not aviable for assignment
 
-            rid = field[ 0 ]; ( set.site ).clear();
-            set.ratio = static_cast<double>( ::atof( field[ 1 ].c_str() ) );        // percent identity
+        stPIVOT& pivot = set[ size ];
+        pivot.ratio = static_cast<double>( ::atof( field[ 1 ] ) );      // percent identity
 
-            if ( set.ratio < min )
-            {
-                continue;
-            }   // only process good alignment
+        if ( pivot.ratio < mMinIdentity )
+        {
+            w.count.reject[ nREJECT_IDENTITY ] += 1.0; continue;
+        }   // only process good alignment
 
-            set.length = static_cast<unsigned int>( ::atoi( field[ 2 ].c_str() ) ); // alignment length
-            set.odd = static_cast<unsigned int>( ::atoi( field[ 3 ].c_str() ) );    // mismatches
-            set.gap = static_cast<unsigned int>( ::atoi( field[ 4 ].c_str() ) );    // gaps
-            set.phred = static_cast<double>( ::atof( field[ 5 ].c_str() ) );        // read quality
-            set.score = static_cast<unsigned int>( ::atoi( field[ 6 ].c_str() ) );  // map quality
-            ( set.site ).push_back( set.tid );      // accumulate the count
+        rid[ size ].assign( field[ 0 ] ); ( pivot.site ).clear();
+        pivot.length = static_cast<unsigned int>( ::atoi( field[ 2 ] ) );   // alignment length
+        pivot.odd = static_cast<unsigned int>( ::atoi( field[ 3 ] ) );      // mismatches
+        pivot.gap = static_cast<unsigned int>( ::atoi( field[ 4 ] ) );      // gaps
+        pivot.phred = static_cast<double>( ::atof( field[ 5 ] ) );          // read quality
+        pivot.score = static_cast<unsigned int>( ::atoi( field[ 6 ] ) );    // map quality
+        ++size;     // assigned in the turn of the block
+    }   // every line of the block
+
+    w.mine.records += lines; w.mine.bytes += block.size();
+
+    #pragma omp critical
+    {
+        stBATCH& b = mBatch[ _b ];
+        ( b.rid ).swap( rid ); ( b.set ).swap( set ); b.size = size;
+        mCount.records += lines; mCount.bytes += block.size();
 
-            #pragma omp critical
+        if ( mReport )
+        {
+            mReport->Progress( mCount );
+        }   // instrumentation of the reader
+    }   // the critical region
+}   // end of Scan()
+
+/*
+ * task: assign the candidates of the blocks whose predecessors are all
+ * assigned, in the order of the file; a block parsed ahead of its turn is
+ * assigned by the task of the block before it
+*/
+void Species::Turn(
+    const unsigned int )
+{
+    stWORKER& w = mWorker[ ::omp_get_thread_num() ];
+
+    #pragma omp critical
+    {
+        for ( std::map<long, stBATCH>::iterator i = mBatch.begin();
+            !( i == mBatch.end() ) && ( ( *i ).first == mTurn ); mBatch.erase( i++ ), ++mTurn )
+        {
+            stBATCH& b = ( *i ).second;
+
+            for ( unsigned int j = 0; j < b.size; ++j )
             {
-                Assign( rid, set );
-            }   // the critical region
-        } while ( run );    // merge the alignments
-    }   // end of the parallel section
+                Assign( mCodec.Encode( ( b.rid )[ j ] ), ( b.set )[ j ] );
+            }   // candidates of the block
 
-    ifs.close(); return( true );
-}   // end of Assign()
+            if ( ( ( w.spare ).rid ).empty() )
+            {
+                ( ( w.spare ).rid ).swap( b.rid ); ( ( w.spare ).set ).swap( b.set );
+            }   // the storage is reused by the worker
+        }   // the blocks whose predecessors are all assigned
+    }   // the critical region
+}   // end of Turn()
 
 /*
  * export the assignment of individual read
+ * the assignments are summarized on the species level at the same time
 */
 bool Species::Profile( const std::string& _f)
 {
     FILE* of = ::fopen( _f.c_str(), "w" );
-    std::string taxon;
+    uint64_t rid = 0, next = 0;
+    std::string name;
+    stPIVOT best, set;
+    bool run;
 
     ::fprintf( of, "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s\n",       // header
         "Read ID", "Identity", "Alignment Length", "Mismatch", "Gap",
         "Read Quality", "Alignment Quality", "TID", "WSEI", "Taxon" );
 
-    for ( std::map<std::string, stPIVOT>::iterator i = mAssign.begin(); !( i == mAssign.end() ); ++i )
+    for ( PivotMap::iterator i = mAssign.begin(); !( i == mAssign.end() ); ++i )
+    {
+        mCodec.Decode( ( *i ).first, name ); Export( of, name, ( *i ).second );
+    }   // export the assignments held in memory
+
+    run = mSpill && mSpill->Open() && mSpill->Next( rid, best );
+
+    while ( run )
     {
-        taxon = mTaxon.find( ( ( *i ).second ).tid )->second;
-
-        ::fprintf( of, "%s,%.2f,%d,%d,%d,%.2f,%d,%d,%.2f,%s\n",
-            ( ( *i ).first ).c_str(),   // read identification
-            ( ( *i ).second ).ratio,    // average percent identity
-            ( ( *i ).second ).length,   // average alignment length
-            ( ( *i ).second ).odd,      // average number of mismatches
-            ( ( *i ).second ).gap,      // average number of gaps
-            ( ( *i ).second ).phred,    // average read quality
-            ( ( *i ).second ).score,    // average alignment quality
-            ( ( *i ).second ).tid,      // ncbi taxon identification
-            mIndex[ taxon ],            // weighted shannon index
-            taxon.c_str() );            // species name
-    }   // export the assignments
+        while ( ( run = mSpill->Next( next, set ) ) && ( next == rid ) )
+        {
+            if ( Better( best, set ) )
+            {
+                best = set;
+            }   // resolve the conflict
+        }   // candidates of the same read arrive in their original order
+
+        mCodec.Decode( rid, name ); Export( of, name, best ); rid = next; best = set;
+    }   // export the assignments held in temporary files
 
     return( static_cast<bool>( ::fclose( of ) ) );
-}   // end of Output()
+}   // end of Profile()
+
+/*
+ * export the assignment of a single read
+*/
+void Species::Export(
+    FILE* _f,
+    const std::string& _r,      // read identification
+    const stPIVOT& _p )         // assignment
+{
+    const std::string& taxon = mTaxon.find( _p.tid )->second;
+
+    ::fprintf( _f, "%s,%.2f,%d,%d,%d,%.2f,%d,%d,%.2f,%s\n",
+        _r.c_str(),             // read identification
+        _p.ratio,               // average percent identity
+        _p.length,              // average alignment length
+        _p.odd,                 // average number of mismatches
+        _p.gap,                 // average number of gaps
+        _p.phred,               // average read quality
+        _p.score,               // average alignment quality
+        _p.tid,                 // ncbi taxon identification
+        mIndex[ taxon ],        // weighted shannon index
+        taxon.c_str() );        // species name
+
+    Summarize( taxon, _p );
+}   // end of Export()
+
+/*
+ * summarize the assignment of a single read on the species level
+*/
+void Species::Summarize(
+    const std::string& _s,      // species name
+    const stPIVOT& _p )         // assignment
+{
+    std::map<std::string, stPIVOT>::iterator k = mPivot.find( _s );
+
+    if ( k == mPivot.end() )
+    {
+        k = mPivot.insert( std::make_pair( _s, _p ) ).first;
+    }   // the first read of the species
+    else
+    {
+        ( *k ).second += _p;
+    }   // summarize the assignments
+
+    ( ( ( *k ).second ).site ).push_back( _p.tid );     // a read counts once towards the abundance
+    mCount.output += 1.0;
+}   // end of Summarize()
 
 /*
  * export the contents; just-in-time implementation
+ * the assignments have been summarized by Profile()
 */
 bool Species::Output( const std::string& _f )
 {
     FILE* of = ::fopen( _f.c_str(), "w" );
 
-    std::map<std::string, stPIVOT> pivot; pivot.clear();
-    std::string sid; double count;
+    std::map<std::string, stPIVOT>& pivot = mPivot;
+    std::map<std::string, stBOUND> bound, share;
+    double count, total = 0.0;
 
-    for ( std::map<std::string, stPIVOT>::iterator i = mAssign.begin(); !( i == mAssign.end() ); ++i )
-    {
-        sid = mTaxon.find( ( ( *i ).second ).tid )->second;
-        ( pivot.find( sid ) == pivot.end() ) ?
-            pivot[ sid ] = ( *i ).second : pivot[ sid ] += ( *i ).second;
-    }   // summarize the assignments first
-
-    ::fprintf( of, "%s,%s,%s,%s,%s,%s,%s,%s\n",     // header
+    ::fprintf( of, "%s,%s,%s,%s,%s,%s,%s,%s",       // header
         "Taxon", "Abundance", "Identity", "Alignment Length",
         "Mismatch", "Gap", "Read Quality", "Alignment Quality" );
+    ::fprintf( of, ( mReplicate > 0 ) ? ",%s,%s,%s,%s,%s\n" : "\n",
+        "Abundance Low", "Abundance High", "Proportion", "Proportion Low", "Proportion High" );
+
+    if ( mReplicate > 0 )
+    {
+        Bootstrap( bound, share );
+
+        for ( std::map<std::string, stPIVOT>::iterator j = pivot.begin(); !( j == pivot.end() ); ++j )
+        {
+            total += ( ( ( *j ).second ).site ).size();
+        }   // number of assigned reads
+    }   // confidence intervals of the abundances
 
     for ( std::map<std::string, stPIVOT>::iterator j = pivot.begin(); !( j == pivot.end() ); ++j )
     {
         count = static_cast<double>( ( ( ( *j ).second ).site ).size() );
 
-        ::fprintf( of, "%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+        ::fprintf( of, "%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f",
             ( ( *j ).first ).c_str(),           // taxon
             static_cast<unsigned int>( ( ( ( *j ).second ).site ).size() ), // abundance
             ( ( *j ).second ).ratio / count,    // average percent identity
@@ -251,6 +710,15 @@ bool Species::Output( const std::string& _f )
             ( ( *j ).second ).gap / count,      // average number of gaps
             ( ( *j ).second ).phred / count,    // average read quality
             ( ( *j ).second ).score / count );  // average alignment quality
+
+        if ( mReplicate > 0 )
+        {
+            ::fprintf( of, ",%.0f,%.0f,%.4f,%.4f,%.4f",
+                bound[ ( *j ).first ].low, bound[ ( *j ).first ].high, count / total,
+                share[ ( *j ).first ].low, share[ ( *j ).first ].high );
+        }   // confidence intervals
+
+        ::fprintf( of, "\n" );
     }   // calcualte the weighted shannon index and export the contents
 
     return( static_cast<bool>( ::fclose( of ) ) );
@@ -10,6 +10,15 @@
  * Richmond, VA 23298
  *
  * revised on April 16, 2013
+ *
+ * the candidate assignments are written to temporary files once they exceed
+ * the memory budget; see spill.h
+ *
+ * reads are held as the keys of a codec, see codec.h; their names are only
+ * rebuilt when the assignments are exported
+ *
+ * the species aggregates may be rolled up to the higher ranks of the
+ * lineage, see lineage.h; sample.genus.pivot.csv and so on
 */
 
 #ifndef _SPECIES_H
@@ -17,8 +26,17 @@
 
 #include <table.h>
 #include <pivot.h>
+#include <spill.h>
+#include <report.h>
+#include <bootstrap.h>
+#include <placement.h>
+#include <lineage.h>
+#include <reader.h>
+#include <task.h>
 
 #include <map>
+#include <deque>
+#include <vector>
 #include <string>
 
 class Species
@@ -30,16 +48,82 @@ public:
     ~Species();
 
     bool Run( const std::string& );
+    void SetMemory( const size_t, const std::string& );
+    void SetThreshold( const double, const double );
+    bool WriteIndex( const std::string& );
+    void SetBootstrap( const unsigned int, const double, const uint64_t );
+    void SetReport( Report* );
+    void SetNuma( const Numa* );
+    void SetLineage( const Lineage* );
+    bool WriteRank( const std::string& );
 
 private:
     std::map<std::string, double> mIndex;
-    std::map<std::string, stPIVOT> mAssign;
+    std::map<unsigned int, double> mWeight; // weighted shannon index of the taxa
+    double mMinIndex;       // minimum weighted shannon index of a species
+    double mMinIdentity;    // minimum percent identity of a candidate
+    Codec mCodec;                           // keys of the read identifications
+    PivotMap mAssign;                       // candidates of the reads
+    std::map<std::string, stPIVOT> mPivot;
     std::map<unsigned int, std::string> mTaxon;
 
+    Spill* mSpill;          // external storage of the candidates
+    std::string mPath;      // directory of the temporary files
+    size_t mBudget;         // memory budget in bytes; 0 is unlimited
+    size_t mMemory;         // estimated memory used by the assignments
+    Report* mReport;        // instrumentation; NULL if not attached
+    const Numa* mNuma;      // placement of the threads; NULL if not attached
+    const Lineage* mLineage;    // ranks above the species; NULL if not attached
+    stCOUNT mCount;         // counters of the stage
+    unsigned int mReplicate;    // number of bootstrap replicates; 0 disables
+    double mLevel;          // confidence level of the intervals
+    uint64_t mSeed;         // seed of the replicates
+
+    struct stBATCH
+    {
+        std::vector<std::string> rid;   // read identifications of the candidates
+        std::vector<stPIVOT> set;       // candidates of the block
+        unsigned int size;              // number of candidates in use
+    };  // candidates of a block that wait for the blocks before it
+
+    struct stWORKER
+    {
+        stWORKER()
+        {
+            node = 0;
+        }   // default constructor
+
+        stBATCH spare;          // storage of the candidates reused between blocks
+        stCOUNT count;          // counters of the worker
+        stCOUNT mine;           // records and bytes of the worker
+        unsigned int node;      // numa node of the worker
+    };  // a worker parsing the summary
+
+    Reader* mReader;                    // summary read by the tasks; NULL if not used
+    Scheduler* mScheduler;              // scheduler of the tasks of the summary
+    std::deque<Call<Species> > mStep;   // tasks of the blocks of the summary
+    std::deque<std::string> mText;      // blocks of the summary not parsed yet
+    std::map<long, stBATCH> mBatch;     // blocks parsed before their turn
+    long mTurn;                         // number of the next block to be assigned
+    std::vector<stWORKER> mWorker;      // counters of every worker
+
+    friend class Sweep;     // threshold sweep re-resolves the candidates
+    friend class Online;    // online assignment resolves the candidates at the end
+    friend class Delta;     // incremental assignment resolves the affected reads
+
+    void Index();
+    void Bootstrap( std::map<std::string, stBOUND>&, std::map<std::string, stBOUND>& ) const;
     bool Output( const std::string& );
     bool Profile( const std::string& );
     bool Assign( const std::string& );
-    bool Assign( const std::string&, const stPIVOT& );
+    bool Assign( const uint64_t, const stPIVOT& );
+    void Feed( const unsigned int );
+    void Scan( const unsigned int );
+    void Turn( const unsigned int );
+    bool Better( const stPIVOT&, const stPIVOT& );
+    void Resolve( const std::vector<unsigned int>&, const std::vector<stPIVOT>&, std::vector<size_t>& );
+    void Export( FILE*, const std::string&, const stPIVOT& );
+    void Summarize( const std::string&, const stPIVOT& );
 };  // end of class definition
 
 #endif  // _SPECIES_H
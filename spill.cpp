@@ -0,0 +1,344 @@
+/*
+ * spill.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * external memory storage of the candidate assignments
+*/
+
+#include <spill.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <algorithm>
+
+/*
+ * maximum number of runs that are merged at the same time
+ * estimated number of bytes used by a buffered candidate
+*/
+static const unsigned int nMaxOPEN = 64;
+static const unsigned int nMaxENTRY = 104;
+
+/*
+ * default constructor
+ * temporary files are created in the given directory
+*/
+Spill::Spill(
+    const std::string& _p,      // directory of the temporary files
+    const Codec* _c )           // codec of the read identifications
+{
+    mPath = _p; mOrder = Codec::Order( _c ); mRun.clear(); mBuffer.clear(); mHead.clear();
+    mHeap = NULL; mSize = 0;
+}   // default constructor
+
+Spill::~Spill()
+{
+    for ( unsigned int i = 0; i < mHead.size(); ++i )
+    {
+        if ( mHead[ i ].file )
+        {
+            ::fclose( mHead[ i ].file );
+        }   // the run has been opened
+    }   // close the runs being merged
+
+    for ( unsigned int i = 0; i < mRun.size(); ++i )
+    {
+        ::unlink( mRun[ i ].c_str() );
+    }   // remove the temporary files
+
+    delete mHeap; mRun.clear(); mBuffer.clear(); mHead.clear();
+}   // default destructor; environmentally conscientious
+
+/*
+ * buffer a candidate; the caller decides when the buffer is flushed
+*/
+bool Spill::Push(
+    const uint64_t _r,          // key of read identification
+    const stPIVOT& _p )         // candidate assignment
+{
+    mBuffer.push_back( std::pair<uint64_t, stPIVOT>( _r, _p ) );
+    mSize += nMaxENTRY;
+
+    return( true );
+}   // end of Push()
+
+/*
+ * write the resolved assignments as the first run; the map is already
+ * sorted by read identification
+*/
+bool Spill::Dump(
+    const PivotMap& _m )
+{
+    std::string name;
+    FILE* of = Create( name );
+
+    if ( of == NULL )
+    {
+        return( false );
+    }   // unable to create the temporary file
+
+    for ( PivotMap::const_iterator i = _m.begin(); !( i == _m.end() ); ++i )
+    {
+        Write( of, ( *i ).first, ( *i ).second );
+    }   // write the assignments
+
+    mRun.push_back( name ); return( ::fclose( of ) == 0 );
+}   // end of Dump()
+
+/*
+ * sort the buffer and write it as a new run
+ * stable sorting keeps the candidates of the same read in arrival order
+*/
+bool Spill::Flush()
+{
+    std::vector<unsigned int> order( mBuffer.size() );
+    std::string name;
+    FILE* of;
+
+    if ( mBuffer.empty() )
+    {
+        return( true );
+    }   // nothing to write
+
+    if ( ( of = Create( name ) ) == NULL )
+    {
+        return( false );
+    }   // unable to create the temporary file
+
+    for ( unsigned int i = 0; i < order.size(); ++i )
+    {
+        order[ i ] = i;
+    }   // sort the positions instead of the candidates
+
+    std::stable_sort( order.begin(), order.end(), SortRID( mBuffer, mOrder ) );
+
+    for ( unsigned int i = 0; i < order.size(); ++i )
+    {
+        Write( of, mBuffer[ order[ i ] ].first, mBuffer[ order[ i ] ].second );
+    }   // write the candidates
+
+    mBuffer.clear(); mSize = 0;
+    mRun.push_back( name ); return( ::fclose( of ) == 0 );
+}   // end of Flush()
+
+/*
+ * prepare the runs for merging
+ * groups of runs are merged into larger ones until the number of runs
+ * fits into the maximum number of open files
+*/
+bool Spill::Open()
+{
+    std::vector<std::string> run;
+    std::string name;
+    FILE* of;
+
+    if ( !Flush() )
+    {
+        return( false );
+    }   // remaining candidates become the last run
+
+    while ( mRun.size() > nMaxOPEN )
+    {
+        run.clear();
+
+        for ( unsigned int i = 0; i < mRun.size(); i += nMaxOPEN )
+        {
+            if ( ( of = Create( name ) ) == NULL )
+            {
+                return( false );
+            }   // unable to create the temporary file
+
+            run.push_back( name );
+
+            if ( !Merge( i, std::min<unsigned int>( i + nMaxOPEN, mRun.size() ), of ) )
+            {
+                ::fclose( of ); mRun.insert( mRun.end(), run.begin(), run.end() );
+                return( false );
+            }   // the temporary files are removed with the other runs
+
+            ::fclose( of );
+        }   // merge consecutive runs to keep the arrival order
+
+        for ( unsigned int i = 0; i < mRun.size(); ++i )
+        {
+            ::unlink( mRun[ i ].c_str() );
+        }   // remove the merged runs
+
+        mRun.swap( run );
+    }   // reduce the number of runs
+
+    mHead.resize( mRun.size() );
+    delete mHeap; mHeap = new stHEAP( SortRun( mHead, mOrder ) );
+
+    for ( unsigned int i = 0; i < mRun.size(); ++i )
+    {
+        if ( ( mHead[ i ].file = ::fopen( mRun[ i ].c_str(), "rb" ) ) == NULL )
+        {
+            return( false );
+        }   // unable to open the run
+
+        if ( Read( mHead[ i ].file, mHead[ i ].rid, mHead[ i ].set ) )
+        {
+            mHeap->push( i );
+        }   // the run is not empty
+    }   // open the runs
+
+    return( true );
+}   // end of Open()
+
+/*
+ * retrieve the next candidate in order of read identification
+*/
+bool Spill::Next(
+    uint64_t& _r,               // key of read identification
+    stPIVOT& _p )               // candidate assignment
+{
+    unsigned int k;
+
+    if ( ( mHeap == NULL ) || mHeap->empty() )
+    {
+        return( false );
+    }   // no more candidates
+
+    k = mHeap->top(); mHeap->pop();
+    _r = mHead[ k ].rid; _p = mHead[ k ].set;
+
+    if ( Read( mHead[ k ].file, mHead[ k ].rid, mHead[ k ].set ) )
+    {
+        mHeap->push( k );
+    }   // advance the run
+
+    return( true );
+}   // end of Next()
+
+/*
+ * number of bytes held by the buffer
+*/
+size_t Spill::GetSize() const
+{
+    return( mSize );
+}   // end of GetSize()
+
+/*
+ * number of runs written so far
+*/
+unsigned int Spill::GetRuns() const
+{
+    return( static_cast<unsigned int>( mRun.size() ) );
+}   // end of GetRuns()
+
+/*
+ * create a new temporary file
+*/
+FILE* Spill::Create(
+    std::string& _n ) const     // name of the file
+{
+    std::vector<char> name( mPath.begin(), mPath.end() );
+    const char* szTEMPLATE = "/mcat.XXXXXX";
+    int fd;
+
+    name.insert( name.end(), szTEMPLATE, szTEMPLATE + ::strlen( szTEMPLATE ) + 1 );
+
+    if ( ( fd = ::mkstemp( &name[ 0 ] ) ) < 0 )
+    {
+        return( NULL );
+    }   // unable to create the file
+
+    _n = &name[ 0 ]; return( ::fdopen( fd, "wb" ) );
+}   // end of Create()
+
+/*
+ * k-way merge of consecutive runs into a single run
+*/
+bool Spill::Merge(
+    const unsigned int _a,      // first run
+    const unsigned int _b,      // one past the last run
+    FILE* _f ) const            // merged run
+{
+    std::vector<stRUN> head( _b - _a );
+    stHEAP heap = stHEAP( SortRun( head, mOrder ) );
+    unsigned int k, open = 0;
+
+    for ( unsigned int i = 0; i < head.size(); ++i )
+    {
+        if ( ( head[ i ].file = ::fopen( mRun[ _a + i ].c_str(), "rb" ) ) == NULL )
+        {
+            break;
+        }   // unable to open the run
+
+        if ( ( ++open ) && Read( head[ i ].file, head[ i ].rid, head[ i ].set ) )
+        {
+            heap.push( i );
+        }   // the run is not empty
+    }   // open the runs
+
+    while ( ( open == head.size() ) && !heap.empty() )
+    {
+        k = heap.top(); heap.pop();
+        Write( _f, head[ k ].rid, head[ k ].set );
+
+        if ( Read( head[ k ].file, head[ k ].rid, head[ k ].set ) )
+        {
+            heap.push( k );
+        }   // advance the run
+    }   // merge the runs
+
+    for ( unsigned int i = 0; i < head.size(); ++i )
+    {
+        if ( head[ i ].file )
+        {
+            ::fclose( head[ i ].file );
+        }   // the run has been opened
+    }   // close the runs
+
+    return( open == head.size() );
+}   // end of Merge()
+
+/*
+ * read a candidate in binary form
+*/
+bool Spill::Read(
+    FILE* _f,
+    uint64_t& _r,               // key of read identification
+    stPIVOT& _p ) const         // candidate assignment
+{
+    unsigned int field[ 5 ];
+    double real[ 2 ];
+
+    if ( !( ::fread( &_r, sizeof( _r ), 1, _f ) == 1 ) ||
+        !( ::fread( field, sizeof( unsigned int ), 5, _f ) == 5 ) ||
+        !( ::fread( real, sizeof( double ), 2, _f ) == 2 ) )
+    {
+        return( false );
+    }   // end of the run
+    _p.tid = field[ 0 ]; _p.length = field[ 1 ]; _p.odd = field[ 2 ];
+    _p.gap = field[ 3 ]; _p.score = field[ 4 ];
+    _p.ratio = real[ 0 ]; _p.phred = real[ 1 ];
+    ( _p.site ).clear();    // a candidate carries no binding sites
+
+    return( true );
+}   // end of Read()
+
+/*
+ * write a candidate in binary form
+*/
+bool Spill::Write(
+    FILE* _f,
+    const uint64_t _r,          // key of read identification
+    const stPIVOT& _p ) const   // candidate assignment
+{
+    unsigned int field[ 5 ] = { _p.tid, _p.length, _p.odd, _p.gap, _p.score };
+    double real[ 2 ] = { _p.ratio, _p.phred };
+
+    ::fwrite( &_r, sizeof( _r ), 1, _f );
+    ::fwrite( field, sizeof( unsigned int ), 5, _f );
+
+    return( ::fwrite( real, sizeof( double ), 2, _f ) == 2 );
+}   // end of Write()
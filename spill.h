@@ -0,0 +1,123 @@
+/*
+ * spill.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * external memory storage of the candidate assignments
+ *
+ * candidates are buffered in memory and written as sorted runs to
+ * temporary files once the buffer exceeds its budget. runs are kept in the
+ * order they were written; candidates of the same read are returned by the
+ * merge in the order they arrived, so that the outcome of the assignment is
+ * identical to the in-memory implementation.
+ *
+ * each candidate is written in binary form:
+ * key of read identification (8 bytes, see codec.h), tid, alignment length,
+ * mismatches, gaps, alignment quality (4 bytes each), percent identity and
+ * read quality (8 bytes each). the keys are only meaningful together with
+ * the codec of the stage, which outlives the runs
+*/
+
+#ifndef _SPILL_H
+#define _SPILL_H
+
+#include <pivot.h>
+
+#include <map>
+#include <queue>
+#include <vector>
+#include <string>
+#include <cstdio>
+
+class Spill
+{
+public:
+    Spill( const std::string&, const Codec* );
+    ~Spill();
+
+    bool Push( const uint64_t, const stPIVOT& );
+    bool Dump( const PivotMap& );
+    bool Flush();
+    bool Open();
+    bool Next( uint64_t&, stPIVOT& );
+
+    size_t GetSize() const;
+    unsigned int GetRuns() const;
+
+private:
+    struct stRUN
+    {
+        stRUN() : file( NULL ), rid( 0 )
+        {
+        }   // default constructor
+
+        FILE* file;             // run file being merged
+        uint64_t rid;           // key of the current read identification
+        stPIVOT set;            // current candidate
+    };  // head of a run
+
+    /*
+     * sorting criteria for the heads of the runs; the priority queue returns
+     * the largest element first, hence the reversed comparison
+     * 1. read identification
+     * 2. order in which the runs were written
+    */
+    struct SortRun
+    {
+        SortRun( const std::vector<stRUN>& _r, const Codec::Order& _o ) : run( _r ), order( _o )
+        {
+        }   // default constructor
+
+        bool operator()( const unsigned int _a, const unsigned int _b ) const
+        {
+            return( ( run[ _a ].rid == run[ _b ].rid ) ? ( _a > _b ) :
+                order( run[ _b ].rid, run[ _a ].rid ) );
+        }   // end of operator overloading
+
+        const std::vector<stRUN>& run;
+        Codec::Order order;
+    };  // end of class SortRun
+
+    /*
+     * sorting criteria for the buffered candidates
+     * 1. read identification
+    */
+    struct SortRID
+    {
+        SortRID( const std::vector<std::pair<uint64_t, stPIVOT> >& _b, const Codec::Order& _o ) :
+            buffer( _b ), order( _o )
+        {
+        }   // default constructor
+
+        bool operator()( const unsigned int _a, const unsigned int _b ) const
+        {
+            return( order( buffer[ _a ].first, buffer[ _b ].first ) );
+        }   // end of operator overloading
+
+        const std::vector<std::pair<uint64_t, stPIVOT> >& buffer;
+        Codec::Order order;
+    };  // end of class SortRID
+
+    typedef std::priority_queue<unsigned int, std::vector<unsigned int>, SortRun> stHEAP;
+
+    std::string mPath;                  // temporary directory
+    std::vector<std::string> mRun;      // run files in the order written
+    std::vector<std::pair<uint64_t, stPIVOT> > mBuffer;
+    Codec::Order mOrder;                // ordering of the keys as their names
+    std::vector<stRUN> mHead;           // heads of the runs being merged
+    stHEAP* mHeap;                      // runs ordered by their heads
+    size_t mSize;                       // bytes held by the buffer
+
+    FILE* Create( std::string& ) const;
+    bool Merge( const unsigned int, const unsigned int, FILE* ) const;
+    bool Read( FILE*, uint64_t&, stPIVOT& ) const;
+    bool Write( FILE*, const uint64_t, const stPIVOT& ) const;
+};  // end of class definition
+
+#endif  // _SPILL_H
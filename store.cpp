@@ -0,0 +1,380 @@
+/*
+ * store.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * summary partitioned by taxon
+*/
+
+#include <omp.h>
+#include <hash.h>
+#include <store.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <sys/stat.h>
+
+/*
+ * identification and version of the index
+ * size of a block before it is compressed
+*/
+static const char* szMAGIC = "MCATSTOR";
+static const uint32_t nVERSION = 2;
+static const size_t nMaxBLOCK = 262144;
+
+/*
+ * size, seconds and nanoseconds of the modification time of a file
+*/
+static bool Stamp(
+    const std::string& _f,
+    uint64_t* _s )
+{
+    struct stat s;
+
+    if ( ::stat( _f.c_str(), &s ) )
+    {
+        return( false );
+    }   // the file does not exist
+
+    _s[ 0 ] = s.st_size; _s[ 1 ] = s.st_mtim.tv_sec; _s[ 2 ] = s.st_mtim.tv_nsec;
+
+    return( true );
+}   // end of Stamp()
+
+Store::Store()
+{
+    mFile = -1; mWrite = false; mFail = false; mPartitions = 0; mOffset = 0; mSequence = 0;
+    mSource[ 0 ] = 0; mSource[ 1 ] = 0; mSource[ 2 ] = 0;
+}   // default constructor
+
+Store::~Store()
+{
+    if ( mWrite )
+    {
+        Close();
+    }   // the index is written even if the caller forgot
+
+    if ( !( mFile < 0 ) )
+    {
+        ::close( mFile );
+    }   // the store is still open
+
+    mPart.clear(); mBlock.clear();
+}   // default destructor; environmentally conscientious
+
+/*
+ * start a new store; the blocks are appended as they are filled and the
+ * index is written by Close()
+*/
+bool Store::Create(
+    const std::string& _f,      // name of the store; the index is _f.idx
+    const unsigned int _p )     // number of partitions
+{
+    mName = _f; mHeader.clear(); mPartitions = ( _p ) ? _p : 1;
+    mSource[ 0 ] = 0; mSource[ 1 ] = 0; mSource[ 2 ] = 0;
+    mOffset = 0; mSequence = 0; mFail = false;
+    mPart.assign( mPartitions, stBLOCK() ); mBlock.clear();
+
+    for ( unsigned int i = 0; i < mPartitions; ++i )
+    {
+        mPart[ i ].partition = i; ( mPart[ i ].data ).reserve( nMaxBLOCK + 1024 );
+    }   // the blocks of the partitions
+
+    mFile = ::open( _f.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+    return( mWrite = !( mFile < 0 ) );
+}   // end of Create()
+
+/*
+ * header of the summary, without the newline; kept in the index
+*/
+void Store::SetHeader(
+    const std::string& _h )
+{
+    mHeader = _h;
+}   // end of SetHeader()
+
+/*
+ * the summary written along with the store; called once the summary is
+ * closed, before Close()
+*/
+bool Store::SetSource(
+    const std::string& _f )     // name of the summary
+{
+    return( Stamp( _f, mSource ) );
+}   // end of SetSource()
+
+/*
+ * whether the store was written with this summary, as it is now
+*/
+bool Store::IsSource(
+    const std::string& _f ) const   // name of the summary
+{
+    uint64_t s[ 3 ];
+
+    return( Stamp( _f, s ) && ( s[ 0 ] == mSource[ 0 ] ) &&
+        ( s[ 1 ] == mSource[ 1 ] ) && ( s[ 2 ] == mSource[ 2 ] ) );
+}   // end of IsSource()
+
+/*
+ * add a line of the summary to the block of its partition; a block that is
+ * full is handed to the caller, who compresses and writes it with Flush()
+ * outside of the critical region. one thread at a time.
+*/
+bool Store::Add(
+    const std::string& _s,      // line of the summary, with the newline
+    const unsigned int _t,      // ncbi tid
+    const unsigned int _l,      // bin of the leftmost segment
+    const unsigned int _r,      // bin of the rightmost segment
+    std::vector<stBLOCK>& _b )  // blocks that are full
+{
+    stBLOCK& b = mPart[ Mix64( _t ) % mPartitions ];
+    std::map<uint32_t, stSPAN>::iterator k = ( b.taxa ).find( _t );
+
+    if ( k == ( b.taxa ).end() )
+    {
+        stSPAN s; s.left = std::min( _l, _r ); s.right = std::max( _l, _r ); s.records = 1;
+        ( b.taxa )[ _t ] = s;
+    }   // first record of the taxon in the block
+    else
+    {
+        ( *k ).second.left = std::min( ( *k ).second.left, std::min( _l, _r ) );
+        ( *k ).second.right = std::max( ( *k ).second.right, std::max( _l, _r ) );
+        ( *k ).second.records += 1;
+    }   // widen the bins of the taxon
+
+    ( b.data ).append( _s ); b.records += 1;
+
+    if ( ( b.data ).size() < nMaxBLOCK )
+    {
+        return( false );
+    }   // the block is not full yet
+
+    b.sequence = mSequence++;
+    _b.push_back( stBLOCK() ); ( _b.back() ).swap( b );
+    b.partition = ( _b.back() ).partition; ( b.data ).reserve( nMaxBLOCK + 1024 );
+
+    return( true );
+}   // end of Add()
+
+/*
+ * compress a block and append it to the store; the lines are released.
+ * may be called by all threads at once.
+*/
+bool Store::Flush(
+    stBLOCK& _b )
+{
+    uLongf size = ::compressBound( ( _b.data ).size() );
+    std::string buffer( size, '\0' );
+    ssize_t n = 0;
+    bool done = ( ::compress2( reinterpret_cast<Bytef*>( &buffer[ 0 ] ), &size,
+        reinterpret_cast<const Bytef*>( ( _b.data ).data() ), ( _b.data ).size(), Z_DEFAULT_COMPRESSION ) == Z_OK );
+
+    _b.length = ( _b.data ).size(); _b.size = size;
+    std::string().swap( _b.data );
+
+    #pragma omp critical ( store )
+    {
+        _b.offset = mOffset;
+
+        for ( size_t have = 0; done && ( have < size ); have += n )
+        {
+            if ( ( n = ::write( mFile, &buffer[ have ], size - have ) ) < 0 )
+            {
+                n = 0; done = ( errno == EINTR );
+            }   // interrupted by a signal or unable to write
+        }   // write the whole block
+
+        mOffset += size; mBlock.push_back( stBLOCK() ); ( mBlock.back() ).swap( _b );
+        mFail = mFail || !done;
+    }   // the critical region
+
+    return( done );
+}   // end of Flush()
+
+/*
+ * write the blocks that are not full and the index
+*/
+bool Store::Close()
+{
+    std::vector<stBLOCK> rest;
+    bool done = true;
+
+    if ( !mWrite )
+    {
+        return( false );
+    }   // the store is not being written
+
+    for ( unsigned int i = 0; i < mPartitions; ++i )
+    {
+        if ( mPart[ i ].records )
+        {
+            mPart[ i ].sequence = mSequence++; rest.push_back( stBLOCK() ); ( rest.back() ).swap( mPart[ i ] );
+        }   // the last block of the partition
+    }   // partitions with lines left
+
+    #pragma omp parallel for schedule( dynamic )
+    for ( long i = 0; i < static_cast<long>( rest.size() ); ++i )
+    {
+        Flush( rest[ i ] );
+    }   // compress the last blocks
+
+    std::sort( mBlock.begin(), mBlock.end(), SortBlock() );
+    mPart.clear(); mWrite = false; ::close( mFile ); mFile = -1;
+
+    FILE* fp = ::fopen( ( mName + ".idx" ).c_str(), "wb" );
+    uint32_t n = mHeader.size();
+    uint64_t blocks = mBlock.size();
+
+    if ( !fp )
+    {
+        return( false );
+    }   // unable to write the index
+
+    ::fwrite( szMAGIC, 1, 8, fp ); ::fwrite( &nVERSION, sizeof( uint32_t ), 1, fp );
+    ::fwrite( &mPartitions, sizeof( uint32_t ), 1, fp ); ::fwrite( &blocks, sizeof( uint64_t ), 1, fp );
+    ::fwrite( mSource, sizeof( uint64_t ), 3, fp ); ::fwrite( &n, sizeof( uint32_t ), 1, fp ); ::fwrite( mHeader.data(), 1, n, fp );
+
+    for ( std::vector<stBLOCK>::const_iterator i = mBlock.begin(); !( i == mBlock.end() ); ++i )
+    {
+        uint32_t field[ 5 ] = { ( *i ).partition, ( *i ).records, ( *i ).size, ( *i ).length,
+            static_cast<uint32_t>( ( ( *i ).taxa ).size() ) };
+
+        ::fwrite( field, sizeof( uint32_t ), 5, fp ); ::fwrite( &( *i ).offset, sizeof( uint64_t ), 1, fp );
+
+        for ( std::map<uint32_t, stSPAN>::const_iterator k = ( ( *i ).taxa ).begin();
+            !( k == ( ( *i ).taxa ).end() ); ++k )
+        {
+            uint32_t span[ 4 ] = { ( *k ).first, ( *k ).second.left, ( *k ).second.right, ( *k ).second.records };
+
+            ::fwrite( span, sizeof( uint32_t ), 4, fp );
+        }   // taxa of the block
+    }   // every block
+
+    done = !::ferror( fp ) && !mFail;
+
+    return( !::fclose( fp ) && done );
+}   // end of Close()
+
+/*
+ * read the index of a store; the blocks are read with Read()
+*/
+bool Store::Open(
+    const std::string& _f )     // name of the store; the index is _f.idx
+{
+    FILE* fp = ::fopen( ( _f + ".idx" ).c_str(), "rb" );
+    char magic[ 8 ];
+    uint32_t version = 0, n = 0, field[ 5 ], span[ 4 ];
+    uint64_t blocks = 0;
+    bool done;
+
+    mBlock.clear(); mHeader.clear(); mName = _f;
+
+    if ( !fp )
+    {
+        return( false );
+    }   // no index; the store has not been written
+
+    done = ( ::fread( magic, 1, 8, fp ) == 8 ) && !::memcmp( magic, szMAGIC, 8 ) &&
+        ( ::fread( &version, sizeof( uint32_t ), 1, fp ) == 1 ) && ( version == nVERSION ) &&
+        ( ::fread( &mPartitions, sizeof( uint32_t ), 1, fp ) == 1 ) &&
+        ( ::fread( &blocks, sizeof( uint64_t ), 1, fp ) == 1 ) &&
+        ( ::fread( mSource, sizeof( uint64_t ), 3, fp ) == 3 ) &&
+        ( ::fread( &n, sizeof( uint32_t ), 1, fp ) == 1 );
+
+    if ( done )
+    {
+        mHeader.resize( n ); done = !n || ( ::fread( &mHeader[ 0 ], 1, n, fp ) == n );
+    }   // header of the summary
+
+    for ( uint64_t i = 0; done && ( i < blocks ); ++i )
+    {
+        mBlock.push_back( stBLOCK() ); stBLOCK& b = mBlock.back();
+        done = ( ::fread( field, sizeof( uint32_t ), 5, fp ) == 5 ) &&
+            ( ::fread( &b.offset, sizeof( uint64_t ), 1, fp ) == 1 );
+        b.partition = field[ 0 ]; b.records = field[ 1 ]; b.size = field[ 2 ]; b.length = field[ 3 ];
+        b.sequence = i;
+
+        for ( uint32_t k = 0; done && ( k < field[ 4 ] ); ++k )
+        {
+            if ( ( done = ( ::fread( span, sizeof( uint32_t ), 4, fp ) == 4 ) ) )
+            {
+                stSPAN& s = ( b.taxa )[ span[ 0 ] ];
+                s.left = span[ 1 ]; s.right = span[ 2 ]; s.records = span[ 3 ];
+            }   // tid, bins and records of the taxon
+        }   // taxa of the block
+    }   // every block
+
+    ::fclose( fp );
+
+    if ( !done || ( ( mFile = ::open( _f.c_str(), O_RDONLY ) ) < 0 ) )
+    {
+        mBlock.clear(); return( false );
+    }   // the index is truncated or the store is missing
+
+    return( true );
+}   // end of Open()
+
+/*
+ * read and decompress the lines of a block; may be called by all threads
+*/
+bool Store::Read(
+    const stBLOCK& _b,          // block of the index
+    std::string& _s ) const     // lines of the block
+{
+    std::string buffer( _b.size, '\0' );
+    uLongf size = _b.length;
+    ssize_t n = 0;
+
+    for ( size_t have = 0; have < _b.size; have += n )
+    {
+        if ( ( n = ::pread( mFile, &buffer[ have ], _b.size - have, _b.offset + have ) ) <= 0 )
+        {
+            if ( ( n < 0 ) && ( errno == EINTR ) )
+            {
+                n = 0; continue;
+            }   // interrupted by a signal
+
+            return( false );
+        }   // the store is truncated
+    }   // read the whole block
+
+    _s.resize( _b.length );
+
+    return( ( ::uncompress( reinterpret_cast<Bytef*>( &_s[ 0 ] ), &size,
+        reinterpret_cast<const Bytef*>( buffer.data() ), _b.size ) == Z_OK ) && ( size == _b.length ) );
+}   // end of Read()
+
+/*
+ * header of the summary, without the newline
+*/
+const std::string& Store::GetHeader() const
+{
+    return( mHeader );
+}   // end of GetHeader()
+
+/*
+ * number of partitions; a taxon is always in the same partition
+*/
+unsigned int Store::GetPartitions() const
+{
+    return( mPartitions );
+}   // end of GetPartitions()
+
+/*
+ * blocks of the index, sorted by partition
+*/
+const std::vector<Store::stBLOCK>& Store::GetBlocks() const
+{
+    return( mBlock );
+}   // end of GetBlocks()
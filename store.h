@@ -0,0 +1,128 @@
+/*
+ * store.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * summary partitioned by taxon
+ *
+ * samfile may write the records of the summary a second time, partitioned
+ * by a hash of the tid. the lines of every partition are gathered in a block
+ * of about 256 KB, which is compressed with zlib and appended to the store,
+ * sample.store, once it is full. the index, sample.store.idx, lists every
+ * block with its partition, place in the store, and the taxa it holds with
+ * their bins and records, so that the records of a few taxa or of a range
+ * of bins are read without decompressing the rest. all records of a taxon
+ * are in one partition, in the order of the summary; the partitions are
+ * independent of each other and may be read by one thread each.
+ *
+ * the index also records the size and modification time of the summary it
+ * was written with, so a store left over from an earlier summary of the
+ * same name is recognized and not used in its place.
+ *
+ * index: magic "MCATSTOR", version, number of partitions (4 bytes each),
+ * number of blocks (8 bytes), size, seconds and nanoseconds of the
+ * modification time of the summary (8 bytes each), length of the header
+ * (4 bytes) and header of the summary, without the newline; then every
+ * block as partition, records,
+ * compressed size, size, number of taxa (4 bytes each), offset in the store
+ * (8 bytes), and every taxon as tid, lowest bin, highest bin and records
+ * (4 bytes each), sorted by tid. blocks are sorted by partition and keep
+ * the order of the summary within a partition.
+*/
+
+#ifndef _STORE_H
+#define _STORE_H
+
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <stdint.h>
+
+struct stSPAN
+{
+    uint32_t left;          // lowest bin of the records
+    uint32_t right;         // highest bin of the records
+    uint32_t records;       // number of records
+};  // a taxon in a block
+
+class Store
+{
+public:
+    struct stBLOCK
+    {
+        stBLOCK()
+        {
+            partition = 0; records = 0; size = 0; length = 0; offset = 0; sequence = 0;
+        }   // default constructor
+
+        void swap( stBLOCK& _b )
+        {
+            std::swap( partition, _b.partition ); std::swap( records, _b.records );
+            std::swap( size, _b.size ); std::swap( length, _b.length );
+            std::swap( offset, _b.offset ); std::swap( sequence, _b.sequence );
+            taxa.swap( _b.taxa ); data.swap( _b.data );
+        }   // exchange the contents without copying the lines
+
+        uint32_t partition;     // partition of the taxa
+        uint32_t records;       // number of lines
+        uint32_t size;          // compressed size
+        uint32_t length;        // size of the lines
+        uint64_t offset;        // place in the store
+        uint64_t sequence;      // order of the blocks of a partition
+        std::map<uint32_t, stSPAN> taxa;    // taxa of the block
+        std::string data;       // lines; not kept once written
+    };  // a block of the store
+
+    Store();
+    ~Store();
+
+    bool Create( const std::string&, const unsigned int );
+    void SetHeader( const std::string& );
+    bool SetSource( const std::string& );
+    bool Add( const std::string&, const unsigned int, const unsigned int,
+        const unsigned int, std::vector<stBLOCK>& );
+    bool Flush( stBLOCK& );
+    bool Close();
+
+    bool Open( const std::string& );
+    bool Read( const stBLOCK&, std::string& ) const;
+    const std::string& GetHeader() const;
+    bool IsSource( const std::string& ) const;
+    unsigned int GetPartitions() const;
+    const std::vector<stBLOCK>& GetBlocks() const;
+
+private:
+    /*
+     * blocks in the order of the index: by partition, then by the order in
+     * which they were filled
+    */
+    struct SortBlock
+    {
+        bool operator()( const stBLOCK& _a, const stBLOCK& _b ) const
+        {
+            return( ( _a.partition == _b.partition ) ?
+                ( _a.sequence < _b.sequence ) : ( _a.partition < _b.partition ) );
+        }   // end of operator overloading
+    };  // end of class SortBlock
+
+    int mFile;              // store; -1 if not open
+    bool mWrite;            // the store is being written
+    bool mFail;             // a block could not be written
+    std::string mName;      // name of the store
+    std::string mHeader;    // header of the summary
+    uint64_t mSource[ 3 ];  // size and modification time of the summary
+    unsigned int mPartitions;   // number of partitions
+    uint64_t mOffset;       // end of the store
+    uint64_t mSequence;     // blocks filled so far
+    std::vector<stBLOCK> mPart;     // block being filled of every partition
+    std::vector<stBLOCK> mBlock;    // blocks written; without their lines
+};  // end of class definition
+
+#endif  // _STORE_H
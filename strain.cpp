@@ -13,15 +13,57 @@
  * revised on April 17, 2013
 */
 
+#include <omp.h>
+#include <token.h>
+#include <reader.h>
+#include <task.h>
 #include <strain.h>
 
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
-#include <fstream>
+#include <cstring>
 #include <iostream>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <boost/algorithm/string.hpp>
 
+/*
+ * identification and version of the histogram file
+*/
+static const char* szMAGIC = "MCATHIST";
+static const uint32_t nVERSION = 2;
+
+struct stHEADER
+{
+    char magic[ 8 ];        // identification of the file
+    uint32_t version;       // version of the format
+    uint32_t taxa;          // number of genomes
+    uint64_t bins;          // number of histogram entries
+    uint32_t width;         // width of the bins in bases
+    uint32_t reserved;
+};  // header of the histogram file
+
+struct stGENOME
+{
+    uint32_t tid;           // ncbi tid
+    uint32_t block;         // number of bins of the genome
+    uint32_t bins;          // number of histogram entries
+    uint32_t reserved;
+    uint64_t offset;        // first histogram entry
+    uint64_t hits;          // number of hits
+    double ratio;           // sum of percent identity
+    double phred;           // sum of read quality
+    uint32_t length;        // sum of alignment length
+    uint32_t odd;           // sum of mismatches
+    uint32_t gap;           // sum of gaps
+    uint32_t score;         // sum of alignment quality
+};  // a genome of the histogram file
+
 /*
  * constructor
  * set the number of histogram bins
@@ -31,8 +73,11 @@ Strain::Strain( const std::map<unsigned int, stTABLE>& _t )
 {
     std::map<unsigned int, stTABLE> t = _t;
     unsigned int block, tid;
+    stPART part;
 
-    mBlock.clear(); mTaxon.clear();
+    mBlock.clear(); mTaxon.clear(); mReport = NULL; mNuma = NULL; mIdentity = 70.0; mSave = false; mStore = false;
+    mSource = NULL; mReader = NULL; mScheduler = NULL;
+    mReplicate = 0; mLevel = 0.95; mSeed = 0; mWidth = nBinWIDTH;
 
     for ( std::map<unsigned int, stTABLE>::iterator i = t.begin(); !( i == t.end() ); ++i )
     {
@@ -42,124 +87,739 @@ Strain::Strain( const std::map<unsigned int, stTABLE>& _t )
 
         ( mBlock.find( tid ) == mBlock.end() ) ?
             mBlock[ tid ] = block : mBlock[ tid ] += block; // accumulate genome size
+
+        part.start = ( ( *i ).second ).start; part.end = ( ( *i ).second ).end;
+        part.size = ( ( *i ).second ).size; mGenome[ tid ].push_back( part );
     }   // calcualte the block sizes
 
+    for ( std::map<unsigned int, std::vector<stPART> >::iterator i = mGenome.begin(); !( i == mGenome.end() ); ++i )
+    {
+        std::sort( ( ( *i ).second ).begin(), ( ( *i ).second ).end(), SortPart() );
+    }   // the genomes of a taxon in the order of their bins
+
     t.clear();      // free up the memory
 }   // end of copy constructor
 
 Strain::~Strain()
 {
-    mBlock.clear(); mTaxon.clear();
+    mBlock.clear(); mTaxon.clear(); mGenome.clear();
 }   // default destructor; environmentally conscientious
 
+/*
+ * minimum average percent identity of a taxon for its index to be used by
+ * the species level assignment
+*/
+void Strain::SetIdentity(
+    const double _m )
+{
+    mIdentity = _m;
+}   // end of SetIdentity()
+
+/*
+ * save the coverage histograms in sample.strain.bin
+*/
+void Strain::SetHistogram(
+    const bool _s )
+{
+    mSave = _s;
+}   // end of SetHistogram()
+
+/*
+ * read the records from the store of the summary, sample.store, if samfile
+ * has written one; the summary is read otherwise
+*/
+void Strain::SetStore(
+    const bool _s )
+{
+    mStore = _s;
+}   // end of SetStore()
+
+/*
+ * confidence intervals of the wsei and the abundance from bootstrap
+ * replicates of the reads; see bootstrap.h
+*/
+void Strain::SetBootstrap(
+    const unsigned int _b,      // number of replicates; 0 disables
+    const double _c,            // confidence level
+    const uint64_t _s )         // seed of the replicates
+{
+    mReplicate = _b; mLevel = _c; mSeed = _s;
+}   // end of SetBootstrap()
+
+/*
+ * also write the coverage and indices of coarser bins; every width is a
+ * multiple of the width of the histograms, others are ignored, and so are
+ * widths that hold every genome of the table in a single bin
+*/
+void Strain::SetPyramid(
+    const unsigned int _w,                  // width of the bins of the histograms
+    const std::vector<unsigned int>& _p )   // widths of the coarser levels
+{
+    unsigned int size = 0;
+
+    mWidth = ( _w ) ? _w : nBinWIDTH; mPyramid.clear();
+
+    for ( std::map<unsigned int, std::vector<stPART> >::iterator i = mGenome.begin(); !( i == mGenome.end() ); ++i )
+    {
+        for ( unsigned int k = 0; k < ( ( *i ).second ).size(); ++k )
+        {
+            size = std::max( size, ( ( *i ).second )[ k ].size );
+        }   // every genome of the taxon
+    }   // the largest genome of the table
+
+    for ( unsigned int i = 0; i < _p.size(); ++i )
+    {
+        if ( ( _p[ i ] > mWidth ) && !( _p[ i ] % mWidth ) && ( size > _p[ i ] ) )
+        {
+            mPyramid.push_back( _p[ i ] );
+        }   // a level merges whole bins and spreads a genome over several
+    }   // levels of the pyramid
+}   // end of SetPyramid()
+
 bool Strain::Run( const std::string& _f )
 {
     const char* szDELIMIT = ".\n";
     std::vector<std::string> field;
-    mAssign.clear();
+    mAssign.clear(); mHistogram.clear();
 
     boost::algorithm::split(                // splite the entire string
         field, _f, boost::algorithm::is_any_of( szDELIMIT ) );
-    field[ 0 ] += ".strain.csv";
 
-    Assign( _f ); Output( field[ 0 ] );
-    mAssign.clear();
+    if ( mReport )
+    {
+        mReport->Begin( "strain", _f );
+    }   // instrumentation of the stage
+
+    if ( !mStore || !Partition( field[ 0 ] + ".store", _f ) )
+    {
+        Assign( _f );
+    }   // no store, or one of another summary; the summary is read
+
+    Bin();
+
+    if ( mSave )
+    {
+        Save( field[ 0 ] + ".strain.bin" );
+    }   // the indices may be rebuilt from the histograms
+
+    Output( field[ 0 ] + ".strain.csv" ); Pyramid( field[ 0 ] );
+    mAssign.clear(); mHistogram.clear(); mCoverage.clear();
 
     return( true );
 }   // end of Run()
 
+/*
+ * rebuild the strain level assignment from the saved histograms
+ *
+ * sample.strain.bin produces sample.strain.csv and the coverage of every
+ * genome, sample.coverage.csv; the summary file is not read. a file of
+ * another bin width, or with a genome of another number of bins, e.g.,
+ * from another translation table, is rejected
+*/
+bool Strain::Restore(
+    const std::string& _f,      // histogram file
+    const bool _p )             // also export the coverage
+{
+    const char* szDELIMIT = ".\n";
+    std::vector<std::string> field;
+    std::map<unsigned int, unsigned int>::const_iterator k;
+    const stHEADER* head;
+    const stGENOME* genome;
+    const stBIN* bin;
+    struct stat s;
+    void* map = MAP_FAILED;
+    stPIVOT set;
+    int fd;
+
+    boost::algorithm::split(                // splite the entire string
+        field, _f, boost::algorithm::is_any_of( szDELIMIT ) );
+
+    if ( ( fd = ::open( _f.c_str(), O_RDONLY ) ) < 0 )
+    {
+        return( false );
+    }   // unable to open the file
+
+    if ( !::fstat( fd, &s ) && ( s.st_size >= static_cast<off_t>( sizeof( stHEADER ) ) ) )
+    {
+        map = ::mmap( NULL, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    }   // the file is used in place
+
+    ::close( fd );
+
+    if ( map == MAP_FAILED )
+    {
+        return( false );
+    }   // unable to map the file
+
+    head = static_cast<const stHEADER*>( map );
+    genome = reinterpret_cast<const stGENOME*>( head + 1 );
+    bin = reinterpret_cast<const stBIN*>( genome + head->taxa );
+
+    if ( ::memcmp( head->magic, szMAGIC, sizeof( head->magic ) ) || !( head->version == nVERSION ) ||
+        !( static_cast<double>( s.st_size ) == sizeof( stHEADER ) +
+        static_cast<double>( head->taxa ) * sizeof( stGENOME ) + static_cast<double>( head->bins ) * sizeof( stBIN ) ) )
+    {
+        ::munmap( map, s.st_size ); return( false );
+    }   // not a histogram file of this version
+
+    for ( unsigned int i = 0; i < head->taxa; ++i )
+    {
+        if ( !( head->width == mWidth ) || ( !( ( k = mBlock.find( genome[ i ].tid ) ) == mBlock.end() ) &&
+            !( genome[ i ].block == ( *k ).second ) ) )
+        {
+            ::munmap( map, s.st_size ); return( false );
+        }   // the bins of the file are not those of the table
+    }   // written with the same translation table and bin width
+
+    if ( mReport )
+    {
+        mReport->Begin( "histogram", _f );
+    }   // instrumentation of the stage
+
+    mAssign.clear(); mHistogram.clear(); mCoverage.clear(); mCount = stCOUNT();
+    mCount.bytes = s.st_size;
+
+    for ( unsigned int i = 0; i < head->taxa; ++i )
+    {
+        if ( ( mBlock.find( genome[ i ].tid ) == mBlock.end() ) ||
+            ( genome[ i ].offset + genome[ i ].bins > head->bins ) )
+        {
+            mCount.reject[ nREJECT_TABLE ] += 1.0; continue;
+        }   // genome is not in the translation table
+
+        set.tid = genome[ i ].tid;
+        set.ratio = genome[ i ].ratio; set.phred = genome[ i ].phred;
+        set.length = genome[ i ].length; set.odd = genome[ i ].odd;
+        set.gap = genome[ i ].gap; set.score = genome[ i ].score;
+        mAssign[ genome[ i ].tid ] = set; mCount.records += genome[ i ].hits;
+        mCoverage[ genome[ i ].tid ] = std::make_pair( bin + genome[ i ].offset, genome[ i ].bins );
+    }   // every genome of the file
+
+    if ( _p )
+    {
+        Plot( field[ 0 ] + ".coverage.csv" );
+    }   // coverage for plotting
+
+    Output( field[ 0 ] + ".strain.csv" ); Pyramid( field[ 0 ] );
+    mAssign.clear(); mCoverage.clear(); ::munmap( map, s.st_size );
+
+    return( true );
+}   // end of Restore()
+
+/*
+ * save the histograms of the genomes; see strain.h for the format
+*/
+bool Strain::Save( const std::string& _f ) const
+{
+    FILE* of = ::fopen( _f.c_str(), "wb" );
+    std::map<unsigned int, std::vector<stBIN> >::const_iterator h;
+    stHEADER head;
+    stGENOME genome;
+    uint64_t offset = 0;
+
+    if ( !of )
+    {
+        return( false );
+    }   // unable to write the file
+
+    ::memset( &head, 0, sizeof( head ) ); ::memcpy( head.magic, szMAGIC, sizeof( head.magic ) );
+    head.version = nVERSION; head.taxa = mAssign.size(); head.width = mWidth;
+
+    for ( h = mHistogram.begin(); !( h == mHistogram.end() ); ++h )
+    {
+        head.bins += ( ( *h ).second ).size();
+    }   // total number of histogram entries
+
+    ::fwrite( &head, sizeof( head ), 1, of );
+
+    for ( std::map<unsigned int, stPIVOT>::const_iterator i = mAssign.begin(); !( i == mAssign.end() ); ++i )
+    {
+        h = mHistogram.find( ( *i ).first );
+        ::memset( &genome, 0, sizeof( genome ) );
+
+        genome.tid = ( *i ).first; genome.block = mBlock.find( ( *i ).first )->second;
+        genome.bins = ( ( *h ).second ).size(); genome.offset = offset;
+        genome.ratio = ( ( *i ).second ).ratio; genome.phred = ( ( *i ).second ).phred;
+        genome.length = ( ( *i ).second ).length; genome.odd = ( ( *i ).second ).odd;
+        genome.gap = ( ( *i ).second ).gap; genome.score = ( ( *i ).second ).score;
+
+        for ( unsigned int k = 0; k < genome.bins; ++k )
+        {
+            genome.hits += ( ( *h ).second )[ k ].count;
+        }   // number of hits of the genome
+
+        ::fwrite( &genome, sizeof( genome ), 1, of ); offset += genome.bins;
+    }   // one record per genome
+
+    for ( std::map<unsigned int, stPIVOT>::const_iterator i = mAssign.begin(); !( i == mAssign.end() ); ++i )
+    {
+        h = mHistogram.find( ( *i ).first );
+
+        if ( !( ( *h ).second ).empty() )
+        {
+            ::fwrite( &( ( *h ).second )[ 0 ], sizeof( stBIN ), ( ( *h ).second ).size(), of );
+        }   // histogram of the genome
+    }   // the histograms in the order of the genomes
+
+    return( static_cast<bool>( ::fclose( of ) ) );
+}   // end of Save()
+
+/*
+ * export the coverage of every genome; one line per bin hit
+*/
+bool Strain::Plot( const std::string& _f ) const
+{
+    FILE* of = ::fopen( _f.c_str(), "w" );
+    std::map<unsigned int, std::pair<const stBIN*, unsigned int> >::const_iterator i;
+
+    ::fprintf( of, "%s,%s,%s,%s,%s\n", "Taxon", "TID", "Bin", "Total Bin", "Hits" );
+
+    for ( i = mCoverage.begin(); !( i == mCoverage.end() ); ++i )
+    {
+        const stBIN* h = ( ( *i ).second ).first;
+
+        for ( unsigned int k = 0; k < ( ( *i ).second ).second; ++k )
+        {
+            ::fprintf( of, "%s,%d,%d,%d,%d\n", ( mTaxon.find( ( *i ).first )->second ).c_str(),
+                ( *i ).first, h[ k ].bin, mBlock.find( ( *i ).first )->second, h[ k ].count );
+        }   // every bin hit
+    }   // every genome
+
+    return( static_cast<bool>( ::fclose( of ) ) );
+}   // end of Plot()
+
 /*
  * strain level assignment
  * summarize the alignment file and generate the output
+ *
+ * the summary is read by a chain of tasks, one block at a time: the task of
+ * a block submits the task that parses it and the task of the next block.
+ * every worker aggregates the blocks it parses on its own, so the sums are
+ * the same as those of a thread of a parallel region; with the workers
+ * placed on numa nodes, every block is copied to storage of the worker
+ * before it is parsed. once every block is parsed, the aggregates of the
+ * workers are merged and the histograms of the taxa are counted by tasks
+ * of the same run.
 */
 bool Strain::Assign( const std::string& _f )
 {
-    const char* szDELIMIT = ",\t\n";
-    const unsigned int nMaxBUFFER = 2048;
-    char header[ nMaxBUFFER ];
+    std::string header;
 
-    std::ifstream ifs( _f.c_str(), std::ios::in );
+    Reader ifs( _f );
 
-    if ( ifs.fail() )
+    if ( !ifs.IsOpen() )
     {
         return( false );
     }   // check the state of stream
 
-    ifs.getline( header, nMaxBUFFER );  // skip the header
+    ifs.GetLine( header );  // skip the header
+    mCount = stCOUNT(); mCount.bytes = header.size() + 1;
 
-    #pragma omp parallel
+    Scheduler s; s.SetNuma( mNuma );
+
+    mReader = &ifs; mScheduler = &s; mWorker.assign( ::omp_get_max_threads(), stWORKER() );
+    mStep.push_back( Call<Strain>( this, &Strain::Feed, 0 ) );
+    mStep.push_back( Call<Strain>( this, &Strain::Gather, 0 ) );
+    mStep[ 0 ].Then( &mStep[ 1 ] ); s.Submit( &mStep[ 1 ] ); s.Submit( &mStep[ 0 ] );
+
+    s.Run();
+
+    mStep.clear(); mText.clear(); mWorker.clear(); mTask.clear();
+    mReader = NULL; mScheduler = NULL;
+
+    return( true );
+}   // end of Assign()
+
+/*
+ * task: take the next block of the summary; the block is parsed by a task
+ * of its own, and the next block is taken by another task. both precede
+ * the task that merges the aggregates. only one of these tasks runs at a
+ * time, so the reader is not locked.
+*/
+void Strain::Feed(
+    const unsigned int _b )     // number of the block
+{
+    Call<Strain>* scan = NULL;
+    Call<Strain>* next = NULL;
+    std::string block;
+
+    if ( !mReader->Next( block ) )
+    {
+        return;
+    }   // no more data to process
+
+    #pragma omp critical
+    {
+        mText.push_back( std::string() ); ( mText.back() ).swap( block );
+        mStep.push_back( Call<Strain>( this, &Strain::Scan, _b ) ); scan = &mStep.back();
+        mStep.push_back( Call<Strain>( this, &Strain::Feed, _b + 1 ) ); next = &mStep.back();
+    }   // the critical region
+
+    scan->Then( &mStep[ 1 ] ); next->Then( &mStep[ 1 ] );
+    mScheduler->Submit( next ); mScheduler->Submit( scan );  // the worker parses the block next
+}   // end of Feed()
+
+/*
+ * task: aggregate the records of a block of the summary with the others
+ * parsed by the worker
+*/
+void Strain::Scan(
+    const unsigned int _b )     // number of the block
+{
+    stWORKER& w = mWorker[ ::omp_get_thread_num() ];
+    std::string block;          // lines of the block
+    std::string chunk;          // copy of the block on the node of the worker
+    char* buffer = NULL; char* next = NULL; char* end = NULL;
+    std::vector<const char*> field;
+    std::map<unsigned int, stPIVOT>::iterator k;
+    unsigned int tid;
+    double lines = 0.0;
+    double wait = ( mReport ) ? Report::Clock() : 0.0;
+    stPIVOT set;
+
+    #pragma omp critical
+    {
+        block.swap( mText[ _b ] );
+    }   // the critical region
+
+    w.count.wait += ( mReport ) ? Report::Clock() - wait : 0.0;
+
+    if ( mNuma )
+    {
+        chunk.assign( block ); w.node = mNuma->GetNode();
+    }   // the storage of the worker was first touched on its node
+
+    next = ( mNuma ) ? &chunk[ 0 ] : &block[ 0 ]; end = next + block.size();
+
+    while ( next < end )
+    {
+        buffer = next; lines += 1.0;    // every block ends with a newline
+        next = static_cast<char*>( ::memchr( buffer, '\n', end - buffer ) );
+        *next++ = '\0';
+
+        if ( !Parse( buffer, field, tid, set ) )
+        {
+            w.count.reject[ nREJECT_FIELD ] += 1.0; continue;
+        }   // truncated records
+
+        if ( mBlock.find( tid ) == mBlock.end() )
+        {
+            w.count.reject[ nREJECT_TABLE ] += 1.0; continue;
+        }   // taxon is not in the table, e.g., not on the panel
+
+        ( ( k = ( w.assign ).find( tid ) ) == ( w.assign ).end() ) ?
+            ( w.assign )[ tid ] = set : ( *k ).second += set;
+    }   // merge the alignments
+
+    w.mine.records += lines; w.mine.bytes += block.size();
+
+    #pragma omp critical
+    {
+        mCount.records += lines; mCount.bytes += block.size();
+
+        if ( mReport )
+        {
+            mReport->Progress( mCount );
+        }   // instrumentation of the reader
+    }   // the critical region
+}   // end of Scan()
+
+/*
+ * task: merge the aggregates of the workers once every block is parsed, and
+ * count the histograms of the taxa
+*/
+void Strain::Gather(
+    const unsigned int )
+{
+    for ( unsigned int i = 0; i < mWorker.size(); ++i )
+    {
+        if ( mNuma && mReport && ( mWorker[ i ].mine.records > 0.0 ) )
+        {
+            mReport->Node( mWorker[ i ].node, mWorker[ i ].mine );
+        }   // throughput of the numa node
+
+        Merge( mWorker[ i ].assign, mAssign ); mCount += mWorker[ i ].count;
+    }   // the aggregates of every worker
+
+    Queue( *mScheduler, mStep );
+}   // end of Gather()
+
+/*
+ * aggregate the records of the store written by samfile; every partition
+ * is read by one task, and its histograms are counted by a second task
+ * that follows it, while the other partitions are still being read. every
+ * taxon is in only one partition, so merging the partitions only moves
+ * their aggregates. within a partition the records are in the order of the
+ * summary.
+*/
+bool Strain::Partition(
+    const std::string& _f,      // store
+    const std::string& _s )     // summary the store must have been written with
+{
+    Store store;
+
+    if ( !store.Open( _f ) || !store.IsSource( _s ) )
+    {
+        return( false );
+    }   // no store next to the summary, or one of an earlier summary
+
+    const std::vector<Store::stBLOCK>& block = store.GetBlocks();
+    std::vector<Call<Strain> > task;
+    std::vector<unsigned int> order, size( store.GetPartitions(), 0 );
+    Scheduler s; s.SetNuma( mNuma );
+    bool done = true;
+
+    mSource = &store; mSlice.assign( store.GetPartitions(), stSLICE() );
+    mHistogram.clear(); mCount = stCOUNT(); mCount.bytes = store.GetHeader().size() + 1;
+
+    for ( size_t i = 0; i < block.size(); ++i )
+    {
+        stSLICE& p = mSlice[ block[ i ].partition ];
+
+        p.first = ( p.first == p.last ) ? i : p.first; p.last = i + 1;
+        p.length += block[ i ].length; size[ block[ i ].partition ] += block[ i ].length;
+    }   // blocks of every partition; the blocks are sorted by partition
+
+    task.reserve( 2 * mSlice.size() );
+
+    for ( unsigned int i = 0; i < mSlice.size(); ++i )
+    {
+        task.push_back( Call<Strain>( this, &Strain::Slice, i ) );
+        task.push_back( Call<Strain>( this, &Strain::Tally, i ) );
+        order.push_back( i );
+    }   // reading and counting of every partition
+
+    std::sort( order.begin(), order.end(), SortSize( &size ) );
+
+    for ( unsigned int i = 0; i < order.size(); ++i )
+    {
+        task[ 2 * order[ i ] ].Then( &task[ 2 * order[ i ] + 1 ] );
+        s.Submit( &task[ 2 * order[ i ] + 1 ] ); s.Submit( &task[ 2 * order[ i ] ] );
+    }   // the largest partitions first
+
+    s.Run();
+
+    for ( unsigned int i = 0; i < mSlice.size(); ++i )
+    {
+        done = done && mSlice[ i ].done;
+    }   // every block has been read
+
+    mSlice.clear(); mSource = NULL;
+
+    if ( !done )
+    {
+        mAssign.clear(); mHistogram.clear();
+    }   // the summary is read instead
+
+    return( done );
+}   // end of Partition()
+
+/*
+ * task: aggregate the records of a partition of the store
+*/
+void Strain::Slice(
+    const unsigned int _p )     // partition
+{
+    stSLICE& p = mSlice[ _p ];
+    std::string chunk;          // lines of a block
+    char* buffer = NULL; char* next = NULL; char* end = NULL;
+    std::vector<const char*> field;
+    std::map<unsigned int, stPIVOT>::iterator k;
+    unsigned int tid;
+    stPIVOT set;
+
+    for ( size_t i = p.first; p.done && ( i < p.last ); ++i )
     {
-        char buffer[ nMaxBUFFER ];
-        std::vector<std::string> field;
-        unsigned int tid;
-        stPIVOT set; bool run = false;
+        const Store::stBLOCK& b = ( mSource->GetBlocks() )[ i ];
+        std::map<uint32_t, stSPAN>::const_iterator t = ( b.taxa ).begin();
+
+        while ( !( t == ( b.taxa ).end() ) && ( mBlock.find( ( *t ).first ) == mBlock.end() ) )
+        {
+            ++t;
+        }   // a taxon of the block that is in the table
+
+        if ( t == ( b.taxa ).end() )
+        {
+            p.count.reject[ nREJECT_TABLE ] += b.records; chunk.clear();
+        }   // none of the taxa is in the table; the block is not read
+        else if ( !( p.done = mSource->Read( b, chunk ) ) )
+        {
+            continue;
+        }   // the store is damaged
 
-        do
+        next = &chunk[ 0 ]; end = next + chunk.size();
+
+        while ( next < end )
         {
-            #pragma omp critical
+            buffer = next; next = static_cast<char*>( ::memchr( buffer, '\n', end - buffer ) );
+            *next++ = '\0';
+
+            if ( !Parse( buffer, field, tid, set ) )
             {
-                run = ifs.getline( buffer, nMaxBUFFER );
-            }   // the critical region
+                p.count.reject[ nREJECT_FIELD ] += 1.0; continue;
+            }   // truncated records
 
-            if ( !run )
+            if ( mBlock.find( tid ) == mBlock.end() )
             {
-                continue;
-            }   // no more data to process
-
-            boost::algorithm::split(                // splite the entire string
-                field, buffer, boost::algorithm::is_any_of( szDELIMIT ) );
-
-            ( set.site ).clear();
-            set.ratio = static_cast<double>( ::atof( field[ 1 ].c_str() ) );        // percent identity
-            set.length = static_cast<unsigned int>( ::atoi( field[ 2 ].c_str() ) ); // alignment length
-            set.odd = static_cast<unsigned int>( ::atoi( field[ 3 ].c_str() ) );    // mismatches
-            set.gap = static_cast<unsigned int>( ::atoi( field[ 4 ].c_str() ) );    // gaps
-            set.phred = static_cast<double>( ::atof( field[ 5 ].c_str() ) );        // read quality
-            set.score = static_cast<unsigned int>( ::atoi( field[ 6 ].c_str() ) );  // map quality
-            ( set.site ).push_back( static_cast<unsigned int>( ::atoi( field[ 7 ].c_str() ) ) );
-            tid = static_cast<unsigned int>( ::atoi( field[ 10 ].c_str() ) );       // ncbi tid
-
-            #pragma omp critical
+                p.count.reject[ nREJECT_TABLE ] += 1.0; continue;
+            }   // taxon is not in the table
+
+            ( ( k = ( p.assign ).find( tid ) ) == ( p.assign ).end() ) ?
+                ( p.assign )[ tid ] = set : ( *k ).second += set;
+        }   // every line ends with a newline
+
+        #pragma omp critical
+        {
+            mCount.records += b.records; mCount.bytes += b.length;
+
+            if ( mReport )
             {
-                ( mAssign.find( tid ) == mAssign.end() ) ?
-                    mAssign[ tid ] = set : mAssign[ tid ] += set;
-            }   // the critical region
-        } while ( run );    // merge the alignments
-    }   // end of the parallel section
+                mReport->Progress( mCount );
+            }   // instrumentation of the reader
+        }   // the critical region
+    }   // the blocks of the partition
+}   // end of Slice()
 
-    ifs.close(); return( true );
-}   // end of Assign()
+/*
+ * task: histograms of the taxa of a partition once it has been read; the
+ * aggregates and histograms are moved to those of the sample
+*/
+void Strain::Tally(
+    const unsigned int _p )     // partition
+{
+    stSLICE& p = mSlice[ _p ];
+    std::map<unsigned int, std::vector<stBIN> > histogram;
+
+    for ( std::map<unsigned int, stPIVOT>::iterator i = ( p.assign ).begin(); p.done && !( i == ( p.assign ).end() ); ++i )
+    {
+        Count( ( ( *i ).second ).site, histogram[ ( *i ).first ] );
+        std::vector<unsigned int>().swap( ( ( *i ).second ).site );
+    }   // every taxon of the partition
+
+    #pragma omp critical
+    {
+        for ( std::map<unsigned int, std::vector<stBIN> >::iterator i = histogram.begin(); !( i == histogram.end() ); ++i )
+        {
+            mHistogram[ ( *i ).first ].swap( ( *i ).second );
+        }   // the taxa of the partitions are disjoint
+
+        Merge( p.assign, mAssign ); mCount += p.count;
+    }   // the critical region
+}   // end of Tally()
+
+/*
+ * parse a line of the summary; false if the record is truncated
+*/
+bool Strain::Parse(
+    char* _s,                   // line; modified in place
+    std::vector<const char*>& _f,   // fields of the line
+    unsigned int& _t,           // ncbi tid
+    stPIVOT& _p )               // aggregate of the record
+{
+    if ( Tokenize( _s, ",\t\n", _f ) < 11 )
+    {
+        return( false );
+    }   // truncated records
+
+    ( _p.site ).clear();
+    _p.ratio = static_cast<double>( ::atof( _f[ 1 ] ) );        // percent identity
+    _p.length = static_cast<unsigned int>( ::atoi( _f[ 2 ] ) ); // alignment length
+    _p.odd = static_cast<unsigned int>( ::atoi( _f[ 3 ] ) );    // mismatches
+    _p.gap = static_cast<unsigned int>( ::atoi( _f[ 4 ] ) );    // gaps
+    _p.phred = static_cast<double>( ::atof( _f[ 5 ] ) );        // read quality
+    _p.score = static_cast<unsigned int>( ::atoi( _f[ 6 ] ) );  // map quality
+    ( _p.site ).push_back( static_cast<unsigned int>( ::atoi( _f[ 7 ] ) ) );
+    _t = static_cast<unsigned int>( ::atoi( _f[ 10 ] ) );       // ncbi tid
+
+    if ( ( _f.size() > 11 ) && ( ::atoi( _f[ 11 ] ) > 1 ) )
+    {
+        ( _p.site ).push_back( static_cast<unsigned int>( ::atoi( _f[ 8 ] ) ) );
+        _p.ratio *= 2.0; _p.phred *= 2.0; _p.score *= 2;
+    }   // merged paired-end template; both segments count towards the averages
+
+    return( true );
+}   // end of Parse()
+
+/*
+ * merge the aggregates of a thread or a node; the source is consumed
+*/
+void Strain::Merge(
+    std::map<unsigned int, stPIVOT>& _s,    // source
+    std::map<unsigned int, stPIVOT>& _d )   // destination
+{
+    std::map<unsigned int, stPIVOT>::iterator j;
+
+    for ( std::map<unsigned int, stPIVOT>::iterator k = _s.begin(); !( k == _s.end() ); ++k )
+    {
+        if ( ( j = _d.find( ( *k ).first ) ) == _d.end() )
+        {
+            _d[ ( *k ).first ].swap( ( *k ).second ); continue;
+        }   // move the aggregate; the binding sites are not copied
+
+        ( *j ).second += ( *k ).second;
+    }   // merge the aggregates
+}   // end of Merge()
 
 /*
  * export the contents; just-in-time implementation
+ *
+ * the indices of the taxa are computed by one task per taxon, the taxa with
+ * the most bins first, and written in the order of the taxa
 */
-bool Strain::Output( const std::string& _f )
+bool Strain::Output(
+    const std::string& _f,      // strain level assignment
+    const bool _k )             // keep the indices and complete the stage
 {
-    const double nMIN = 70.0;
     FILE* of = ::fopen( _f.c_str(), "w" );
+    unsigned int tid, n = 0;
+    double count, wsei;
+    std::vector<Call<Strain> > task;
+    std::vector<unsigned int> order, size;
+    Scheduler s; s.SetNuma( mNuma );
 
-    mIndex.clear();
-    unsigned int tid;
-    double weight, optimal, count, block, wsei;
-
-    ::fprintf( of, "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s\n",     // header
+    ::fprintf( of, "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s",       // header
         "Taxon", "Abundance", "Shannon", "Coverage", "WSEI", "Total Bin", "Identity",
         "Alignment Length", "Mismatch", "Gap", "Read Quality", "Alignment Quality" );
+    ::fprintf( of, ( mReplicate > 0 ) ? ",%s,%s,%s,%s\n" : "\n",
+        "WSEI Low", "WSEI High", "Abundance Low", "Abundance High" );
+
+    if ( _k )
+    {
+        mIndex.clear(); mScore.clear();
+    }   // not those of a coarser level of the pyramid
+
+    if ( mReplicate > 0 )
+    {
+        Bootstrap();
+    }   // confidence intervals from the histograms
+
+    mTask.clear(); mRow.resize( mAssign.size() ); task.reserve( mAssign.size() );
 
     for ( std::map<unsigned int, stPIVOT>::iterator i = mAssign.begin(); !( i == mAssign.end() ); ++i )
+    {
+        mTask.push_back( ( *i ).first ); order.push_back( order.size() );
+        size.push_back( mCoverage.find( ( *i ).first )->second.second );
+    }   // taxa in the order of the output
+
+    std::sort( order.begin(), order.end(), SortSize( &size ) );
+
+    for ( unsigned int i = 0; i < order.size(); ++i )
+    {
+        task.push_back( Call<Strain>( this, &Strain::Index, order[ i ] ) ); s.Submit( &task.back() );
+    }   // the largest taxa first
+
+    s.Run();
+
+    for ( std::map<unsigned int, stPIVOT>::iterator i = mAssign.begin(); !( i == mAssign.end() ); ++i, ++n )
     {
         tid = ( *i ).first;
-        block = static_cast<double>( mBlock.find( tid )->second );
-        count = static_cast<double>( ( ( ( *i ).second ).site ).size() );
-        weight = Weight( ( ( *i ).second ).site, block );
-        optimal = ::log( block );
-        wsei = Shannon( ( ( *i ).second ).site, weight ) / optimal;
+        count = mRow[ n ].count; wsei = mRow[ n ].wsei;
 
-        ::fprintf( of, "%s,%d,%.2f,%.2f,%.2f,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+        ::fprintf( of, "%s,%d,%.2f,%.2f,%.2f,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f",
             ( mTaxon.find( tid )->second ).c_str(),             // taxon
-            static_cast<unsigned int>( ( ( ( *i ).second ).site ).size() ), // abundance
-            Shannon( ( ( *i ).second ).site, 1.0 ) / optimal,   // conventional shannon
-            weight, wsei,                       // coverage and wsei
+            static_cast<unsigned int>( count ),                 // abundance
+            mRow[ n ].shannon,                  // conventional shannon
+            mRow[ n ].weight, wsei,             // coverage and wsei
             mBlock.find( tid )->second,         // total number of bins
             ( ( *i ).second ).ratio / count,    // average percent identity
             ( ( *i ).second ).length / count,   // average alignment length
@@ -168,33 +828,331 @@ bool Strain::Output( const std::string& _f )
             ( ( *i ).second ).phred / count,    // average read quality
             ( ( *i ).second ).score / count );  // average alignment quality
 
-        if ( ( ( *i ).second ).ratio < ( nMIN * count ) )
+        if ( mReplicate > 0 )
+        {
+            ::fprintf( of, ",%.2f,%.2f,%.0f,%.0f",
+                mBoundIndex[ tid ].low, mBoundIndex[ tid ].high,
+                mBoundCount[ tid ].low, mBoundCount[ tid ].high );
+        }   // confidence intervals
+
+        ::fprintf( of, "\n" );
+
+        if ( !_k )
+        {
+            continue;
+        }   // a coarser level of the pyramid
+
+        mScore[ tid ] = std::make_pair( wsei, ( ( *i ).second ).ratio / count );
+
+        if ( ( ( ( *i ).second ).ratio / count ) < mIdentity )
         {
             continue;
-        }   // only keep the index if percent identity is greate than 85.0
+        }   // only keep the index if percent identity is greate than the minimum
 
         mIndex[ tid ] = wsei;
     }   // calcualte the weighted shannon index and export the contents
 
+    mTask.clear(); mRow.clear();
+
+    if ( _k )
+    {
+        mCount.output = mAssign.size(); mCount.written = ::ftell( of );
+    }   // counters of the stage
+
+    if ( _k && mReport )
+    {
+        mReport->End( mCount );
+    }   // complete the stage
+
     return( static_cast<bool>( ::fclose( of ) ) );
 }   // end of Output()
 
 /*
- * calculate the coverage for a given genome
+ * coarser levels of the histograms; a level merges the adjacent bins of
+ * every histogram, and a genome has as many bins of the level as it takes to
+ * cover its bins. the views and block sizes of the level replace those of the
+ * histograms while its table is written.
 */
-double Strain::Weight(
-    const std::vector<unsigned int>& _s,
-    const double _c ) const
+void Strain::Pyramid(
+    const std::string& _b )     // base name of the tables
 {
-    std::map<unsigned int, unsigned int> site;
+    std::map<unsigned int, std::pair<const stBIN*, unsigned int> > coverage;
+    std::map<unsigned int, std::vector<stBIN> > histogram;
+    std::map<unsigned int, unsigned int> block;
+    unsigned int factor, offset, g;
+    char name[ 64 ];
+    stBIN b;
 
-    for ( unsigned int i = 0; i < _s.size(); ++i )
+    for ( unsigned int l = 0; l < mPyramid.size(); ++l )
     {
-        ( site.find( _s[ i ] ) == site.end() ) ?
-            site[ _s[ i ] ] = 1 : site[ _s[ i ] ] += 1;     // accumulate the count
+        factor = mPyramid[ l ] / mWidth; coverage.clear(); histogram.clear(); block.clear();
+
+        for ( std::map<unsigned int, std::pair<const stBIN*, unsigned int> >::iterator i = mCoverage.begin(); !( i == mCoverage.end() ); ++i )
+        {
+            std::vector<stBIN>& h = histogram[ ( *i ).first ];
+            const std::vector<stPART>& part = mGenome.find( ( *i ).first )->second;
+            offset = 0; g = 0;
+
+            for ( unsigned int k = 0; k < ( *i ).second.second; ++k )
+            {
+                b = ( ( *i ).second.first )[ k ];
+
+                for ( ; ( g + 1 < part.size() ) && ( b.bin > part[ g ].end ); ++g )
+                {
+                    offset += Span( part[ g ], mPyramid[ l ] );
+                }   // the genome of the bin; both are sorted by bin
+
+                b.bin = offset + ( ( b.bin > part[ g ].start ) ? b.bin - part[ g ].start : 0 ) / factor;
+
+                if ( !h.empty() && ( ( h.back() ).bin == b.bin ) )
+                {
+                    ( h.back() ).count += b.count; continue;
+                }   // another bin of the same bin of the level
+
+                h.push_back( b );
+            }   // the histogram is sorted by bin, and so is the level
+
+            coverage[ ( *i ).first ] = std::make_pair( ( h.empty() ) ? NULL : &h[ 0 ], static_cast<unsigned int>( h.size() ) );
+        }   // every taxon
+
+        for ( std::map<unsigned int, std::vector<stPART> >::iterator i = mGenome.begin(); !( i == mGenome.end() ); ++i )
+        {
+            for ( g = 0, offset = 0; g < ( ( *i ).second ).size(); ++g )
+            {
+                offset += Span( ( ( *i ).second )[ g ], mPyramid[ l ] );
+            }   // the genomes of the taxon end to end
+
+            block[ ( *i ).first ] = offset;
+        }   // bins of the level of every taxon
+
+        ::snprintf( name, sizeof( name ), ".strain.%u.csv", mPyramid[ l ] );
+        mCoverage.swap( coverage ); mBlock.swap( block );
+        Output( _b + name, false );
+        mCoverage.swap( coverage ); mBlock.swap( block );
+    }   // every level, the finest first
+}   // end of Pyramid()
+
+/*
+ * bins of a genome at a coarser width, laid out from its size as
+ * SetWidth() does; never fewer than its bins of the histograms reach
+*/
+unsigned int Strain::Span(
+    const stPART& _p,           // genome
+    const unsigned int _w ) const   // width of the level in bases
+{
+    return( std::max( ( _p.size + _w - 1 ) / _w, ( _p.end - _p.start ) / ( _w / mWidth ) ) + 1 );
+}   // end of Span()
+
+/*
+ * histograms of the binding sites; the sites themselves are released. one
+ * task per taxon, the taxa with the most sites first; the histograms
+ * counted while the store was read are kept
+*/
+void Strain::Bin()
+{
+    std::deque<Call<Strain> > task;
+    Scheduler s; s.SetNuma( mNuma );
+
+    mCoverage.clear(); Queue( s, task ); s.Run(); mTask.clear();
+
+    for ( std::map<unsigned int, stPIVOT>::iterator i = mAssign.begin(); !( i == mAssign.end() ); ++i )
+    {
+        std::vector<stBIN>& h = mHistogram[ ( *i ).first ];
+
+        mCoverage[ ( *i ).first ] = std::make_pair( ( h.empty() ) ? NULL : &h[ 0 ], static_cast<unsigned int>( h.size() ) );
+    }   // every taxon
+}   // end of Bin()
+
+/*
+ * submit one task per taxon without a histogram, the taxa with the most
+ * sites first; the histograms and the taxa of the tasks are all in place
+ * before the first task is submitted, as the scheduler may be running
+*/
+void Strain::Queue(
+    Scheduler& _s,              // scheduler of the tasks
+    std::deque<Call<Strain> >& _t )     // storage of the tasks
+{
+    std::vector<unsigned int> order, size;
+    const size_t first = _t.size();
+
+    mTask.clear();
+
+    for ( std::map<unsigned int, stPIVOT>::iterator i = mAssign.begin(); !( i == mAssign.end() ); ++i )
+    {
+        if ( mHistogram.find( ( *i ).first ) == mHistogram.end() )
+        {
+            mHistogram[ ( *i ).first ].clear(); mTask.push_back( ( *i ).first );
+            size.push_back( ( ( ( *i ).second ).site ).size() ); order.push_back( order.size() );
+        }   // the histogram is created here; the tasks only fill it
+    }   // taxa without a histogram
+
+    std::sort( order.begin(), order.end(), SortSize( &size ) );
+
+    for ( unsigned int i = 0; i < order.size(); ++i )
+    {
+        _t.push_back( Call<Strain>( this, &Strain::Histogram, order[ i ] ) );
+    }   // the largest taxa first
+
+    for ( size_t i = first; i < _t.size(); ++i )
+    {
+        _s.Submit( &_t[ i ] );
+    }   // the tasks do not move once they are in the deque
+}   // end of Queue()
+
+/*
+ * task: histogram of a taxon
+*/
+void Strain::Histogram(
+    const unsigned int _i )     // taxon of the tasks
+{
+    stPIVOT& p = mAssign.find( mTask[ _i ] )->second;
+
+    Count( p.site, mHistogram.find( mTask[ _i ] )->second ); std::vector<unsigned int>().swap( p.site );
+}   // end of Histogram()
+
+/*
+ * task: indices of a taxon from its histogram
+*/
+void Strain::Index(
+    const unsigned int _i )     // taxon of the tasks
+{
+    const std::pair<const stBIN*, unsigned int>& h = mCoverage.find( mTask[ _i ] )->second;
+    const double block = static_cast<double>( mBlock.find( mTask[ _i ] )->second );
+    const double optimal = ::log( block );
+    stINDEX& r = mRow[ _i ];
+
+    r.count = 0.0;
+
+    for ( unsigned int k = 0; k < h.second; ++k )
+    {
+        r.count += ( h.first )[ k ].count;
+    }   // number of hits of the taxon
+
+    r.weight = Weight( h.second, block );
+    r.wsei = Shannon( h.first, h.second, r.weight ) / optimal;
+    r.shannon = Shannon( h.first, h.second, 1.0 ) / optimal;
+}   // end of Index()
+
+/*
+ * bootstrap replicates of the wsei and the abundance of every taxon
+ *
+ * the hits are resampled within the bins they were observed in: every hit
+ * enters a replicate a poisson number of times with mean 1, so a bin with c
+ * hits has a poisson number of hits with mean c. a bin counts once for the
+ * coverage, however many hits it draws, and drops out if it draws none, so
+ * the coverage and the wsei of a replicate stay within [0, 1]. as the bins
+ * with few hits drop out, the replicates underestimate the coverage; the
+ * interval of the wsei is therefore moved by the difference between the
+ * observed wsei and the median of the replicates, and clipped to [0, 1].
+ * the replicates run in parallel, each with its own random number stream
+*/
+void Strain::Bootstrap()
+{
+    std::vector<unsigned int> tid;
+    std::vector<std::pair<const stBIN*, unsigned int> > view;
+    std::vector<double> index, count, column;
+    double block, shift;
+
+    mBoundIndex.clear(); mBoundCount.clear();
+
+    for ( std::map<unsigned int, std::pair<const stBIN*, unsigned int> >::iterator i = mCoverage.begin(); !( i == mCoverage.end() ); ++i )
+    {
+        tid.push_back( ( *i ).first ); view.push_back( ( *i ).second );
+    }   // taxa in a fixed order
+
+    const unsigned int n = tid.size();
+    index.resize( mReplicate * n ); count.resize( mReplicate * n );
+
+    #pragma omp parallel
+    {
+        std::vector<stBIN> h;       // histogram of the replicate
+        unsigned int m; double hits, block;
+
+        #pragma omp for schedule( static )
+        for ( int b = 0; b < static_cast<int>( mReplicate ); ++b )
+        {
+            Random r = Replicate( mSeed, b );
+
+            for ( unsigned int g = 0; g < n; ++g )
+            {
+                h.clear(); hits = 0.0;
+
+                for ( unsigned int k = 0; k < view[ g ].second; ++k )
+                {
+                    if ( !( m = r.Poisson( ( view[ g ].first )[ k ].count ) ) )
+                    {
+                        continue;
+                    }   // none of the hits of the bin is drawn
+
+                    h.push_back( ( view[ g ].first )[ k ] ); ( h.back() ).count = m;
+                    hits += static_cast<double>( m );
+                }   // resample the hits of every bin; the bins stay distinct
+
+                block = static_cast<double>( mBlock.find( tid[ g ] )->second );
+                count[ b * n + g ] = hits;
+                index[ b * n + g ] = ( h.empty() ) ? 0.0 :
+                    Shannon( &h[ 0 ], h.size(), Weight( h.size(), block ) ) / ::log( block );
+            }   // every taxon
+        }   // every replicate
+    }   // end of the parallel section
+
+    column.resize( mReplicate );
+
+    for ( unsigned int g = 0; g < n; ++g )
+    {
+        for ( unsigned int b = 0; b < mReplicate; ++b )
+        {
+            column[ b ] = index[ b * n + g ];
+        }   // wsei of the replicates
+
+        block = static_cast<double>( mBlock.find( tid[ g ] )->second );
+        stBOUND& bound = mBoundIndex[ tid[ g ] ] = Bound( column, mLevel );
+        shift = ( view[ g ].second ) ? Shannon( view[ g ].first, view[ g ].second,
+            Weight( view[ g ].second, block ) ) / ::log( block ) : 0.0;
+        shift -= ( column.empty() ) ? shift : column[ column.size() / 2 ];  // sorted by Bound()
+        bound.low = std::max( 0.0, std::min( 1.0, bound.low + shift ) );
+        bound.high = std::max( 0.0, std::min( 1.0, bound.high + shift ) );
+
+        for ( unsigned int b = 0; b < mReplicate; ++b )
+        {
+            column[ b ] = count[ b * n + g ];
+        }   // abundance of the replicates
+
+        mBoundCount[ tid[ g ] ] = Bound( column, mLevel );
+    }   // intervals of every taxon
+}   // end of Bootstrap()
+
+/*
+ * count the hits of every bin; the histogram is sorted by bin
+*/
+void Strain::Count(
+    const std::vector<unsigned int>& _s,    // bins of the hits
+    std::vector<stBIN>& _h )                // histogram
+{
+    std::vector<unsigned int> site = _s;
+    stBIN b;
+
+    std::sort( site.begin(), site.end() ); _h.clear();
+
+    for ( unsigned int i = 0; i < site.size(); ++i )
+    {
+        if ( !_h.empty() && ( ( _h.back() ).bin == site[ i ] ) )
+        {
+            ( _h.back() ).count += 1; continue;
+        }   // another hit of the same bin
+
+        b.bin = site[ i ]; b.count = 1; _h.push_back( b );
     }   // accumulate the hits for each bin
+}   // end of Count()
 
-    return( site.size() / _c );
+/*
+ * calculate the coverage for a given genome
+*/
+double Strain::Weight(
+    const unsigned int _n,      // number of bins hit
+    const double _c ) const     // number of bins of the genome
+{
+    return( _n / _c );
 }   // end of Weight()
 
 /*
@@ -202,22 +1160,20 @@ double Strain::Weight(
  * default weight is 1.0, which is essentially the conventional shannon index
 */
 double Strain::Shannon(
-    const std::vector<unsigned int>& _s,
+    const stBIN* _h,            // histogram
+    const unsigned int _n,      // number of bins hit
     const double _w ) const     // weight; default 1.0
 {
-    double p, ws = 0.0;
-    double t = static_cast<double>( _s.size() );
-    std::map<unsigned int, unsigned int> site;
+    double p, t = 0.0, ws = 0.0;
 
-    for ( unsigned int i = 0; i < _s.size(); ++i )
+    for ( unsigned int k = 0; k < _n; ++k )
     {
-        ( site.find( _s[ i ] ) == site.end() ) ?
-            site[ _s[ i ] ] = 1 : site[ _s[ i ] ] += 1;     // accumulate the count
-    }   // accumulate the hits for each bin
+        t += _h[ k ].count;
+    }   // total number of hits
 
-    for ( std::map<unsigned int, unsigned int>::iterator k = site.begin(); !( k == site.end() ); ++k )
+    for ( unsigned int k = 0; k < _n; ++k )
     {
-        p = ( *k ).second / t; ws += p * ::log( p );
+        p = _h[ k ].count / t; ws += p * ::log( p );
     }   // caculate the conventional/weighted shannon index
 
     return( ::fabs( _w * ( ::log( _w ) + ws ) ) );
@@ -230,3 +1186,40 @@ const std::map<unsigned int, double>& Strain::GetIndex() const
 {
     return( mIndex );
 }   // end of GetIndex()
+
+/*
+ * weighted shannon indices of the taxa with at least the given average
+ * percent identity; the same as GetIndex() if the minimum is unchanged
+*/
+void Strain::GetIndex(
+    const double _m,                        // minimum percent identity
+    std::map<unsigned int, double>& _i ) const  // weighted shannon indices
+{
+    _i.clear();
+
+    for ( std::map<unsigned int, std::pair<double, double> >::const_iterator i = mScore.begin(); !( i == mScore.end() ); ++i )
+    {
+        if ( !( ( ( *i ).second ).second < _m ) )
+        {
+            _i.insert( _i.end(), std::make_pair( ( *i ).first, ( ( *i ).second ).first ) );
+        }   // only keep the index if percent identity is greate than the minimum
+    }   // every taxon of the strain level assignment
+}   // end of GetIndex()
+
+/*
+ * attach the instrumentation; NULL detaches it
+*/
+void Strain::SetReport(
+    Report* _r )
+{
+    mReport = _r;
+}   // end of SetReport()
+
+/*
+ * pin the threads to the numa nodes; NULL detaches it
+*/
+void Strain::SetNuma(
+    const Numa* _n )
+{
+    mNuma = _n;
+}   // end of SetNuma()
@@ -10,6 +10,35 @@
  * Richmond, VA 23298
  *
  * revised on April 15, 2013
+ *
+ * the coverage histograms of the genomes may be saved in a binary file next
+ * to the strain level assignment, sample.strain.bin; Restore() rebuilds the
+ * indices from that file alone. the file is mapped into memory as is:
+ *
+ * header: magic "MCATHIST", version, number of genomes (4 bytes each),
+ * number of histogram entries (8 bytes), width of the bins in bases and
+ * reserved (4 bytes each). the width and the bins of every genome must be
+ * those of the table and width of the run that restores the file
+ * genomes: tid, bins of the genome, histogram entries, reserved (4 bytes each),
+ * first entry, hits (8 bytes each), sums of percent identity and read
+ * quality (8 bytes each), sums of alignment length, mismatches, gaps and
+ * alignment quality (4 bytes each); 64 bytes per genome, sorted by tid
+ * histogram: bin and hits (4 bytes each), sorted by bin within a genome
+ *
+ * the records may be read from the store written by samfile --store instead
+ * of the summary; every partition holds all records of its taxa, so the
+ * threads take whole partitions and their aggregates never overlap
+ *
+ * the histograms and indices of the taxa are computed by tasks of the
+ * work-stealing scheduler, see task.h, the largest taxa first. with the
+ * store, the histograms of a partition are counted as soon as the partition
+ * has been read, while the other partitions are still being read
+ *
+ * the histograms may be coarsened into a pyramid of wider bins, e.g., 10 kb
+ * and 100 kb over the 1 kb bins of the parser: a level merges adjacent bins
+ * of the histograms, so its coverage and indices, sample.strain.10000.csv
+ * and so on, are computed without reading the records again. the indices
+ * used by the species level assignment are those of the finest bins.
 */
 
 #ifndef _STRAIN_H
@@ -17,11 +46,24 @@
 
 #include <table.h>
 #include <pivot.h>
+#include <report.h>
+#include <bootstrap.h>
+#include <placement.h>
+#include <store.h>
+#include <reader.h>
+#include <task.h>
 
 #include <map>
+#include <deque>
 #include <vector>
 #include <string>
 
+struct stBIN
+{
+    unsigned int bin;       // bin of the genome
+    unsigned int count;     // number of hits in the bin
+};  // an entry of the coverage histogram
+
 class Strain
 {
 public:
@@ -30,18 +72,145 @@ public:
 
     bool Run( const std::string& );
     const std::map<unsigned int, double>& GetIndex() const;
+    void GetIndex( const double, std::map<unsigned int, double>& ) const;
+    void SetIdentity( const double );
+    void SetHistogram( const bool );
+    void SetBootstrap( const unsigned int, const double, const uint64_t );
+    void SetReport( Report* );
+    void SetNuma( const Numa* );
+    void SetStore( const bool );
+    bool Restore( const std::string&, const bool = true );
+    void SetPyramid( const unsigned int, const std::vector<unsigned int>& );
 
 private:
+    Report* mReport;        // instrumentation; NULL if not attached
+    const Numa* mNuma;      // placement of the threads; NULL if not attached
+    double mIdentity;       // minimum average percent identity of an index
     std::map<unsigned int, double> mIndex;
+    std::map<unsigned int, std::pair<double, double> > mScore; // wsei and identity of every taxon
     std::map<unsigned int, stPIVOT> mAssign;
     std::map<unsigned int, std::string> mTaxon;
     std::map<unsigned int, unsigned int> mBlock;
 
+    struct stPART
+    {
+        unsigned int start;     // first bin of the genome
+        unsigned int end;       // last bin of the genome
+        unsigned int size;      // size of the genome in bases
+    };  // a genome of a taxon
+
+    std::map<unsigned int, std::vector<stPART> > mGenome;   // genomes of each taxon by bin
+    std::map<unsigned int, std::vector<stBIN> > mHistogram;  // coverage of each taxon
+    std::map<unsigned int, std::pair<const stBIN*, unsigned int> > mCoverage;   // view of the histograms
+    bool mSave;             // save the histograms next to the strain indices
+    bool mStore;            // read the records from sample.store if there is one
+    unsigned int mReplicate;    // number of bootstrap replicates; 0 disables
+    double mLevel;          // confidence level of the intervals
+    uint64_t mSeed;         // seed of the replicates
+    std::map<unsigned int, stBOUND> mBoundIndex;    // interval of the wsei
+    std::map<unsigned int, stBOUND> mBoundCount;    // interval of the abundance
+    stCOUNT mCount;         // counters of the stage
+    unsigned int mWidth;    // width of the bins of the histograms
+    std::vector<unsigned int> mPyramid; // widths of the coarser levels
+
+    struct stSLICE
+    {
+        stSLICE()
+        {
+            first = 0; last = 0; length = 0.0; done = true;
+        }   // default constructor
+
+        size_t first;           // first block of the partition
+        size_t last;            // one past the last block
+        double length;          // size of the lines
+        bool done;              // all blocks have been read
+        std::map<unsigned int, stPIVOT> assign;     // aggregates of the partition
+        stCOUNT count;          // counters of the partition
+    };  // a partition of the store
+
+    struct stWORKER
+    {
+        stWORKER()
+        {
+            node = 0;
+        }   // default constructor
+
+        std::map<unsigned int, stPIVOT> assign;     // aggregates of the worker
+        stCOUNT count;          // counters of the worker
+        stCOUNT mine;           // records and bytes of the worker
+        unsigned int node;      // numa node of the worker
+    };  // a worker parsing the summary
+
+    struct stINDEX
+    {
+        double count;           // number of hits
+        double weight;          // coverage
+        double shannon;         // conventional shannon index
+        double wsei;            // weighted shannon index
+    };  // indices of a taxon
+
+    /*
+     * taxa by their number of sites or bins, the largest first
+    */
+    struct SortSize
+    {
+        SortSize( const std::vector<unsigned int>* _s ) : s( _s ) {}
+
+        bool operator()( const unsigned int _a, const unsigned int _b ) const
+        {
+            return( ( ( *s )[ _a ] == ( *s )[ _b ] ) ? ( _a < _b ) : ( ( *s )[ _a ] > ( *s )[ _b ] ) );
+        }   // end of operator overloading
+
+        const std::vector<unsigned int>* s;
+    };  // end of class SortSize
+
+    /*
+     * genomes of a taxon in the order of their bins
+    */
+    struct SortPart
+    {
+        bool operator()( const stPART& _a, const stPART& _b ) const
+        {
+            return( _a.start < _b.start );
+        }   // end of operator overloading
+    };  // end of class SortPart
+
+    const Store* mSource;               // store read by the tasks; NULL if not used
+    std::vector<stSLICE> mSlice;        // partitions of the store
+    Reader* mReader;                    // summary read by the tasks; NULL if not used
+    Scheduler* mScheduler;              // scheduler of the tasks of the summary
+    std::deque<Call<Strain> > mStep;    // tasks of the blocks of the summary
+    std::deque<std::string> mText;      // blocks of the summary not parsed yet
+    std::vector<stWORKER> mWorker;      // aggregates of every worker
+    std::vector<unsigned int> mTask;    // taxa of the tasks
+    std::vector<stINDEX> mRow;          // indices of the taxa of the tasks
+
+    friend class Kernel;    // microbenchmarks of the index kernels
+    friend class Online;    // online assignment updates the histograms as reads arrive
+
     bool Assign( const std::string& );
-    bool Output( const std::string& );
+    bool Partition( const std::string&, const std::string& );
+    bool Output( const std::string&, const bool = true );
+    void Pyramid( const std::string& );
+    unsigned int Span( const stPART&, const unsigned int ) const;
+    bool Save( const std::string& ) const;
+    bool Plot( const std::string& ) const;
+    void Bin();
+    void Bootstrap();
+    void Queue( Scheduler&, std::deque<Call<Strain> >& );
+    void Feed( const unsigned int );
+    void Scan( const unsigned int );
+    void Gather( const unsigned int );
+    void Slice( const unsigned int );
+    void Tally( const unsigned int );
+    void Histogram( const unsigned int );
+    void Index( const unsigned int );
 
-    double Weight( const std::vector<unsigned int>&, const double ) const;
-    double Shannon( const std::vector<unsigned int>&, const double = 1.0 ) const;
+    static void Merge( std::map<unsigned int, stPIVOT>&, std::map<unsigned int, stPIVOT>& );
+    static bool Parse( char*, std::vector<const char*>&, unsigned int&, stPIVOT& );
+    static void Count( const std::vector<unsigned int>&, std::vector<stBIN>& );
+    double Weight( const unsigned int, const double ) const;
+    double Shannon( const stBIN*, const unsigned int, const double = 1.0 ) const;
 };  // end of class definition
 
 #endif  // _ASSIGN_H
@@ -0,0 +1,289 @@
+/*
+ * sweep.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * species level assignment over a grid of thresholds
+*/
+
+#include <token.h>
+#include <reader.h>
+#include <sweep.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+
+Sweep::Sweep(
+    const std::map<unsigned int, stTABLE>& _t,
+    const Strain& _s ) : mTable( _t ), mStrain( _s ), mRead( Codec::Order( &mCodec ) )
+{
+    mGrid.clear(); mRead.clear(); mOwner.clear(); mCandidate.clear();
+    mTables = false; mReport = NULL;
+}   // default constructor
+
+Sweep::~Sweep()
+{
+    mGrid.clear(); mRead.clear(); mOwner.clear(); mCandidate.clear();
+}   // default destructor; environmentally conscientious
+
+/*
+ * every combination of the thresholds is evaluated
+*/
+void Sweep::SetGrid(
+    const std::vector<double>& _s,      // minimum strain identities
+    const std::vector<double>& _w,      // minimum weighted shannon indices
+    const std::vector<double>& _i )     // minimum percent identities
+{
+    stGRID g;
+    mGrid.clear();
+
+    for ( unsigned int i = 0; i < _s.size(); ++i )
+    {
+        for ( unsigned int j = 0; j < _w.size(); ++j )
+        {
+            for ( unsigned int k = 0; k < _i.size(); ++k )
+            {
+                g.strain = _s[ i ]; g.index = _w[ j ]; g.identity = _i[ k ];
+                mGrid.push_back( g );
+            }   // minimum percent identity
+        }   // minimum weighted shannon index
+    }   // minimum strain identity
+}   // end of SetGrid()
+
+/*
+ * write one pivot table per combination besides the combined table
+*/
+void Sweep::SetTables(
+    const bool _t )
+{
+    mTables = _t;
+}   // end of SetTables()
+
+/*
+ * attach the instrumentation; NULL detaches it
+*/
+void Sweep::SetReport(
+    Report* _r )
+{
+    mReport = _r;
+}   // end of SetReport()
+
+/*
+ * sample.summary.csv produces sample.sweep.csv, the pivots of all
+ * combinations in long format; with SetTables(), every combination is also
+ * written as sample.pivot.70_0.15_85.csv, i.e., minimum strain identity,
+ * minimum weighted shannon index and minimum percent identity
+*/
+bool Sweep::Run( const std::string& _f )
+{
+    const char* szDELIMIT = ".\n";
+    std::vector<std::string> field;
+    std::string base, file;
+
+    boost::algorithm::split(                // splite the entire string
+        field, _f, boost::algorithm::is_any_of( szDELIMIT ) );
+    base = field[ 0 ]; file = base + ".sweep.csv";
+
+    if ( mReport )
+    {
+        mReport->Begin( "sweep", _f );
+    }   // instrumentation of the stage
+
+    if ( mGrid.empty() || !Load( _f ) )
+    {
+        return( false );
+    }   // nothing to evaluate
+
+    std::vector<std::map<std::string, stPIVOT> > pivot( mGrid.size() );
+
+    #pragma omp parallel for schedule( dynamic )
+    for ( int k = 0; k < static_cast<int>( mGrid.size() ); ++k )
+    {
+        std::map<unsigned int, double> weight;
+
+        mStrain.GetIndex( mGrid[ k ].strain, weight );
+        Species q( mTable, weight );
+        q.SetThreshold( mGrid[ k ].index, mGrid[ k ].identity );
+        Resolve( q );
+
+        if ( mTables )
+        {
+            q.Output( GetName( base, mGrid[ k ] ) );
+        }   // pivot table of the combination
+
+        pivot[ k ].swap( q.mPivot );
+    }   // every combination of the thresholds
+
+    FILE* of = ::fopen( file.c_str(), "w" );
+    double count;
+
+    if ( !of )
+    {
+        mRead.clear(); mOwner.clear(); mCandidate.clear(); return( false );
+    }   // unable to write the sweep
+
+    ::fprintf( of, "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s\n",   // header
+        "Minimum Strain Identity", "Minimum Index", "Minimum Identity", "Taxon", "Abundance", "Identity",
+        "Alignment Length", "Mismatch", "Gap", "Read Quality", "Alignment Quality" );
+
+    for ( unsigned int k = 0; k < mGrid.size(); ++k )
+    {
+        for ( std::map<std::string, stPIVOT>::iterator j = pivot[ k ].begin(); !( j == pivot[ k ].end() ); ++j )
+        {
+            count = static_cast<double>( ( ( ( *j ).second ).site ).size() );
+
+            ::fprintf( of, "%g,%g,%g,%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+                mGrid[ k ].strain, mGrid[ k ].index, mGrid[ k ].identity,
+                ( ( *j ).first ).c_str(),           // taxon
+                static_cast<unsigned int>( ( ( ( *j ).second ).site ).size() ), // abundance
+                ( ( *j ).second ).ratio / count,    // average percent identity
+                ( ( *j ).second ).length / count,   // average alignment length
+                ( ( *j ).second ).odd / count,      // average number of mismatches
+                ( ( *j ).second ).gap / count,      // average number of gaps
+                ( ( *j ).second ).phred / count,    // average read quality
+                ( ( *j ).second ).score / count );  // average alignment quality
+
+            mCount.output += 1.0;
+        }   // every species of the combination
+
+        mCount.written += ( mTables ) ? Report::GetSize( GetName( base, mGrid[ k ] ) ) : 0.0;
+    }   // every combination of the thresholds
+
+    mCount.written += ::ftell( of );
+    ::fclose( of ); mRead.clear(); mOwner.clear(); mCandidate.clear();
+
+    if ( mReport )
+    {
+        mReport->End( mCount );
+    }   // complete the stage
+
+    return( true );
+}   // end of Run()
+
+/*
+ * read the candidates that pass the loosest thresholds of the grid
+*/
+bool Sweep::Load( const std::string& _f )
+{
+    const char* szDELIMIT = ",\t\n";
+    double strain = mGrid[ 0 ].strain, index = mGrid[ 0 ].index, identity = mGrid[ 0 ].identity;
+    std::map<unsigned int, double> weight;
+    std::map<unsigned int, std::string>::const_iterator k;
+    std::map<uint64_t, unsigned int, Codec::Order>::iterator r;
+    std::vector<const char*> field;
+    std::string line;
+    uint64_t rid;
+    stPIVOT set;
+
+    Reader ifs( _f );
+    Codec codec;
+    mRead.clear(); mOwner.clear(); mCandidate.clear(); mCount = stCOUNT(); mCodec.swap( codec );
+
+    if ( !ifs.IsOpen() )
+    {
+        return( false );
+    }   // check the state of stream
+
+    for ( unsigned int i = 1; i < mGrid.size(); ++i )
+    {
+        strain = std::min( strain, mGrid[ i ].strain );
+        index = std::min( index, mGrid[ i ].index );
+        identity = std::min( identity, mGrid[ i ].identity );
+    }   // the loosest thresholds
+
+    mStrain.GetIndex( strain, weight );
+    Species q( mTable, weight ); q.SetThreshold( index, identity );
+
+    ifs.GetLine( line );    // skip the header
+    mCount.bytes = line.size() + 1;
+
+    while ( ifs.GetLine( line ) )
+    {
+        mCount.records += 1.0; mCount.bytes += line.size() + 1;
+
+        if ( mReport )
+        {
+            mReport->Progress( mCount );
+        }   // periodic progress
+
+        if ( line.empty() || ( Tokenize( &line[ 0 ], szDELIMIT, field ) < 11 ) )
+        {
+            mCount.reject[ nREJECT_FIELD ] += 1.0; continue;
+        }   // truncated records
+
+        set.tid = static_cast<unsigned int>( ::atoi( field[ 10 ] ) );   // ncbi tid
+
+        if ( ( ( k = ( q.mTaxon ).find( set.tid ) ) == ( q.mTaxon ).end() ) ||
+            ( ( q.mIndex ).find( ( *k ).second ) == ( q.mIndex ).end() ) )
+        {
+            mCount.reject[ nREJECT_INDEX ] += 1.0; continue;
+        }   // histogram not aviable for any combination
+
+        set.ratio = static_cast<double>( ::atof( field[ 1 ] ) );        // percent identity
+
+        if ( set.ratio < identity )
+        {
+            mCount.reject[ nREJECT_IDENTITY ] += 1.0; continue;
+        }   // alignment is not good enough for any combination
+
+        set.length = static_cast<unsigned int>( ::atoi( field[ 2 ] ) ); // alignment length
+        set.odd = static_cast<unsigned int>( ::atoi( field[ 3 ] ) );    // mismatches
+        set.gap = static_cast<unsigned int>( ::atoi( field[ 4 ] ) );    // gaps
+        set.phred = static_cast<double>( ::atof( field[ 5 ] ) );        // read quality
+        set.score = static_cast<unsigned int>( ::atoi( field[ 6 ] ) );  // map quality
+
+        if ( ( r = mRead.find( rid = mCodec.Encode( field[ 0 ], ::strlen( field[ 0 ] ) ) ) ) == mRead.end() )
+        {
+            r = mRead.insert( std::make_pair( rid, static_cast<unsigned int>( mRead.size() ) ) ).first;
+        }   // the first candidate of the read
+
+        mOwner.push_back( ( *r ).second ); mCandidate.push_back( set );
+    }   // keep the candidates in the order of the file
+
+    return( true );
+}   // end of Load()
+
+/*
+ * resolve the candidates with the thresholds of the species level
+ * assignment and summarize the reads in the order of their identification,
+ * the same as Species::Profile()
+*/
+void Sweep::Resolve( Species& _q ) const
+{
+    const size_t none = mCandidate.size();
+    std::vector<size_t> best( mRead.size(), none );
+
+    _q.Resolve( mOwner, mCandidate, best );
+
+    for ( std::map<uint64_t, unsigned int, Codec::Order>::const_iterator r = mRead.begin(); !( r == mRead.end() ); ++r )
+    {
+        if ( !( best[ ( *r ).second ] == none ) )
+        {
+            const stPIVOT& p = mCandidate[ best[ ( *r ).second ] ];
+            _q.Summarize( ( _q.mTaxon ).find( p.tid )->second, p );
+        }   // the read is assigned
+    }   // every read with a candidate
+}   // end of Resolve()
+
+/*
+ * name of the pivot table of a combination
+*/
+std::string Sweep::GetName(
+    const std::string& _b,      // base name of the summary file
+    const stGRID& _g ) const    // combination of the thresholds
+{
+    char name[ 64 ];
+
+    ::snprintf( name, sizeof( name ), ".pivot.%g_%g_%g.csv", _g.strain, _g.index, _g.identity );
+
+    return( _b + name );
+}   // end of GetName()
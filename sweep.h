@@ -0,0 +1,76 @@
+/*
+ * sweep.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * species level assignment over a grid of thresholds
+ *
+ * the summary file is read once. every candidate that passes the loosest
+ * thresholds of the grid is kept in the order of the file, with the read
+ * identification replaced by the number of the read. every combination of
+ * the minimum strain identity, the minimum weighted shannon index and the
+ * minimum percent identity then re-resolves the candidates in parallel,
+ * with the same rules as the species level assignment, so each pivot is
+ * identical to that of a separate run with the same thresholds.
+*/
+
+#ifndef _SWEEP_H
+#define _SWEEP_H
+
+#include <table.h>
+#include <pivot.h>
+#include <strain.h>
+#include <report.h>
+#include <species.h>
+
+#include <map>
+#include <vector>
+#include <string>
+
+class Sweep
+{
+public:
+    Sweep(
+        const std::map<unsigned int, stTABLE>&,     // translate table
+        const Strain& );                            // strain level assignment
+    ~Sweep();
+
+    bool Run( const std::string& );
+    void SetGrid(
+        const std::vector<double>&,     // minimum strain identities
+        const std::vector<double>&,     // minimum weighted shannon indices
+        const std::vector<double>& );   // minimum percent identities
+    void SetTables( const bool );
+    void SetReport( Report* );
+
+private:
+    struct stGRID
+    {
+        double strain;      // minimum average identity of a strain
+        double index;       // minimum weighted shannon index
+        double identity;    // minimum percent identity of a candidate
+    };  // a combination of the thresholds
+
+    const std::map<unsigned int, stTABLE>& mTable;
+    const Strain& mStrain;
+    std::vector<stGRID> mGrid;
+    Codec mCodec;                               // keys of the read identifications
+    std::map<uint64_t, unsigned int, Codec::Order> mRead;   // number of each read
+    std::vector<unsigned int> mOwner;           // read of each candidate
+    std::vector<stPIVOT> mCandidate;            // candidates in the order of the file
+    bool mTables;           // one pivot table per combination
+    Report* mReport;        // instrumentation; NULL if not attached
+    stCOUNT mCount;         // counters of the stage
+
+    bool Load( const std::string& );
+    void Resolve( Species& ) const;
+    std::string GetName( const std::string&, const stGRID& ) const;
+};  // end of class definition
+
+#endif  // _SWEEP_H
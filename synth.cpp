@@ -0,0 +1,274 @@
+/*
+ * synth.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * synthetic translation table and bowtie2-like alignment file
+ *
+ * genomes are grouped into species of a few strains each, and receive reads
+ * with skewed (zipf) abundances. every read is aligned to its genome of
+ * origin; a fraction of the reads also has secondary hits, mostly to other
+ * strains of the same species, as bowtie2 reports them with -k. all hits of
+ * a read are written consecutively. mismatches are drawn per aligned base
+ * from the given identity and recorded in both the MD tag and NM/XM.
+ *
+ * the output only depends on the parameters and the seed, so the same data
+ * set can be regenerated to reproduce a benchmark.
+ *
+ * to compile:
+ * g++ -I. -O3 synth.cpp -o synth
+*/
+
+#include <option.h>
+#include <random.h>
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+struct stGENOME
+{
+    unsigned int gid;       // ncbi genome identification
+    unsigned int tid;       // ncbi taxonomy identification
+    unsigned int size;      // size of genome
+    unsigned int start;     // start of histogram bin
+    unsigned int end;       // end of histogram bin
+    unsigned int species;   // index of the species
+};  // synthetic genome
+
+struct stSYNTH
+{
+    unsigned int reads;     // number of reads (templates)
+    unsigned int genomes;   // number of genomes
+    unsigned int strains;   // number of strains per species
+    unsigned int length;    // read length
+    unsigned int hits;      // maximum number of secondary hits
+    double identity;        // expected percent identity of the primary hit
+    double multi;           // fraction of reads with secondary hits
+    double unmapped;        // fraction of unmapped reads
+    bool paired;            // paired-end reads
+};  // parameters of the data set
+
+/*
+ * write the translation table
+ * the bins follow the 1 kb histogram of the parser
+*/
+static void Table(
+    const std::string& _f,
+    std::vector<stGENOME>& _g,
+    const stSYNTH& _p,
+    Random& _r )
+{
+    FILE* of = ::fopen( _f.c_str(), "w" );
+    unsigned int start = 0;
+
+    ::fprintf( of, "%s,%s,%s,%s,%s,%s,%s\n",
+        "GID", "TID", "Size", "Start", "End", "Strain", "Species" );
+
+    for ( unsigned int i = 0; i < _p.genomes; ++i )
+    {
+        stGENOME g;
+        g.gid = 100000 + i * 7; g.tid = 2000 + i;
+        g.species = i / _p.strains;
+        g.size = 1000000 + _r.Range( 5000000 );
+        g.start = start;
+        g.end = start + static_cast<unsigned int>( ::lrint( g.size * 0.001 ) );
+        start = g.end + 1; _g.push_back( g );
+
+        ::fprintf( of, "%d,%d,%d,%d,%d,\"Synthetica strain %d\",\"Synthetica species %d\"\n",
+            g.gid, g.tid, g.size, g.start, g.end, g.tid, g.species );
+    }   // genomes with random sizes
+
+    ::fclose( of );
+}   // end of Table()
+
+/*
+ * write a single segment
+*/
+static void Segment(
+    FILE* _f,
+    const char* _q,             // query name
+    const unsigned int _flag,   // alignment flag
+    const stGENOME& _g,         // target genome
+    const unsigned int _pos,    // 1-base leftmost position
+    const int _tlen,            // template length
+    const unsigned int _pnext,  // position of the mate
+    const double _identity,     // expected percent identity
+    const stSYNTH& _p,
+    Random& _r )
+{
+    const char* base = "ACGT";
+    std::string seq( _p.length, 'A' ), qual( _p.length, 'I' ), md;
+    unsigned int clip = ( _r.Uniform() < 0.2 ) ? 1 + _r.Range( 15 ) : 0;
+    unsigned int match = _p.length - clip, run = 0, odd = 0;
+    char cigar[ 64 ], number[ 16 ];
+
+    for ( unsigned int i = 0; i < _p.length; ++i )
+    {
+        seq[ i ] = base[ _r.Range( 4 ) ];
+        qual[ i ] = static_cast<char>( 33 + 20 + _r.Range( 21 ) );
+    }   // random bases and qualities
+
+    for ( unsigned int i = 0; i < match; ++i )
+    {
+        if ( _r.Uniform() < _identity )
+        {
+            ++run; continue;
+        }   // matching base
+
+        ::sprintf( number, "%d", run ); md += number;
+        md.push_back( base[ _r.Range( 4 ) ] ); run = 0; ++odd;
+    }   // mismatches of the aligned bases
+
+    ::sprintf( number, "%d", run ); md += number;
+    ( clip ) ? ::sprintf( cigar, "%dS%dM", clip, match ) : ::sprintf( cigar, "%dM", match );
+
+    ::fprintf( _f, "%s\t%d\tgi|%d|ref|NC_%06d.1|\t%d\t%d\t%s\t%s\t%d\t%d\t%s\t%s\t"
+        "AS:i:%d\tXN:i:0\tXM:i:%d\tXO:i:0\tXG:i:0\tNM:i:%d\tMD:Z:%s\tYT:Z:%s\n",
+        _q, _flag, _g.gid, _g.tid, _pos, ( odd > 5 ) ? 1 : 42 - odd * 6, cigar,
+        ( _p.paired ) ? "=" : "*", _pnext, _tlen, seq.c_str(), qual.c_str(),
+        2 * match - 6 * odd, odd, odd, md.c_str(), ( _p.paired ) ? "CP" : "UU" );
+}   // end of Segment()
+
+/*
+ * write the alignments
+*/
+static void Align(
+    const std::string& _f,
+    const std::vector<stGENOME>& _g,
+    const stSYNTH& _p,
+    Random& _r )
+{
+    FILE* of = ::fopen( _f.c_str(), "w" );
+    std::vector<double> weight( _g.size() );
+    std::vector<unsigned int> hit;
+    unsigned int k, pos, insert, flag;
+    double identity;
+    char qname[ 128 ];
+
+    for ( unsigned int i = 0; i < _g.size(); ++i )
+    {
+        weight[ i ] = ( ( i > 0 ) ? weight[ i - 1 ] : 0.0 ) + 1.0 / ::pow( i + 1.0, 1.2 );
+    }   // cumulative zipf abundances
+
+    ::fprintf( of, "@HD\tVN:1.0\tSO:unsorted\n" );
+
+    for ( unsigned int i = 0; i < _g.size(); ++i )
+    {
+        ::fprintf( of, "@SQ\tSN:gi|%d|ref|NC_%06d.1|\tLN:%d\n", _g[ i ].gid, _g[ i ].tid, _g[ i ].size );
+    }   // reference sequences
+
+    ::fprintf( of, "@PG\tID:bowtie2\tPN:bowtie2\tVN:2.2.5\tCL:\"synth\"\n" );
+
+    for ( unsigned int i = 0; i < _p.reads; ++i )
+    {
+        ::sprintf( qname, "HWI-ST%d:%d:C%dACXX:%d:%d:%d:%d",
+            1234, 8, 1000 + i / 4000000, 1 + ( i * 8 ) / _p.reads,
+            1101 + _r.Range( 16 ) * 100 + _r.Range( 16 ), 1000 + _r.Range( 20000 ), 1000 + _r.Range( 200000 ) );
+
+        if ( _r.Uniform() < _p.unmapped )
+        {
+            ::fprintf( of, "%s\t%d\t*\t0\t0\t*\t*\t0\t0\t%s\t%s\tYT:Z:UU\n",
+                qname, ( _p.paired ) ? 77 : 4,
+                std::string( _p.length, 'N' ).c_str(), std::string( _p.length, '#' ).c_str() );
+
+            if ( _p.paired )
+            {
+                ::fprintf( of, "%s\t%d\t*\t0\t0\t*\t*\t0\t0\t%s\t%s\tYT:Z:UP\n",
+                    qname, 141, std::string( _p.length, 'N' ).c_str(), std::string( _p.length, '#' ).c_str() );
+            }   // the mate is unmapped as well
+
+            continue;
+        }   // unmapped read
+
+        hit.clear();
+        hit.push_back( std::upper_bound( weight.begin(), weight.end(),
+            _r.Uniform() * weight.back() ) - weight.begin() );
+
+        for ( unsigned int j = ( _r.Uniform() < _p.multi ) ? 1 + _r.Range( _p.hits ) : 0; j > 0; --j )
+        {
+            k = ( _r.Uniform() < 0.7 ) ?
+                _g[ hit[ 0 ] ].species * _p.strains + _r.Range( _p.strains ) : _r.Range( _g.size() );
+            hit.push_back( std::min<unsigned int>( k, _g.size() - 1 ) );
+        }   // secondary hits; mostly strains of the same species
+
+        for ( unsigned int j = 0; j < hit.size(); ++j )
+        {
+            const stGENOME& g = _g[ hit[ j ] ];
+            identity = ( j == 0 ) ? _p.identity : _p.identity - 0.02 * _r.Uniform();
+            insert = 250 + _r.Range( 100 );
+            pos = 1 + _r.Range( g.size - insert - _p.length );
+            flag = ( j > 0 ) ? 0x100 : 0;
+
+            if ( !_p.paired )
+            {
+                Segment( of, qname, flag, g, pos, 0, 0, identity, _p, _r ); continue;
+            }   // single-end read
+
+            Segment( of, qname, flag | 0x01 | 0x02 | 0x20 | 0x40, g, pos,
+                static_cast<int>( insert ), pos + insert - _p.length, identity, _p, _r );
+            Segment( of, qname, flag | 0x01 | 0x02 | 0x10 | 0x80, g, pos + insert - _p.length,
+                -static_cast<int>( insert ), pos, identity, _p, _r );
+        }   // write the hits of the read consecutively
+    }   // generate the reads
+
+    ::fclose( of );
+}   // end of Align()
+
+/*
+ * driver program
+ *
+ * required parameters:
+ * translation table to be written
+ * alignment file to be written
+ *
+ * optional parameters:
+ * --reads=N        number of reads or templates; default 100000
+ * --genomes=N      number of genomes; default 100
+ * --strains=N      number of strains per species; default 3
+ * --length=N       read length; default 100
+ * --identity=F     expected percent identity as a fraction; default 0.97
+ * --multi=F        fraction of reads with secondary hits; default 0.3
+ * --hits=N         maximum number of secondary hits; default 4
+ * --unmapped=F     fraction of unmapped reads; default 0.05
+ * --paired         paired-end reads
+ * --seed=N         seed of the random numbers; default 1
+*/
+int main( int argc, char** argv )
+{
+    Option opt( argc, argv,
+        "reads,genomes,strains,length,identity,multi,hits,unmapped,seed" );
+    const std::vector<std::string>& arg = opt.GetArgs();
+    std::vector<stGENOME> genome;
+    stSYNTH p;
+
+    if ( arg.size() < 2 )
+    {
+        ::fprintf( stderr, "usage: synth [options] translate.csv sample.sam\n" );
+        return( 1 );
+    }   // check the number of parameters
+
+    p.reads = opt.GetSize( "reads", 100000 );
+    p.genomes = std::max<unsigned int>( 1, opt.GetSize( "genomes", 100 ) );
+    p.strains = std::max<unsigned int>( 1, opt.GetSize( "strains", 3 ) );
+    p.length = std::max<unsigned int>( 20, opt.GetSize( "length", 100 ) );
+    p.hits = std::max<unsigned int>( 1, opt.GetSize( "hits", 4 ) );
+    p.identity = opt.GetReal( "identity", 0.97 );
+    p.multi = opt.GetReal( "multi", 0.3 );
+    p.unmapped = opt.GetReal( "unmapped", 0.05 );
+    p.paired = opt.Has( "paired" );
+
+    Random r( opt.GetSize( "seed", 1 ) );
+    Table( arg[ 0 ], genome, p, r );
+    Align( arg[ 1 ], genome, p, r );
+
+    return( 0 );
+}   // end of main()
@@ -17,17 +17,33 @@
  * revised on February 5, 2013
  * revised on February 26, 2013
  * revised on April 10, 2013
+ *
+ * the columns after the species name, if any, are the lineage of the genome
+ * from the genus upwards, e.g., genus, family, order; the header names the
+ * ranks. an empty column leaves the rank unknown.
+ *
+ * the start and end bins of the table are in 1 kb bins; for another width
+ * of the histograms, SetWidth() lays them out again from the genome sizes,
+ * so the parser and the assignments, given the same width, agree on the
+ * bins of every genome
 */
 
 #ifndef _TABLE_H   // only load it once
 #define _TABLE_H
 
+#include <reader.h>
+
 // c++ specific headers
+#include <map>
 #include <vector>
 #include <string>
+#include <cmath>
 #include <cstring>
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 
+static const unsigned int nBinWIDTH = 1000;     // width of the bins of the table
+
 struct stTABLE
 {
     stTABLE( const stTABLE& _t )
@@ -45,9 +61,30 @@ struct stTABLE
         strain.clear(); species.clear();
     }   // default constructor
 
+#if __cplusplus >= 201103L
+    stTABLE( stTABLE&& _t )
+    {
+        swap( _t );
+    }   // move constructor
+
+    stTABLE& operator=( stTABLE&& _t )
+    {
+        swap( _t ); return( *this );
+    }   // move assignment
+#endif
+
+    void swap( stTABLE& _t )
+    {
+        std::swap( gid, _t.gid ); std::swap( tid, _t.tid );
+        std::swap( start, _t.start ); std::swap( end, _t.end );
+        std::swap( size, _t.size );
+        strain.swap( _t.strain ); species.swap( _t.species );
+        lineage.swap( _t.lineage );
+    }   // exchange the contents without copying the names
+
     ~stTABLE()
     {
-        strain.clear(); species.clear();
+        strain.clear(); species.clear(); lineage.clear();
     }  // default destructor; environmentally conscientious
 
     const stTABLE& operator=( const stTABLE& _t )
@@ -57,6 +94,7 @@ struct stTABLE
         size = _t.size;                 // size of genome
         strain = _t.strain;             // strain name
         species = _t.species;           // species name
+        lineage = _t.lineage;           // higher ranks
 
         return( *this );
     }   // end of operator overloading
@@ -75,6 +113,12 @@ struct stTABLE
         start = static_cast<unsigned int>( ::atoi( field[ 3 ].c_str() ) );  // start of bin
         end = static_cast<unsigned int>( ::atoi( field[ 4 ].c_str() ) );    // end of bin
         strain = field[ 5 ]; species = field[ 6 ];
+        lineage.assign( field.begin() + std::min<size_t>( field.size(), 7 ), field.end() );
+
+        while ( !lineage.empty() && ( lineage.back() ).empty() )
+        {
+            lineage.pop_back();
+        }   // the newline and trailing ranks that are unknown
 /*
         // keep the quotation marks around strings?
         boost::algorithm::trim_if( strain, boost::algorithm::is_any_of( "\"" ) );
@@ -90,6 +134,79 @@ struct stTABLE
     unsigned int end;       // end of histogram bin
     std::string strain;     // strain name
     std::string species;    // species name
+    std::vector<std::string> lineage;   // names of the higher ranks; may be empty
 };  // smart container
 
+/*
+ * load the translation table, indexed by ncbi gid
+ * the first line of the file is the header; it names the ranks of the lineage
+*/
+inline bool LoadTable(
+    const std::string& _f,                  // name of translation table
+    std::map<unsigned int, stTABLE>& _t,    // translation table
+    std::vector<std::string>* _r = NULL )   // names of the ranks of the lineage
+{
+    stTABLE a;
+    std::string line;
+    Reader ifs( _f );
+
+    if ( !ifs.IsOpen() )
+    {
+        return( false );
+    }   // check the state of stream
+
+    ifs.GetLine( line );                // the header
+
+    if ( _r )
+    {
+        a = line; _r->swap( a.lineage );
+    }   // columns after the species name
+
+    while ( ifs.GetLine( line ) )
+    {
+        if ( line.empty() )
+        {
+            continue;
+        }   // blank line
+
+        a = line; _t[ a.gid ].swap( a );
+    }   // parse the file
+
+    return( true );
+}   // end of LoadTable()
+
+/*
+ * lay the bins of the genomes out for histograms of another width in bases,
+ * in the order of the table: a genome of size bases ends ceil(size / width)
+ * bins after its start, which holds the last bin of the parser, and the
+ * next genome starts right after it. the table is unchanged for the width
+ * of its own bins.
+*/
+inline void SetWidth(
+    std::map<unsigned int, stTABLE>& _t,    // translation table
+    const unsigned int _w )                 // width of a bin
+{
+    std::vector<std::pair<unsigned int, unsigned int> > order;  // start and gid
+    unsigned int start = 0;
+
+    if ( !_w || ( _w == nBinWIDTH ) )
+    {
+        return;
+    }   // the bins of the table
+
+    for ( std::map<unsigned int, stTABLE>::iterator i = _t.begin(); !( i == _t.end() ); ++i )
+    {
+        order.push_back( std::make_pair( ( ( *i ).second ).start, ( *i ).first ) );
+    }   // every genome of the table
+
+    std::sort( order.begin(), order.end() );
+
+    for ( unsigned int i = 0; i < order.size(); ++i )
+    {
+        stTABLE& t = _t[ order[ i ].second ];
+
+        t.start = start; t.end = start + ( t.size + _w - 1 ) / _w; start = t.end + 1;
+    }   // the genomes end to end
+}   // end of SetWidth()
+
 #endif  // _TABLE_H
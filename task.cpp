@@ -0,0 +1,222 @@
+/*
+ * task.cpp
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * work-stealing scheduler of small tasks
+*/
+
+#include <task.h>
+
+Task::Task()
+{
+    mWait = 0;
+}   // default constructor
+
+Task::~Task()
+{
+    mNext.clear();
+}   // default destructor; environmentally conscientious
+
+/*
+ * the task _t runs only after this one; _t may already be waiting for a
+ * running task, which then adds the predecessors of _t as it goes
+*/
+void Task::Then(
+    Task* _t )
+{
+    mNext.push_back( _t ); __sync_add_and_fetch( &_t->mWait, 1 );
+}   // end of Then()
+
+Scheduler::Scheduler()
+{
+    mNuma = NULL; mRunning = false; mPending = 0; mQueued = 0; mSteals = 0.0;
+}   // default constructor
+
+Scheduler::~Scheduler()
+{
+    mReady.clear(); mQueue.clear();
+}   // default destructor; environmentally conscientious
+
+/*
+ * pin the workers to the numa nodes; NULL detaches it
+*/
+void Scheduler::SetNuma(
+    const Numa* _n )
+{
+    mNuma = _n;
+}   // end of SetNuma()
+
+/*
+ * tasks taken from another worker in the last run
+*/
+double Scheduler::GetSteals() const
+{
+    return( mSteals );
+}   // end of GetSteals()
+
+/*
+ * submit a task; it is held until its predecessors have run. a task
+ * submitted by a running task goes to the deque of its worker.
+*/
+void Scheduler::Submit(
+    Task* _t )
+{
+    __sync_add_and_fetch( &mPending, 1 );
+
+    if ( _t->mWait > 0 )
+    {
+        return;
+    }   // released by its last predecessor
+
+    ( mRunning ) ? Push( ::omp_get_thread_num(), _t ) : mReady.push_back( _t );
+}   // end of Submit()
+
+/*
+ * run all tasks, including those submitted while running, and return once
+ * all of them are done
+*/
+void Scheduler::Run()
+{
+    const unsigned int n = ::omp_get_max_threads();
+
+    mQueue.assign( n, stQUEUE() ); mSteals = 0.0;
+
+    for ( unsigned int i = 0; i < n; ++i )
+    {
+        ::omp_init_lock( &mQueue[ i ].lock );
+    }   // one lock per deque
+
+    for ( unsigned int i = mReady.size(); i > 0; --i )
+    {
+        mQueue[ ( i - 1 ) % n ].task.push_back( mReady[ i - 1 ] );
+    }   // dealt out in reverse; the first tasks are at the back of the deques
+
+    ::pthread_mutex_init( &mMutex, NULL ); ::pthread_cond_init( &mIdle, NULL );
+    mQueued = mReady.size(); mReady.clear(); mRunning = true;
+
+    #pragma omp parallel
+    {
+        const unsigned int self = ::omp_get_thread_num();
+        unsigned int victim = self;     // last worker robbed
+        double steals = 0.0;
+        Task* t = NULL;
+
+        if ( mNuma )
+        {
+            mNuma->Bind();
+        }   // the same placement as the other stages
+
+        while ( __sync_add_and_fetch( &mPending, 0 ) > 0 )
+        {
+            if ( !( t = Take( self, victim, steals ) ) )
+            {
+                ::pthread_mutex_lock( &mMutex );
+
+                while ( ( __sync_add_and_fetch( &mQueued, 0 ) == 0 ) &&
+                    ( __sync_add_and_fetch( &mPending, 0 ) > 0 ) )
+                {
+                    ::pthread_cond_wait( &mIdle, &mMutex );
+                }   // sleep until a task is pushed or all are done
+
+                ::pthread_mutex_unlock( &mMutex ); continue;
+            }   // the remaining tasks are running or waiting for them
+
+            t->Run();
+
+            for ( unsigned int i = 0; i < ( t->mNext ).size(); ++i )
+            {
+                if ( __sync_sub_and_fetch( &( t->mNext[ i ] )->mWait, 1 ) == 0 )
+                {
+                    Push( self, t->mNext[ i ] );
+                }   // the last predecessor has run
+            }   // release the successors before the task is done
+
+            if ( __sync_sub_and_fetch( &mPending, 1 ) == 0 )
+            {
+                ::pthread_mutex_lock( &mMutex );
+                ::pthread_cond_broadcast( &mIdle );
+                ::pthread_mutex_unlock( &mMutex );
+            }   // wake the idle workers to leave
+        }   // until every task is done
+
+        #pragma omp critical
+        {
+            mSteals += steals;
+        }   // the critical region
+    }   // end of the parallel section
+
+    mRunning = false;
+    ::pthread_cond_destroy( &mIdle ); ::pthread_mutex_destroy( &mMutex );
+
+    for ( unsigned int i = 0; i < n; ++i )
+    {
+        ::omp_destroy_lock( &mQueue[ i ].lock );
+    }   // release the locks
+
+    mQueue.clear();
+}   // end of Run()
+
+/*
+ * the newest task of the own deque, or the oldest task of another worker,
+ * starting from the one robbed last; NULL if every deque is empty
+*/
+Task* Scheduler::Take(
+    const unsigned int _s,      // worker
+    unsigned int& _v,           // last worker robbed
+    double& _n )                // tasks stolen
+{
+    Task* t = NULL;
+
+    for ( unsigned int k = 0; !t && ( k < mQueue.size() ); ++k )
+    {
+        const unsigned int i = ( k ) ? ( _v + k ) % mQueue.size() : _s;
+        stQUEUE& q = mQueue[ i ];
+
+        if ( k && ( i == _s ) )
+        {
+            continue;
+        }   // the own deque is already empty
+
+        ::omp_set_lock( &q.lock );
+
+        if ( !( q.task ).empty() )
+        {
+            t = ( k ) ? ( q.task ).front() : ( q.task ).back();
+            ( k ) ? ( q.task ).pop_front() : ( q.task ).pop_back();
+            __sync_sub_and_fetch( &mQueued, 1 );
+        }   // the owner takes the newest task, a thief the oldest
+
+        ::omp_unset_lock( &q.lock );
+
+        if ( t && k )
+        {
+            _v = i; _n += 1.0;
+        }   // stolen; the same worker is tried first next time
+    }   // the own deque first, then the others
+
+    return( t );
+}   // end of Take()
+
+/*
+ * add a ready task to the deque of a worker
+*/
+void Scheduler::Push(
+    const unsigned int _s,      // worker
+    Task* _t )
+{
+    stQUEUE& q = mQueue[ _s % mQueue.size() ];
+
+    ::omp_set_lock( &q.lock ); ( q.task ).push_back( _t ); ::omp_unset_lock( &q.lock );
+    __sync_add_and_fetch( &mQueued, 1 );
+
+    ::pthread_mutex_lock( &mMutex );
+    ::pthread_cond_signal( &mIdle );
+    ::pthread_mutex_unlock( &mMutex );
+}   // end of Push()
@@ -0,0 +1,122 @@
+/*
+ * task.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * work-stealing scheduler of small tasks
+ *
+ * the workers are the threads of a parallel region, so the number of
+ * threads (OMP_NUM_THREADS, or --threads of the programs) and their
+ * placement on the numa nodes are the same as those of every other stage.
+ * every worker owns a deque of ready tasks: it takes the newest task from
+ * its own deque, and once that is empty, steals the oldest task of another
+ * worker. the tasks submitted before Run() are dealt out in reverse, so
+ * every worker starts with its largest task, if the large tasks are
+ * submitted first, and the small tasks are stolen to fill the gaps; a few
+ * large taxa thus do not leave the other processors idle. a worker that
+ * finds every deque empty sleeps until a task is pushed or all are done.
+ *
+ * a task may have to wait for others: Then() makes a task a successor, and
+ * it becomes ready once all of its predecessors have run, on the worker
+ * that ran the last of them. a running task may submit new tasks, which go
+ * to the deque of its own worker. dependencies must be set before the
+ * predecessor is submitted; the successor may already be submitted if one
+ * of its predecessors is still running, e.g., the task that takes a block
+ * of a stream makes the task of the next block, and the one parsing it,
+ * predecessors of the task that runs once the stream is parsed. the
+ * scheduler does not own the tasks.
+ *
+ * the Assign() of Strain and Species read the summary this way: a chain of
+ * tasks takes the blocks, and every block is parsed by a task of its own,
+ * followed by the histograms of the taxa and by the species level
+ * assignment of the block in the order of the file, respectively.
+ * SamFile::Scan() keeps its parallel region; it hands out the alignments of
+ * a read, not blocks, and is yet to be ported.
+*/
+
+#ifndef _TASK_H
+#define _TASK_H
+
+#include <omp.h>
+#include <pthread.h>
+#include <placement.h>
+
+#include <deque>
+#include <vector>
+
+class Task
+{
+public:
+    Task();
+    virtual ~Task();
+
+    virtual void Run() = 0;
+    void Then( Task* );
+
+private:
+    std::vector<Task*> mNext;   // successors
+    int mWait;                  // predecessors that have not run yet
+
+    friend class Scheduler;
+};  // end of class definition
+
+/*
+ * task calling a member function of an object with an argument, e.g., the
+ * index of a taxon
+*/
+template <class T> class Call : public Task
+{
+public:
+    Call( T* _o, void ( T::*_f )( const unsigned int ), const unsigned int _a ) :
+        mObject( _o ), mCall( _f ), mArg( _a ) {}
+
+    void Run()
+    {
+        ( mObject->*mCall )( mArg );
+    }   // end of Run()
+
+private:
+    T* mObject;
+    void ( T::*mCall )( const unsigned int );
+    unsigned int mArg;
+};  // end of class definition
+
+class Scheduler
+{
+public:
+    Scheduler();
+    ~Scheduler();
+
+    void Submit( Task* );
+    void Run();
+    void SetNuma( const Numa* );
+    double GetSteals() const;
+
+private:
+    struct stQUEUE
+    {
+        omp_lock_t lock;
+        std::deque<Task*> task;     // ready tasks; the owner takes the back
+    };  // deque of a worker
+
+    std::vector<Task*> mReady;      // tasks submitted before Run()
+    std::vector<stQUEUE> mQueue;    // deques of the workers
+    const Numa* mNuma;      // placement of the workers; NULL if not attached
+    bool mRunning;          // the workers are running
+    long mPending;          // submitted tasks that have not run yet
+    long mQueued;           // ready tasks in the deques
+    double mSteals;         // tasks taken from another worker
+    pthread_mutex_t mMutex; // guards the sleep of the idle workers
+    pthread_cond_t mIdle;   // signaled once a task is ready or all are done
+
+    Task* Take( const unsigned int, unsigned int&, double& );
+    void Push( const unsigned int, Task* );
+};  // end of class definition
+
+#endif  // _TASK_H
@@ -0,0 +1,44 @@
+/*
+ * token.h
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Center for the Study of Biological Complexity (CSBC)
+ * Department of Microbiology and Immunology
+ * Medical College of Virginia
+ * Virginia Commonwealth University
+ * Richmond, VA 23298
+ *
+ * in-place tokenizer of delimited lines
+ *
+ * the delimiters are replaced with null characters and the fields point
+ * into the line itself. consecutive delimiters produce empty fields, the
+ * same as boost::algorithm::split() with is_any_of(). the vector keeps its
+ * storage between calls, so a thread that reuses it does not allocate.
+*/
+
+#ifndef _TOKEN_H
+#define _TOKEN_H
+
+#include <vector>
+#include <cstring>
+
+inline unsigned int Tokenize(
+    char* _s,                   // line to be split; modified in place
+    const char* _d,             // delimiters
+    std::vector<const char*>& _f )  // fields
+{
+    _f.clear(); _f.push_back( _s );
+
+    for ( char* p = _s; *p; ++p )
+    {
+        if ( ::strchr( _d, *p ) )
+        {
+            *p = '\0'; _f.push_back( p + 1 );
+        }   // end of the field
+    }   // walk through the line
+
+    return( _f.size() );
+}   // end of Tokenize()
+
+#endif  // _TOKEN_H